@@ -115,7 +115,7 @@ public:
 public:
     bool opt_log_con;
     double opt_time_limit;
-	std::string opt_editconf,opt_opensaves,opt_opencaptures,opt_lang;
+	std::string opt_editconf,opt_opensaves,opt_opencaptures,opt_lang,opt_forkserver;
 	std::vector<std::string> config_file_list;
 	std::vector<std::string> opt_c;
 	bool opt_disable_dpi_awareness;
@@ -61,6 +61,21 @@ extern Bit32s CPU_CycleLimit;
 extern Bit64s CPU_IODelayRemoved;
 extern bool CPU_CycleAutoAdjust;
 extern bool CPU_SkipCycleAutoAdjust;
+extern bool CPU_CycleGovernor;
+
+/* Host time accounting for the cycle governor. A charge books the host time
+ * since the previous charge to the given bucket. */
+enum {
+	CPU_GOV_CPU=0,		/* CPU core and callbacks */
+	CPU_GOV_DEVICES,	/* PIC events and timer ticks, VGA line drawing included */
+	CPU_GOV_RENDER,		/* end of frame: capture and present */
+	CPU_GOV_GUI,		/* host event handling */
+	CPU_GOV_IDLE,
+	CPU_GOV_MAX
+};
+extern bool CPU_GovernorActive;
+void CPU_GovernorCharge(unsigned int what);
+const char *CPU_GovernorStatus(void);
 extern Bitu CPU_AutoDetermineMode;
 extern Bitu CPU_CyclesCur;
 extern Bit32s CPU_CyclesSet;
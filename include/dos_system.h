@@ -21,6 +21,9 @@
 #define DOSBOX_DOS_SYSTEM_H
 
 #include <vector>
+#include <map>
+#include <string>
+#include <time.h>
 #ifndef DOSBOX_DOSBOX_H
 #include "dosbox.h"
 #endif
@@ -151,6 +154,7 @@ public:
 	~DOS_Drive_Cache				(void);
 
 	enum TDirSort { NOSORT, ALPHABETICAL, DIRALPHABETICAL, ALPHABETICALREV, DIRALPHABETICALREV };
+	enum TFileType { FILETYPE_UNKNOWN, FILETYPE_NONE, FILETYPE_FILE, FILETYPE_DIR };
 
 	void		SetBaseDir			(const char* path, DOS_Drive *drive);
 	void		SetDirSort			(TDirSort sort) { sortDirType = sort; };
@@ -159,6 +163,15 @@ public:
 
 	void		ExpandName			(char* path);
 	char*		GetExpandName		(const char* path);
+	// what the path last expanded is on the host, kept until the cache changes.
+	// unless host changes are watched only directories are trusted, files can
+	// be copied in or deleted on the host without the cache noticing
+	TFileType	GetExpandedType		(void) {
+		if (!lastLookup) return FILETYPE_UNKNOWN;
+		if (watchMode == WATCH_OFF && lastLookup->type != FILETYPE_DIR) return FILETYPE_UNKNOWN;
+		return lastLookup->type;
+	};
+	void		SetExpandedType		(TFileType type) { if (lastLookup) lastLookup->type = type; };
 	bool		GetShortName		(const char* fullname, char* shortname);
 
 	bool		FindFirst			(char* path, Bit16u& id);
@@ -170,6 +183,8 @@ public:
 
 	void		EmptyCache			(void);
 	void		MediaChange			(void);
+	bool		WatchHostChanges	(bool allowPoll);
+	void		CheckHostChanges	(void);
 	void		SetLabel			(const char* name,bool cdrom,bool allowupdate);
 	char*		GetLabel			(void) { return label; };
 
@@ -215,6 +230,11 @@ private:
 	void		CopyEntry		(CFileInfo* dir, CFileInfo* from);
 	Bit16u		GetFreeID		(CFileInfo* dir);
 	void		Clear			(void);
+	CFileInfo*	FindCachedDir		(const char* path);
+	void		FlushLookups		(void);
+	void		CacheOutDir		(CFileInfo* dir);
+	void		WatchDir		(const char* path);
+	void		PollDirs		(void);
 
 	CFileInfo*	dirBase;
 	char		dirPath				[CROSS_LEN];
@@ -234,6 +254,26 @@ private:
 
 	char		label				[CROSS_LEN];
 	bool		updatelabel;
+
+	// resolved paths, guest path (with basePath) -> expanded path
+	struct CLookup {
+		std::string	expanded;
+		TFileType	type;
+	};
+	std::map<std::string,CLookup>	lookups;
+	CLookup*	lastLookup;
+
+	// host change tracking
+	enum TWatchMode { WATCH_OFF, WATCH_POLL, WATCH_NOTIFY };
+	struct PollInfo {
+		time_t	mtime;		// of the directory when it was cached in
+		time_t	readtime;	// when it was cached in
+	};
+	TWatchMode	watchMode;
+	int			watchFd;
+	std::map<int,std::string>		watchNotify;	// inotify watch -> host directory
+	std::map<std::string,PollInfo>	watchPoll;		// polled host directory
+	Bitu		watchPollTicks;
 };
 
 class DOS_Drive {
@@ -265,6 +305,9 @@ public:
 	virtual void closedir(void *handle) {};
 	virtual bool read_directory_first(void *handle, char* entry_name, bool& is_directory) { return false; };
 	virtual bool read_directory_next(void *handle, char* entry_name, bool& is_directory) { return false; };
+	/* these 2 let DOS_Drive_Cache notice changes made to a cached directory on the host */
+	virtual int watch_directory(int watch_fd, const char *dir) { (void)watch_fd; (void)dir; return -1; };
+	virtual bool stat_directory(const char *dir, time_t &mtime) { (void)dir; (void)mtime; return false; };
 
 	virtual const char * GetInfo(void);
 	char * GetBaseDir(void);
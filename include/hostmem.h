@@ -0,0 +1,36 @@
+/*
+ *  Copyright (C) 2002-2015  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DOSBOX_HOSTMEM_H
+#define DOSBOX_HOSTMEM_H
+
+#ifndef DOSBOX_DOSBOX_H
+#include "dosbox.h"
+#endif
+
+/* Backing store for guest RAM and video memory. The memory comes zeroed and
+ * page aligned straight from the host, and pages the guest never touches take
+ * no host memory. Returns NULL on failure. */
+HostPt HostMem_Alloc(size_t size);
+void HostMem_Free(HostPt ptr);
+
+/* zero a range of memory from HostMem_Alloc(). whole pages are handed back to
+ * the host instead of being written, so clearing memory doesn't make it resident. */
+void HostMem_Zero(HostPt ptr,size_t size);
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (C) 2002-2015  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DOSBOX_LAZYINIT_H
+#define DOSBOX_LAZYINIT_H
+
+#ifndef DOSBOX_DOSBOX_H
+#include "dosbox.h"
+#endif
+#ifndef DOSBOX_TIMER_H
+#include "timer.h"
+#endif
+
+/* Deferred initialization.
+ *
+ * Tables and buffers that take real time to build, but that most sessions never
+ * use, are built on first use instead of at startup. The device keeps a LazyInit
+ * holding the function that does the work and calls Ensure() on every path that
+ * needs the result. The first call runs the function. Its wall time is logged at
+ * debug level (-debug), next to the startup timeline, so the cost still shows up
+ * when it is paid. */
+class LazyInit {
+public:
+	typedef void (*Func)(void);
+
+	LazyInit(const char *_name,Func _func) : name(_name), func(_func), done(false) { }
+public:
+	inline void Ensure(void) {
+		if (GCC_UNLIKELY(!done)) Run();
+	}
+	inline bool IsDone(void) const {
+		return done;
+	}
+	/* for the device to call once it has torn down what the function built */
+	inline void Reset(void) {
+		done = false;
+	}
+private:
+	void Run(void) {
+		Bit64u start = GetTicksUs();
+
+		done = true;
+		func();
+		LOG(LOG_MISC,LOG_DEBUG)("Deferred init: %s took %.3fms",name,(double)(GetTicksUs() - start) / 1000.0);
+	}
+private:
+	const char *name;
+	Func func;
+	bool done;
+};
+
+#endif
@@ -41,6 +41,23 @@ typedef Bit32s MemHandle;
 extern HostPt MemBase;
 HostPt GetMemBase(void);
 
+/* Dirty page tracking (used by the rewind buffer). While enabled, MEM_dirty_map
+ * holds one byte per page of system RAM, set when the page may have been written.
+ * Pages are marked when a TLB link that allows writing is made to them, whether
+ * it writes straight to host memory or through the page handler (the video
+ * memory window, ROM, MMIO), so after MEM_ClearDirtyPages() (which also flushes
+ * the TLB) only pages written since are set. */
+extern Bit8u *MEM_dirty_map;
+extern Bitu MEM_dirty_pages;
+
+void MEM_EnableDirtyTracking(bool enable);
+void MEM_ClearDirtyPages(void);
+
+static INLINE void MEM_MarkPageDirty(const Bitu phys_page) {
+	if (GCC_UNLIKELY(MEM_dirty_map != NULL) && phys_page < MEM_dirty_pages)
+		MEM_dirty_map[phys_page] = 1;
+}
+
 bool MEM_A20_Enabled(void);
 void MEM_A20_Enable(bool enable);
 
@@ -160,12 +177,17 @@ void phys_writes(PhysPt addr, const char* string, Bitu length);
 
 static INLINE void phys_writeb(const PhysPt addr,const Bit8u val) {
 	host_writeb(MemBase+addr,val);
+	MEM_MarkPageDirty(addr>>12);
 }
 static INLINE void phys_writew(const PhysPt addr,const Bit16u val){
 	host_writew(MemBase+addr,val);
+	MEM_MarkPageDirty(addr>>12);
+	MEM_MarkPageDirty((addr+1)>>12);
 }
 static INLINE void phys_writed(const PhysPt addr,const Bit32u val){
 	host_writed(MemBase+addr,val);
+	MEM_MarkPageDirty(addr>>12);
+	MEM_MarkPageDirty((addr+3)>>12);
 }
 
 static INLINE Bit8u phys_readb(const PhysPt addr) {
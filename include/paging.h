@@ -104,6 +104,15 @@ public:
 	virtual bool writeb_checked(PhysPt addr,Bitu val);
 	virtual bool writew_checked(PhysPt addr,Bitu val);
 	virtual bool writed_checked(PhysPt addr,Bitu val);
+	/* Span writes for string instructions and block copies: count units of width
+	 * (1, 2 or 4) bytes from addr on, all within the page of addr, with the same
+	 * result and access delay as count writeb/writew/writed calls. writefill stores
+	 * val every time, writeblock takes the units from data. A handler without a
+	 * span path returns false and the caller writes unit by unit. */
+	virtual bool writefill(PhysPt addr,Bitu val,Bitu width,Bitu count);
+	virtual bool writeblock(PhysPt addr,const Bit8u *data,Bitu width,Bitu count);
+	/* CPU cycles a single write through the handler charges as access delay */
+	virtual Bits writedelay(void);
    PageHandler (void) { }
 	Bitu flags; 
 	const Bitu getFlags() const {
@@ -45,6 +45,17 @@ unsigned int PIC_parse_IRQ_hack_string(const char *str);
 
 extern Bitu PIC_IRQCheck;
 extern Bitu PIC_Ticks;
+extern Bitu PIC_TickEpoch;
+
+/* Event times are milliseconds since PIC_TickEpoch, in signed 32.32 fixed
+ * point, so they hold about 2^31 ms (24.8 days). TIMER_AddTick moves the
+ * epoch forward every PIC_EPOCH_SPAN ms and shifts the queued events along,
+ * which keeps "now" small however long the emulator runs. That leaves events
+ * up to 2^31-PIC_EPOCH_SPAN ms ahead. PIC_Ticks-PIC_TickEpoch is taken in
+ * unsigned math, so PIC_Ticks itself may wrap around. */
+typedef Bit64s pic_tick_t;
+#define PIC_TICK_ONE ((pic_tick_t)1 << 32)
+#define PIC_EPOCH_SPAN ((Bitu)1 << 20)
 
 double PIC_GetCurrentEventTime(void);
 
@@ -61,7 +72,20 @@ static INLINE Bits PIC_MakeCycles(double amount) {
 }
 
 static INLINE double PIC_FullIndex(void) {
-	return PIC_Ticks+(double)PIC_TickIndex();
+	return PIC_Ticks+(double)PIC_TickIndexND()/(double)CPU_CycleMax;
+}
+
+static INLINE pic_tick_t PIC_MsToTicks(double ms) {
+	return (pic_tick_t)(ms*(double)PIC_TICK_ONE);
+}
+
+static INLINE double PIC_TicksToMs(pic_tick_t ticks) {
+	return (double)ticks/(double)PIC_TICK_ONE;
+}
+
+/* the current time as an event time */
+static INLINE pic_tick_t PIC_FullTicks(void) {
+	return ((pic_tick_t)(PIC_Ticks-PIC_TickEpoch)*PIC_TICK_ONE)+((pic_tick_t)PIC_TickIndexND()*PIC_TICK_ONE)/(pic_tick_t)CPU_CycleMax;
 }
 
 void PIC_ActivateIRQ(Bitu irq);
@@ -71,7 +95,9 @@ void PIC_runIRQs(void);
 bool PIC_RunQueue(void);
 
 //Delay in milliseconds
-void PIC_AddEvent(PIC_EventHandler handler,float delay,Bitu val=0);
+void PIC_AddEvent(PIC_EventHandler handler,double delay,Bitu val=0);
+//Delay in event time (PIC_TICK_ONE per millisecond)
+void PIC_AddEventTicks(PIC_EventHandler handler,pic_tick_t delay,Bitu val=0);
 void PIC_RemoveEvents(PIC_EventHandler handler);
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, Bitu val);
 
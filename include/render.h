@@ -87,6 +87,7 @@ typedef struct {
 		Bitu cachePitch;
 		Bit8u *cacheRead;
 		Bitu inHeight, inLine, outLine;
+		bool direct;		/* lines go to the output unscaled, see RENDER_DirectLineHandler */
 	} scale;
 	RenderPal_t pal;
 	bool updating;
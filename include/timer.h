@@ -32,6 +32,9 @@ extern unsigned long PIT_TICK_RATE;
 
 #define GetTicks() SDL_GetTicks()
 
+/* Host clock in microseconds, for measuring where host time goes */
+Bit64u GetTicksUs(void);
+
 typedef void (*TIMER_TickHandler)(void);
 
 /* Register a function that gets called everytime if 1 or more ticks pass */
@@ -451,6 +451,7 @@ void VGA_SetupHandlers(void);
 void VGA_StartResize(Bitu delay=50);
 void VGA_SetupDrawing(Bitu val);
 void VGA_CheckScanLength(void);
+Bitu VGA_DrawFrameLines(void);
 void VGA_ChangedBank(void);
 
 /* Some DAC/Attribute functions */
@@ -492,6 +493,25 @@ void VGA_SetOverride(bool vga_override);
 
 extern VGA_Type vga;
 
+/* Dirty page tracking of video memory (used by the rewind buffer), the
+ * counterpart of MEM_dirty_map in mem.h. Writes through the linear
+ * framebuffer mark the video memory page here when the TLB link to it is made,
+ * so does code that writes to vga.mem.linear directly (the S3 accelerator, BIOS
+ * mode sets and clears). Writes through the A0000-BFFFF window (and E0000-E7FFF
+ * on PC-98) mark the window's pages in MEM_dirty_map instead, since where they
+ * land in video memory depends on the video mode. */
+extern Bit8u *VGA_dirty_map;
+extern Bitu VGA_dirty_pages;
+
+void VGA_EnableDirtyTracking(bool enable);
+void VGA_ClearDirtyPages(void);
+void VGA_MarkAllPagesDirty(void);
+
+static inline void VGA_MarkPageDirty(const Bitu vram_page) {
+	if (GCC_UNLIKELY(VGA_dirty_map != NULL) && vram_page < VGA_dirty_pages)
+		VGA_dirty_map[vram_page] = 1;
+}
+
 /* Support for modular SVGA implementation */
 /* Video mode extra data to be passed to FinishSetMode_SVGA().
    This structure will be in flux until all drivers (including S3)
@@ -72,14 +72,24 @@ struct pkzip_central_directory_header_end { /* PKZIP APPNOTE 2.0: General Format
 #pragma pack(pop)
 
 class ZIPFile;
+struct ZIPFileEntryZ;
+struct ZIPWriteJob;
+struct ZIPWriter;
+
+#define ZIP_METHOD_STORE            0
+#define ZIP_METHOD_DEFLATE          8
 
 class ZIPFileEntry {
 public:
     bool        can_write;
-    off_t       file_length;
+    off_t       file_length;            /* uncompressed length */
     off_t       file_offset;
     off_t       file_header_offset;
-    off_t       position;
+    off_t       position;               /* position within the uncompressed data */
+    off_t       compressed_length;      /* length of the data as stored in the file */
+    uint16_t    compression_method;     /* ZIP_METHOD_STORE or ZIP_METHOD_DEFLATE */
+    ZIPFileEntryZ* zstate;              /* inflate stream state, if reading compressed data */
+    ZIPWriteJob* job;                   /* data written so far, handed to the writer on close */
     std::string name;
     ZIPFile*    file;
     zipcrc_t    write_crc;
@@ -96,6 +106,7 @@ public:
     bool rewind(void);
     int read(void *buffer,size_t count);
     int write(const void *buffer,size_t count);
+    void free_zstate(void);
 	
 private: /* encourage code that uses this C++ class to stream-read so that
             this code can add deflate compression support later without pain and hacks */
@@ -111,6 +122,7 @@ public:
     bool        can_write;
     bool        wrote_trailer;
     std::string current_entry;      /* currently writing entry */
+    ZIPWriter*  writer;             /* background writer while open for writing */
 public:
     ZIPFile();
     ~ZIPFile();
@@ -125,6 +137,10 @@ public:
     int read(void *buffer,size_t count);
     int write(const void *buffer,size_t count);
     void writeZIPFooter(void);
+    void wait_writer(void);
+private:
+    void start_writer(void);
+    void queue_write(ZIPWriteJob *job);
 };
 
 class zip_nv_pair_map : public std::map<std::string, std::string> {
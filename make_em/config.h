@@ -71,6 +71,9 @@
    prediction. */
 #define C_HAS_BUILTIN_EXPECT 1
 
+/* Define to 1 if you have the inotify functions */
+/* #undef C_HAVE_INOTIFY */
+
 /* Define to 1 if you have the mprotect function */
 /* #undef C_HAVE_MPROTECT */
 
@@ -122,6 +125,9 @@
 /* define to 1 if you have XKBlib.h and X11 lib */
 /* #undef C_X11_XKB */
 
+/* Define to 1 if you have zlib */
+/*#define C_ZLIB 1*/
+
 /* libm doesn't include powf */
 /* #undef DB_HAVE_NO_POWF */
 
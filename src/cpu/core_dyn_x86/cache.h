@@ -115,6 +115,7 @@ public:
 		}
 		addr&=4095;
 		if (host_readb(hostmem+addr)==(Bit8u)val) return;
+		MEM_MarkPageDirty(phys_page);
 		host_writeb(hostmem+addr,val);
 		if (!*(Bit8u*)&write_map[addr]) {
 			if (active_blocks) return;
@@ -135,6 +136,7 @@ public:
 		}
 		addr&=4095;
 		if (host_readw(hostmem+addr)==(Bit16u)val) return;
+		MEM_MarkPageDirty(phys_page);
 		host_writew(hostmem+addr,val);
 		if ((*(Bit16u*)&write_map[addr]) == 0) {
 			if (active_blocks) return;
@@ -155,6 +157,7 @@ public:
 		}
 		addr&=4095;
 		if (host_readd(hostmem+addr)==(Bit32u)val) return;
+		MEM_MarkPageDirty(phys_page);
 		host_writed(hostmem+addr,val);
 		if ((*(Bit32u*)&write_map[addr]) == 0) {
 			if (active_blocks) return;
@@ -175,6 +178,7 @@ public:
 		}
 		addr&=4095;
 		if (host_readb(hostmem+addr)==(Bit8u)val) return false;
+		MEM_MarkPageDirty(phys_page);
 		if (!*(Bit8u*)&write_map[addr]) {
 			if (!active_blocks) {
 				active_count--;
@@ -201,6 +205,7 @@ public:
 		}
 		addr&=4095;
 		if (host_readw(hostmem+addr)==(Bit16u)val) return false;
+		MEM_MarkPageDirty(phys_page);
 		if ((*(Bit16u*)&write_map[addr]) == 0) {
 			if (!active_blocks) {
 				active_count--;
@@ -227,6 +232,7 @@ public:
 		}
 		addr&=4095;
 		if (host_readd(hostmem+addr)==(Bit32u)val) return false;
+		MEM_MarkPageDirty(phys_page);
 		if ((*(Bit32u*)&write_map[addr]) == 0) {
 			if (!active_blocks) {
 				active_count--;
@@ -40,6 +40,9 @@
 #ifndef PAGESIZE
 #define PAGESIZE 4096
 #endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
 #endif /* C_HAVE_MPROTECT */
 
 #include "callback.h"
@@ -60,6 +63,11 @@
 #define DYN_HASH_SHIFT	(4)
 #define DYN_PAGE_HASH	(4096>>DYN_HASH_SHIFT)
 #define DYN_LINKS		(16)
+#define CACHE_SKIP_MAX	(64)		// hot blocks stepped over at most per allocation
+#define DYN_DEMOTE_WINDOW		(1000)	// ms
+#define DYN_DEMOTE_INVALIDATIONS	(256)	// code writes per window that get a page demoted
+#define DYN_DEMOTE_TIME			(2000)	// ms a demoted page stays with the normal core
+#define DYN_DEMOTE_PAGES		(16)
 
 
 //#define DYN_LOG 1 //Turn Logging on.
@@ -161,12 +169,22 @@ static struct {
 
 #include "core_dynrec/decoder.h"
 
+// linear page of the block the dispatcher last entered. with paging on links
+// never leave it, so the blocks run until control comes back are all in it
+static Bitu dynrec_run_page = 0;
+
 CacheBlockDynRec * LinkBlocks(BlockReturn ret) {
 	CacheBlockDynRec * block=NULL;
 	// the last instruction was a control flow modifying instruction
 	Bitu temp_ip=SegPhys(cs)+reg_eip;
 	CodePageHandlerDynRec * temp_handler=(CodePageHandlerDynRec *)get_tlb_readhandler(temp_ip);
 	if (temp_handler->flags & PFLAG_HASCODE) {
+		// with paging on a link across pages would outlive a change of the
+		// page tables, only link within the page of the running block. the
+		// code page handler is per physical page, another linear page may
+		// map the same one, so the linear page has to match as well
+		if (paging.enabled && ((temp_handler!=cache.block.running->page.handler) ||
+			((temp_ip>>12)!=dynrec_run_page))) return NULL;
 		// see if the target is an already translated block
 		block=temp_handler->FindCacheBlock(temp_ip & 4095);
 		if (!block) return NULL;
@@ -194,20 +212,25 @@ extern bool use_dynamic_core_with_paging;
 extern int dynamic_core_cache_block_size;
 
 static bool paging_warning = true;
+static bool paging_was_enabled = false;
+
+// set while translating or running translated code, a guest page fault
+// must not unwind through the generated code (see PAGING_NewPageFault)
+bool dynrec_recursive_faults = false;
 
 Bits CPU_Core_Dynrec_Run(void) {
     if (CPU_Cycles <= 0)
 	    return CBRET_NONE;
 
-    /* Dynamic core is NOT compatible with the way page faults
-     * in the guest are handled in this emulator. Do not use
-     * dynamic core if paging is enabled. Do not comment this
-     * out, even if it happens to work for a minute, a half
-     * hour, a day, because it will turn around and cause
-     * Windows 95 to crash when you've become most comfortable
-     * with the idea that it works. This code cannot handle
-     * the sudden context switch of a page fault and it never
-     * will. Don't do it. You have been warned. */
+    /* With paging on, translated code only accesses guest memory
+     * through the checked functions: a page fault ends the block
+     * with eip at the faulting instruction and the exception is
+     * raised from here. Instructions that can't be restarted that
+     * way are not translated and run on the normal core instead
+     * (see DYN_PAGING_FALLBACK), which may throw the fault right
+     * out of this function. What is left is the rare unchecked
+     * access (the I/O permission bitmap of the TSS), which still
+     * takes the recursive page fault path. */
     if (paging.enabled && !use_dynamic_core_with_paging) {
         if (paging_warning) {
             LOG_MSG("Dynamic core warning: The guest OS/Application has just switched on 80386 paging, which is not supported by the dynamic core. The normal core will be used until paging is switched off again.");
@@ -218,12 +241,28 @@ Bits CPU_Core_Dynrec_Run(void) {
     }
 
 	for (;;) {
+		// blocks translated without paging use unchecked helpers, drop them
+		// once paging is switched on (mov cr0 does not leave this loop)
+		if (GCC_UNLIKELY(paging.enabled!=paging_was_enabled)) {
+			if (paging.enabled) {
+				LOG(LOG_CPU,LOG_DEBUG)("Dynamic core: paging switched on, flushing the code cache");
+				while (cache.used_pages) cache.used_pages->ClearRelease();
+			}
+			paging_was_enabled=paging.enabled;
+		}
+
 		// Determine the linear address of CS:EIP
 		PhysPt ip_point=SegPhys(cs)+reg_eip;
 		#if C_HEAVY_DEBUG
 			if (DEBUG_HeavyIsBreakpoint()) return debugCallback;
 		#endif
 
+		// pages that were rewritten too often run on the normal core for a while
+		if (GCC_UNLIKELY(cache_demoted_count!=0)) {
+			Bitu ip_page=ip_point>>12;
+			if (PAGING_MakePhysPage(ip_page) && cache_isdemoted(ip_page)) return CPU_Core_Normal_Run();
+		}
+
 		CodePageHandlerDynRec * chandler=0;
 		// see if the current page is present and contains code
 		if (GCC_UNLIKELY(MakeCodePage(ip_point,chandler))) {
@@ -235,6 +274,13 @@ Bits CPU_Core_Dynrec_Run(void) {
 		// page doesn't contain code or is special
 		if (GCC_UNLIKELY(!chandler)) return CPU_Core_Normal_Run();
 
+		// the code in this page keeps being rewritten, retranslating it costs more
+		// than interpreting it
+		if (GCC_UNLIKELY(chandler->WantsDemotion())) {
+			cache_demote(chandler);
+			return CPU_Core_Normal_Run();
+		}
+
 		// find correct Dynamic Block to run
 		CacheBlockDynRec * block=chandler->FindCacheBlock(ip_point&4095);
 		if (!block) {
@@ -242,26 +288,35 @@ Bits CPU_Core_Dynrec_Run(void) {
 			// unless the instruction is known to be modified
 			if (!chandler->invalidation_map || (chandler->invalidation_map[ip_point&4095]<4)) {
 				// translate up to 32 instructions
+				dynrec_recursive_faults=true;
 				block=CreateCacheBlock(chandler,ip_point,32);
+				dynrec_recursive_faults=false;
 			} else {
-				// let the normal core handle this instruction to avoid zero-sized blocks
+				// let the normal core handle this instruction to avoid zero-sized blocks.
+				// the rest of the slice is parked in CPU_CycleLeft first like BR_Opcode
+				// does, with paging on the instruction can page fault out of here
 				Bitu old_cycles=CPU_Cycles;
+				CPU_CycleLeft+=old_cycles;
 				CPU_Cycles=1;
 				Bits nc_retcode=CPU_Core_Normal_Run();
 				if (!nc_retcode) {
+					CPU_CycleLeft-=old_cycles;
 					CPU_Cycles=old_cycles-1;
 					continue;
 				}
-				CPU_CycleLeft+=old_cycles;
 				return nc_retcode;
 			}
 		}
 
+		dynrec_run_page=ip_point>>12;
+
 run_block:
 		cache.block.running=0;
 		// now we're ready to run the dynamic code block
 //		BlockReturn ret=((BlockReturn (*)(void))(block->cache.start))();
+		dynrec_recursive_faults=true;
 		BlockReturn ret=core_dynrec.runcode(block->cache.start);
+		dynrec_recursive_faults=false;
 
         if (sizeof(CPU_Cycles) > 4) {
             // HACK: All dynrec cores for each processor assume CPU_Cycles is 32-bit wide.
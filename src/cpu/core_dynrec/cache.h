@@ -55,6 +55,8 @@ public:
 		CacheBlockDynRec * from;	// the from-block can transfer control to this block
 	} link[2];	// maximum two links (conditional jumps)
 	CacheBlockDynRec * crossblock;
+	Bit32u hot;		// entered since the allocator last came by, see cache_openblock.
+					// set by the block itself, so entries through links count too
 };
 
 static struct {
@@ -76,6 +78,32 @@ static Bit8u * cache_code_start_ptr=NULL;
 static Bit8u * cache_code=NULL;
 static Bit8u * cache_code_link_blocks=NULL;
 
+// size of the code cache and the number of blocks and code pages that go with it,
+// set from "dynamic core cache size" when the cache is first allocated
+static Bitu cache_code_size=CACHE_TOTAL;
+static Bitu cache_block_count=CACHE_BLOCKS;
+static Bitu cache_page_count=CACHE_PAGES;
+
+// translation and eviction counters, logged (LOG_CPU, debug) whenever the cache wraps around
+static struct {
+	Bitu blocks;		// blocks translated
+	Bitu bytes;			// host code generated for them
+	Bitu evicted;		// translated blocks thrown out to make room
+	Bitu skipped;		// hot blocks stepped over (second chance)
+	Bitu recycled;		// code pages cleared because all were in use
+	Bitu invalidations;	// guest writes that hit translated code
+	Bitu demoted;		// pages handed to the normal core for a while
+	Bitu wrap_ticks;	// PIC_Ticks at the last wrap
+} cache_stats;
+
+// pages whose code keeps being rewritten are not translated for a while,
+// the normal core runs them instead (see CPU_Core_Dynrec_Run)
+static struct {
+	Bitu phys_page;
+	Bitu until;			// PIC_Ticks
+} cache_demoted[DYN_DEMOTE_PAGES];
+static Bitu cache_demoted_count=0;
+
 static CacheBlockDynRec * cache_blocks=NULL;
 static CacheBlockDynRec link_blocks[2];		// default linking (specially marked)
 
@@ -101,6 +129,8 @@ public:
 
 		active_blocks=0;
 		active_count=16;
+		invalidations=0;
+		invalidation_ticks=PIC_Ticks;
 
 		// initialize the maps with zero (no cache blocks as well as code present)
 		memset(&hash_map,0,sizeof(hash_map));
@@ -116,6 +146,14 @@ public:
 		Bits index=1+(end>>DYN_HASH_SHIFT);
 		bool is_current_block=false;	// if the current block is modified, it has to be exited as soon as possible
 
+		// count code hits per page over a window of DYN_DEMOTE_WINDOW ms
+		if ((PIC_Ticks-invalidation_ticks)>=DYN_DEMOTE_WINDOW) {
+			invalidation_ticks=PIC_Ticks;
+			invalidations=0;
+		}
+		invalidations++;
+		cache_stats.invalidations++;
+
 		Bit32u ip_point=SegPhys(cs)+reg_eip;
 		ip_point=(PAGING_GetPhysicalPage(ip_point)-(phys_page<<12))+(ip_point&0xfff);
 		while (index>=0) {
@@ -143,6 +181,7 @@ public:
 	void writeb(PhysPt addr,Bitu val){
 		addr&=4095;
 		if (host_readb(hostmem+addr)==(Bit8u)val) return;
+		MEM_MarkPageDirty(phys_page);
 		host_writeb(hostmem+addr,val);
 		// see if there's code where we are writing to
 		if (!host_readb(&write_map[addr])) {
@@ -160,6 +199,7 @@ public:
 	void writew(PhysPt addr,Bitu val){
 		addr&=4095;
 		if (host_readw(hostmem+addr)==(Bit16u)val) return;
+		MEM_MarkPageDirty(phys_page);
 		host_writew(hostmem+addr,val);
 		// see if there's code where we are writing to
 		if (!host_readw(&write_map[addr])) {
@@ -182,6 +222,7 @@ public:
 	void writed(PhysPt addr,Bitu val){
 		addr&=4095;
 		if (host_readd(hostmem+addr)==(Bit32u)val) return;
+		MEM_MarkPageDirty(phys_page);
 		host_writed(hostmem+addr,val);
 		// see if there's code where we are writing to
 		if (!host_readd(&write_map[addr])) {
@@ -204,6 +245,7 @@ public:
 	bool writeb_checked(PhysPt addr,Bitu val) {
 		addr&=4095;
 		if (host_readb(hostmem+addr)==(Bit8u)val) return false;
+		MEM_MarkPageDirty(phys_page);
 		// see if there's code where we are writing to
 		if (!host_readb(&write_map[addr])) {
 			if (!active_blocks) {
@@ -228,6 +270,7 @@ public:
 	bool writew_checked(PhysPt addr,Bitu val) {
 		addr&=4095;
 		if (host_readw(hostmem+addr)==(Bit16u)val) return false;
+		MEM_MarkPageDirty(phys_page);
 		// see if there's code where we are writing to
 		if (!host_readw(&write_map[addr])) {
 			if (!active_blocks) {
@@ -257,6 +300,7 @@ public:
 	bool writed_checked(PhysPt addr,Bitu val) {
 		addr&=4095;
 		if (host_readd(hostmem+addr)==(Bit32u)val) return false;
+		MEM_MarkPageDirty(phys_page);
 		// see if there's code where we are writing to
 		if (!host_readd(&write_map[addr])) {
 			if (!active_blocks) {
@@ -372,6 +416,14 @@ public:
 		return 0;	// none found
 	}
 
+	// the code in this page is rewritten too often to be worth translating
+	bool WantsDemotion(void) const {
+		return invalidations>=DYN_DEMOTE_INVALIDATIONS;
+	}
+	Bitu GetPhysPage(void) const {
+		return phys_page;
+	}
+
 	HostPt GetHostReadPt(Bitu phys_page) { 
 		hostmem=old_pagehandler->GetHostReadPt(phys_page);
 		return hostmem;
@@ -392,6 +444,8 @@ private:
 
 	Bitu active_blocks;		// the number of cache blocks in this page
 	Bitu active_count;		// delaying parameter to not immediately release a page
+	Bitu invalidations;		// writes that hit code in the current window
+	Bitu invalidation_ticks;	// PIC_Ticks at the start of that window
 	HostPt hostmem;	
 	Bitu phys_page;
 };
@@ -409,9 +463,59 @@ static CacheBlockDynRec * cache_getblock(void) {
 	if (!ret) E_Exit("Ran out of CacheBlocks" );
 	cache.block.free=ret->cache.next;
 	ret->cache.next=0;
+	ret->hot=0;
 	return ret;
 }
 
+static bool cache_isdemoted(Bitu phys_page) {
+	bool found=false;
+	for (Bitu i=0;i<cache_demoted_count;) {
+		if (PIC_Ticks>=cache_demoted[i].until) {
+			// expired, the page may be translated again
+			cache_demoted[i]=cache_demoted[--cache_demoted_count];
+			continue;
+		}
+		if (cache_demoted[i].phys_page==phys_page) found=true;
+		i++;
+	}
+	return found;
+}
+
+static void cache_demote(CodePageHandlerDynRec * cpage) {
+	Bitu phys_page=cpage->GetPhysPage();
+	// when the table is full the oldest entry makes room
+	if (cache_demoted_count>=DYN_DEMOTE_PAGES) {
+		for (Bitu i=1;i<cache_demoted_count;i++) cache_demoted[i-1]=cache_demoted[i];
+		cache_demoted_count--;
+	}
+	cache_demoted[cache_demoted_count].phys_page=phys_page;
+	cache_demoted[cache_demoted_count].until=PIC_Ticks+DYN_DEMOTE_TIME;
+	cache_demoted_count++;
+	cache_stats.demoted++;
+	LOG(LOG_CPU,LOG_DEBUG)("Dynrec: page %x rewritten too often, not translating it for %ums",
+		(unsigned int)phys_page,(unsigned int)DYN_DEMOTE_TIME);
+	cpage->ClearRelease();
+}
+
+static void cache_logstats(void) {
+	LOG(LOG_CPU,LOG_DEBUG)("Dynrec cache wrapped after %ums: %u blocks (%uKB) translated, %u evicted, %u given a second chance, %u pages recycled, %u code writes, %u pages demoted",
+		(unsigned int)(PIC_Ticks-cache_stats.wrap_ticks),(unsigned int)cache_stats.blocks,(unsigned int)(cache_stats.bytes>>10),
+		(unsigned int)cache_stats.evicted,(unsigned int)cache_stats.skipped,(unsigned int)cache_stats.recycled,
+		(unsigned int)cache_stats.invalidations,(unsigned int)cache_stats.demoted);
+	memset(&cache_stats,0,sizeof(cache_stats));
+	cache_stats.wrap_ticks=PIC_Ticks;
+}
+
+// move the allocation point past a block, wrapping around at the end of the cache
+static void cache_advanceblock(CacheBlockDynRec * block) {
+	if (!block->cache.next || (block->cache.next->cache.start>(cache_code_start_ptr + cache_code_size - CACHE_MAXSIZE))) {
+		cache_logstats();
+		cache.block.active=cache.block.first;
+	} else {
+		cache.block.active=block->cache.next;
+	}
+}
+
 void CacheBlockDynRec::Clear(void) {
 	Bitu ind;
 	// check if this is not a cross page block
@@ -460,12 +564,25 @@ void CacheBlockDynRec::Clear(void) {
 
 
 static CacheBlockDynRec * cache_openblock(void) {
+	// the cache is used as a ring. a translated block that has been entered since
+	// the last time the allocator came by is hot: step over it and mark it cold,
+	// so only blocks that stayed cold for a whole round get evicted
+	for (Bitu skip=0;skip<CACHE_SKIP_MAX;skip++) {
+		CacheBlockDynRec * block=cache.block.active;
+		if (!block->page.handler || !block->hot) break;
+		block->hot=0;
+		cache_stats.skipped++;
+		cache_advanceblock(block);
+	}
 	CacheBlockDynRec * block=cache.block.active;
 	// check for enough space in this block
 	Bitu size=block->cache.size;
 	CacheBlockDynRec * nextblock=block->cache.next;
-	if (block->page.handler) 
+	if (block->page.handler) {
+		cache_stats.evicted++;
 		block->Clear();
+	}
+	block->hot=0;
 	// block size must be at least CACHE_MAXSIZE
 	while (size<CACHE_MAXSIZE) {
 		if (!nextblock)
@@ -473,8 +590,10 @@ static CacheBlockDynRec * cache_openblock(void) {
 		// merge blocks
 		size+=nextblock->cache.size;
 		CacheBlockDynRec * tempblock=nextblock->cache.next;
-		if (nextblock->page.handler) 
+		if (nextblock->page.handler) {
+			cache_stats.evicted++;
 			nextblock->Clear();
+		}
 		// block is free now
 		cache_addunusedblock(nextblock);
 		nextblock=tempblock;
@@ -498,6 +617,8 @@ static void cache_closeblock(void) {
 	block->link[1].next=0;
 	// close the block with correct alignment
 	Bitu written=(Bitu)(cache.pos-block->cache.start);
+	cache_stats.blocks++;
+	cache_stats.bytes+=written;
 	if (written>block->cache.size) {
 		if (!block->cache.next) {
 			if (written>block->cache.size+CACHE_MAXSIZE) E_Exit("CacheBlock overrun 1 %d",written-block->cache.size);	
@@ -518,12 +639,7 @@ static void cache_closeblock(void) {
 		}
 	}
 	// advance the active block pointer
-	if (!block->cache.next || (block->cache.next->cache.start>(cache_code_start_ptr + CACHE_TOTAL - CACHE_MAXSIZE))) {
-//		LOG_MSG("Cache full restarting");
-		cache.block.active=cache.block.first;
-	} else {
-		cache.block.active=block->cache.next;
-	}
+	cache_advanceblock(block);
 }
 
 
@@ -564,36 +680,55 @@ static void dyn_run_code(void);
 
 static bool cache_initialized = false;
 
+extern int dynamic_core_cache_size;
+
 static void cache_init(bool enable) {
 	Bits i;
 	if (enable) {
 		// see if cache is already initialized
 		if (cache_initialized) return;
 		cache_initialized = true;
+		if (cache_code_start_ptr==NULL && dynamic_core_cache_size > 0) {
+			// the block and page counts scale with the cache, the defaults go with 8MB
+			cache_code_size=(Bitu)dynamic_core_cache_size*1024*1024;
+			cache_block_count=cache_code_size/(CACHE_TOTAL/CACHE_BLOCKS);
+			cache_page_count=cache_code_size/(CACHE_TOTAL/CACHE_PAGES);
+			if (cache_page_count<CACHE_PAGES) cache_page_count=CACHE_PAGES;
+		}
 		if (cache_blocks == NULL) {
 			// allocate the cache blocks memory
-			cache_blocks=(CacheBlockDynRec*)malloc(CACHE_BLOCKS*sizeof(CacheBlockDynRec));
+			cache_blocks=(CacheBlockDynRec*)malloc(cache_block_count*sizeof(CacheBlockDynRec));
 			if(!cache_blocks) E_Exit("Allocating cache_blocks has failed");
-			memset(cache_blocks,0,sizeof(CacheBlockDynRec)*CACHE_BLOCKS);
+			memset(cache_blocks,0,sizeof(CacheBlockDynRec)*cache_block_count);
 			cache.block.free=&cache_blocks[0];
 			// initialize the cache blocks
-			for (i=0;i<CACHE_BLOCKS-1;i++) {
+			for (i=0;i<(Bits)cache_block_count-1;i++) {
 				cache_blocks[i].link[0].to=(CacheBlockDynRec *)1;
 				cache_blocks[i].link[1].to=(CacheBlockDynRec *)1;
 				cache_blocks[i].cache.next=&cache_blocks[i+1];
 			}
 		}
 		if (cache_code_start_ptr==NULL) {
-			// allocate the code cache memory
+			// allocate the code cache memory. only the address space is taken up front,
+			// the host commits the pages as the cache first writes to them
+			Bitu alloc_size=cache_code_size+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP;
 #if defined (WIN32)
-			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP,
+			cache_code_start_ptr=(Bit8u*)VirtualAlloc(0,alloc_size,
 				MEM_COMMIT,PAGE_EXECUTE_READWRITE);
 			if (!cache_code_start_ptr)
-				cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
+				cache_code_start_ptr=(Bit8u*)malloc(alloc_size);
 #else
-			cache_code_start_ptr=(Bit8u*)malloc(CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP-1+PAGESIZE_TEMP);
+#if (C_HAVE_MPROTECT) && defined(MAP_ANONYMOUS)
+			void * mapped=mmap(NULL,alloc_size,PROT_READ|PROT_WRITE|PROT_EXEC,
+				MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,-1,0);
+			if (mapped!=MAP_FAILED) cache_code_start_ptr=(Bit8u*)mapped;
+#endif
+			if (!cache_code_start_ptr)
+				cache_code_start_ptr=(Bit8u*)malloc(alloc_size);
 #endif
 			if(!cache_code_start_ptr) E_Exit("Allocating dynamic cache failed");
+			LOG(LOG_CPU,LOG_DEBUG)("Dynrec: %uKB code cache, %u blocks, %u code pages",
+				(unsigned int)(cache_code_size>>10),(unsigned int)cache_block_count,(unsigned int)cache_page_count);
 
 			// align the cache at a page boundary
 			cache_code=(Bit8u*)(((Bitu)cache_code_start_ptr + PAGESIZE_TEMP-1) & ~(PAGESIZE_TEMP-1));//Bitu is same size as a pointer.
@@ -602,14 +737,14 @@ static void cache_init(bool enable) {
 			cache_code=cache_code+PAGESIZE_TEMP;
 
 #if (C_HAVE_MPROTECT)
-			if(mprotect(cache_code_link_blocks,CACHE_TOTAL+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
+			if(mprotect(cache_code_link_blocks,cache_code_size+CACHE_MAXSIZE+PAGESIZE_TEMP,PROT_WRITE|PROT_READ|PROT_EXEC))
 				LOG_MSG("Setting execute permission on the code cache has failed");
 #endif
 			CacheBlockDynRec * block=cache_getblock();
 			cache.block.first=block;
 			cache.block.active=block;
 			block->cache.start=&cache_code[0];
-			block->cache.size=CACHE_TOTAL;
+			block->cache.size=cache_code_size;
 			block->cache.next=0;						// last block in the list
 		}
 		// setup the default blocks for block linkage returns
@@ -630,8 +765,10 @@ static void cache_init(bool enable) {
 		cache.free_pages=0;
 		cache.last_page=0;
 		cache.used_pages=0;
+		memset(&cache_stats,0,sizeof(cache_stats));
+		cache_stats.wrap_ticks=PIC_Ticks;
 		// setup the code pages
-		for (i=0;i<CACHE_PAGES;i++) {
+		for (i=0;i<(Bits)cache_page_count;i++) {
 			CodePageHandlerDynRec * newpage=new CodePageHandlerDynRec();
 			newpage->next=cache.free_pages;
 			cache.free_pages=newpage;
@@ -23,6 +23,20 @@
 #include "decoder_opcodes.h"
 
 #include "dyn_fpu.h"
+#include "dyn_mmx.h"
+
+/*
+	With paging on, a page fault in a block has to leave the guest at the
+	faulting instruction with none of it done, so the fault handler can
+	restart it. The memory accesses generated here and the stack helpers
+	are checked and exit the block that way. Instructions that are left to
+	functions of the cpu code (far transfers, interrupts, segment loads,
+	string operations, the fpu) access memory unchecked. With paging on
+	they end the block and the normal core runs them, it can restart them.
+*/
+#define DYN_PAGING_FALLBACK() if (GCC_UNLIKELY(decode.paging)) goto illegalopcode
+// segment loads only read descriptors outside of v86 mode
+#define DYN_PAGING_FALLBACK_SEG() if (GCC_UNLIKELY(decode.paging && !(reg_flags & FLAG_VM))) goto illegalopcode
 
 /*
 	The function CreateCacheBlock translates the instruction stream
@@ -45,10 +59,13 @@ static CacheBlockDynRec * CreateCacheBlock(CodePageHandlerDynRec * codepage,Phys
 	codepage->AddCacheBlock(decode.block);
 
 	InitFlagsOptimization();
+	decode.paging=paging.enabled;
 
 	// every codeblock that is run sets cache.block.running to itself
 	// so the block linking knows the last executed block
 	gen_mov_direct_ptr(&cache.block.running,(DRC_PTR_SIZE_IM)decode.block);
+	// tell the allocator the block is in use, linked blocks don't pass the dispatcher
+	gen_mov_direct_dword(&decode.block->hot,1);
 
 	// start with the cycles check
 	gen_mov_word_to_reg(FC_RETOP,&CPU_Cycles,true);
@@ -67,6 +84,11 @@ static CacheBlockDynRec * CreateCacheBlock(CodePageHandlerDynRec * codepage,Phys
 		decode.cycles++;
 		decode.op_start=decode.code;
 restart_prefix:
+		// with paging on a block must not run into the next linear page, a cr3
+		// reload can map another physical page there without touching the code
+		// page of this block. instructions (up to 15 bytes) that may cross the
+		// page end are left to the normal core
+		if (GCC_UNLIKELY(decode.paging && (decode.page.index>4096-15))) goto illegalopcode;
 		Bitu opcode;
 		if (!decode.page.invmap) opcode=decode_fetchb();
 		else {
@@ -150,9 +172,9 @@ restart_prefix:
 		case 0x1e:dyn_push_seg(DRC_SEG_DS);break;
 
 		// pop segment register from stack
-		case 0x07:dyn_pop_seg(DRC_SEG_ES);break;
-		case 0x17:dyn_pop_seg(DRC_SEG_SS);break;
-		case 0x1f:dyn_pop_seg(DRC_SEG_DS);break;
+		case 0x07:DYN_PAGING_FALLBACK();dyn_pop_seg(DRC_SEG_ES);break;
+		case 0x17:DYN_PAGING_FALLBACK();dyn_pop_seg(DRC_SEG_SS);break;
+		case 0x1f:DYN_PAGING_FALLBACK();dyn_pop_seg(DRC_SEG_DS);break;
 
 		// segment prefixes
 		case 0x26:dyn_segprefix(DRC_SEG_ES);goto restart_prefix;
@@ -174,6 +196,7 @@ restart_prefix:
 			switch (dual_code) {
 				case 0x00:
 					if ((reg_flags & FLAG_VM) || (!cpu.pmode)) goto illegalopcode;
+					DYN_PAGING_FALLBACK();
 					dyn_grp6();
 					break;
 				case 0x01:
@@ -207,9 +230,9 @@ restart_prefix:
 
 				// push/pop segment registers
 				case 0xa0:dyn_push_seg(DRC_SEG_FS);break;
-				case 0xa1:dyn_pop_seg(DRC_SEG_FS);break;
+				case 0xa1:DYN_PAGING_FALLBACK();dyn_pop_seg(DRC_SEG_FS);break;
 				case 0xa8:dyn_push_seg(DRC_SEG_GS);break;
-				case 0xa9:dyn_pop_seg(DRC_SEG_GS);break;
+				case 0xa9:DYN_PAGING_FALLBACK();dyn_pop_seg(DRC_SEG_GS);break;
 
 				// double shift instructions
 				case 0xa4:dyn_dshift_ev_gv(true,true);break;
@@ -223,12 +246,14 @@ restart_prefix:
 				case 0xb4:
 					dyn_get_modrm();
 					if (GCC_UNLIKELY(decode.modrm.mod==3)) goto illegalopcode;
+					DYN_PAGING_FALLBACK_SEG();
 					dyn_load_seg_off_ea(DRC_SEG_FS);
 					break;
 				// lgs
 				case 0xb5:
 					dyn_get_modrm();
 					if (GCC_UNLIKELY(decode.modrm.mod==3)) goto illegalopcode;
+					DYN_PAGING_FALLBACK_SEG();
 					dyn_load_seg_off_ea(DRC_SEG_GS);
 					break;
 
@@ -240,6 +265,16 @@ restart_prefix:
 				case 0xbe:dyn_movx_ev_gb(true);break;
 				case 0xbf:dyn_movx_ev_gw(true);break;
 
+				// mmx instructions
+				case 0x60:case 0x61:case 0x62:case 0x63:case 0x64:case 0x65:case 0x66:case 0x67:
+				case 0x68:case 0x69:case 0x6a:case 0x6b:case 0x6e:case 0x6f:
+				case 0x71:case 0x72:case 0x73:case 0x74:case 0x75:case 0x76:case 0x77:case 0x7e:case 0x7f:
+				case 0xd1:case 0xd2:case 0xd3:case 0xd5:case 0xd8:case 0xd9:case 0xdb:case 0xdc:case 0xdd:case 0xdf:
+				case 0xe1:case 0xe2:case 0xe5:case 0xe8:case 0xe9:case 0xeb:case 0xec:case 0xed:case 0xef:
+				case 0xf1:case 0xf2:case 0xf3:case 0xf5:case 0xf8:case 0xf9:case 0xfa:case 0xfc:case 0xfd:case 0xfe:
+					if (!dyn_mmx(dual_code)) goto illegalopcode;
+					break;
+
 				default:
 #if DYN_LOG
 //					LOG_MSG("Unhandled dual opcode 0F%02X",dual_code);
@@ -268,10 +303,12 @@ restart_prefix:
 		case 0x60:
 			if (decode.big_op) gen_call_function_raw((void *)&dynrec_pusha_dword);
 			else gen_call_function_raw((void *)&dynrec_pusha_word);
+			dyn_check_exception(FC_RETOP);
 			break;
 		case 0x61:
 			if (decode.big_op) gen_call_function_raw((void *)&dynrec_popa_dword);
 			else gen_call_function_raw((void *)&dynrec_popa_word);
+			dyn_check_exception(FC_RETOP);
 			break;
 
 //		case 0x62: BOUND missing
@@ -330,7 +367,7 @@ restart_prefix:
 		case 0x8d:dyn_lea();break;
 
 		// move a value from memory or a 16bit register into a segment register
-		case 0x8e:dyn_mov_seg_ev();break;
+		case 0x8e:DYN_PAGING_FALLBACK_SEG();dyn_mov_seg_ev();break;
 
 		// 'pop []'
 		case 0x8f:dyn_pop_ev();break;
@@ -349,14 +386,16 @@ restart_prefix:
 		// sign-extend ax into dx:ax/sign-extend eax into edx:eax
 		case 0x99:dyn_cwd();break;
 
-		case 0x9a:dyn_call_far_imm();goto finish_block;
+		case 0x9a:DYN_PAGING_FALLBACK();dyn_call_far_imm();goto finish_block;
 
 		case 0x9c:	// pushf
+			DYN_PAGING_FALLBACK();
 			AcquireFlags(FMASK_TEST);
 			gen_call_function_I((void *)&CPU_PUSHF,decode.big_op);
 			dyn_check_exception(FC_RETOP);
 			break;
 		case 0x9d:	// popf
+			DYN_PAGING_FALLBACK();
 			gen_call_function_I((void *)&CPU_POPF,decode.big_op);
 			dyn_check_exception(FC_RETOP);
 			InvalidateFlags();
@@ -384,16 +423,16 @@ restart_prefix:
 //		case 0xa6 to 0xaf string operations, some missing
 
 		// movsb/w/d
-		case 0xa4:dyn_string(STR_MOVSB);break;
-		case 0xa5:dyn_string(decode.big_op ? STR_MOVSD : STR_MOVSW);break;
+		case 0xa4:DYN_PAGING_FALLBACK();dyn_string(STR_MOVSB);break;
+		case 0xa5:DYN_PAGING_FALLBACK();dyn_string(decode.big_op ? STR_MOVSD : STR_MOVSW);break;
 
 		// stosb/w/d
-		case 0xaa:dyn_string(STR_STOSB);break;
-		case 0xab:dyn_string(decode.big_op ? STR_STOSD : STR_STOSW);break;
+		case 0xaa:DYN_PAGING_FALLBACK();dyn_string(STR_STOSB);break;
+		case 0xab:DYN_PAGING_FALLBACK();dyn_string(decode.big_op ? STR_STOSD : STR_STOSW);break;
 
 		// lodsb/w/d
-		case 0xac:dyn_string(STR_LODSB);break;
-		case 0xad:dyn_string(decode.big_op ? STR_LODSD : STR_LODSW);break;
+		case 0xac:DYN_PAGING_FALLBACK();dyn_string(STR_LODSB);break;
+		case 0xad:DYN_PAGING_FALLBACK();dyn_string(decode.big_op ? STR_LODSD : STR_LODSW);break;
 
 
 		// 'test reg8/16/32,imm8/16/32'
@@ -426,28 +465,30 @@ restart_prefix:
 		case 0xc4:
 			dyn_get_modrm();
 			if (GCC_UNLIKELY(decode.modrm.mod==3)) goto illegalopcode;
+			DYN_PAGING_FALLBACK_SEG();
 			dyn_load_seg_off_ea(DRC_SEG_ES);
 			break;
 		// lds
 		case 0xc5:
 			dyn_get_modrm();
 			if (GCC_UNLIKELY(decode.modrm.mod==3)) goto illegalopcode;
+			DYN_PAGING_FALLBACK_SEG();
 			dyn_load_seg_off_ea(DRC_SEG_DS);break;
 
 		// 'mov []/reg8/16/32,imm8/16/32'
 		case 0xc6:dyn_dop_ebib_mov();break;
 		case 0xc7:dyn_dop_eviv_mov();break;
 
-		case 0xc8:dyn_enter();break;
+		case 0xc8:DYN_PAGING_FALLBACK();dyn_enter();break;
 		case 0xc9:dyn_leave();break;
 
 		// retf [param]
-		case 0xca:dyn_ret_far(decode_fetchw());goto finish_block;
-		case 0xcb:dyn_ret_far(0);goto finish_block;
+		case 0xca:DYN_PAGING_FALLBACK();dyn_ret_far(decode_fetchw());goto finish_block;
+		case 0xcb:DYN_PAGING_FALLBACK();dyn_ret_far(0);goto finish_block;
 
 		// int/iret
-		case 0xcd:dyn_interrupt(decode_fetchb());goto finish_block;
-		case 0xcf:dyn_iret();goto finish_block;
+		case 0xcd:DYN_PAGING_FALLBACK();dyn_interrupt(decode_fetchb());goto finish_block;
+		case 0xcf:DYN_PAGING_FALLBACK();dyn_iret();goto finish_block;
 
 //		case 0xd4: AAM missing
 //		case 0xd5: AAD missing
@@ -458,29 +499,19 @@ restart_prefix:
 
 #ifdef CPU_FPU
 		// floating point instructions
-		case 0xd8:
-			dyn_fpu_esc0();
-			break;
-		case 0xd9:
-			dyn_fpu_esc1();
-			break;
-		case 0xda:
-			dyn_fpu_esc2();
-			break;
-		case 0xdb:
-			dyn_fpu_esc3();
-			break;
-		case 0xdc:
-			dyn_fpu_esc4();
-			break;
-		case 0xdd:
-			dyn_fpu_esc5();
-			break;
-		case 0xde:
-			dyn_fpu_esc6();
-			break;
-		case 0xdf:
-			dyn_fpu_esc7();
+		case 0xd8:case 0xd9:case 0xda:case 0xdb:case 0xdc:case 0xdd:case 0xde:case 0xdf:
+			// fpu memory operands are accessed unchecked
+			if (GCC_UNLIKELY(decode.paging) && decode_peek_modrm_mem()) goto illegalopcode;
+			switch (opcode) {
+				case 0xd8:dyn_fpu_esc0();break;
+				case 0xd9:dyn_fpu_esc1();break;
+				case 0xda:dyn_fpu_esc2();break;
+				case 0xdb:dyn_fpu_esc3();break;
+				case 0xdc:dyn_fpu_esc4();break;
+				case 0xdd:dyn_fpu_esc5();break;
+				case 0xde:dyn_fpu_esc6();break;
+				case 0xdf:dyn_fpu_esc7();break;
+			}
 			break;
 #endif
 
@@ -517,6 +548,7 @@ restart_prefix:
 			goto finish_block;
 		// 'jmp far'
 		case 0xea:
+			DYN_PAGING_FALLBACK_SEG();
 			dyn_jmp_far_imm();
 			goto finish_block;
 		// 'jmp short imm8'
@@ -103,6 +103,7 @@ static struct DynDecode {
 	Bitu cycles;			// number cycles used by currently translated code
 	bool seg_prefix_used;	// segment overridden
 	Bit8u seg_prefix;		// segment prefix (if seg_prefix_used==true)
+	bool paging;			// translating with paging on, see DYN_PAGING_FALLBACK
 
 	// block that contains the first instruction translated
 	CacheBlockDynRec * block;
@@ -163,6 +164,7 @@ static bool MakeCodePage(Bitu lin_addr,CodePageHandlerDynRec * &cph) {
 	}
 	// find a free CodePage
 	if (!cache.free_pages) {
+		cache_stats.recycled++;
 		if (cache.used_pages!=decode.page.code) cache.used_pages->ClearRelease();
 		else {
 			// try another page to avoid clearing our source-crosspage
@@ -211,6 +213,13 @@ static void decode_advancepage(void) {
 	decode.page.index=0;
 }
 
+// true if the next byte of the instruction stream is a modrm byte with a memory operand,
+// without consuming it. a byte in the next page counts as a memory operand.
+static bool decode_peek_modrm_mem(void) {
+	if (GCC_UNLIKELY(decode.page.index>=4096)) return true;
+	return (mem_readb(decode.code)>>6)!=3;
+}
+
 // fetch the next byte of the instruction stream
 static Bit8u decode_fetchb(void) {
 	if (GCC_UNLIKELY(decode.page.index>=4096)) {
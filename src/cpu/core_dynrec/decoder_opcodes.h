@@ -398,14 +398,25 @@ static void dyn_lea(void) {
 }
 
 
+// push the value in FC_OP1 onto the stack
+static void dyn_push(bool dword) {
+	if (dword) gen_call_function_raw((void*)&dynrec_push_dword);
+	else gen_call_function_raw((void*)&dynrec_push_word);
+	dyn_check_exception(FC_RETOP);
+}
+
+// pop a value from the stack into reg_dst
+static void dyn_pop(HostReg reg_dst,bool dword) {
+	if (dword) gen_call_function_raw((void*)&dynrec_pop_dword);
+	else gen_call_function_raw((void*)&dynrec_pop_word);
+	dyn_check_exception(FC_RETOP);
+	gen_mov_word_to_reg(reg_dst,&core_dynrec.readdata,dword);
+}
+
 static void dyn_push_seg(Bit8u seg) {
 	MOV_SEG_VAL_TO_HOST_REG(FC_OP1,seg);
-	if (decode.big_op) {
-		gen_extend_word(false,FC_OP1);
-		gen_call_function_raw((void*)&dynrec_push_dword);
-	} else {
-		gen_call_function_raw((void*)&dynrec_push_word);
-	}
+	if (decode.big_op) gen_extend_word(false,FC_OP1);
+	dyn_push(decode.big_op);
 }
 
 static void dyn_pop_seg(Bit8u seg) {
@@ -415,30 +426,23 @@ static void dyn_pop_seg(Bit8u seg) {
 
 static void dyn_push_reg(Bit8u reg) {
 	MOV_REG_WORD_TO_HOST_REG(FC_OP1,reg,decode.big_op);
-	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
-	else gen_call_function_raw((void*)&dynrec_push_word);
+	dyn_push(decode.big_op);
 }
 
 static void dyn_pop_reg(Bit8u reg) {
-	if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
-	else gen_call_function_raw((void*)&dynrec_pop_word);
+	dyn_pop(FC_RETOP,decode.big_op);
 	MOV_REG_WORD_FROM_HOST_REG(FC_RETOP,reg,decode.big_op);
 }
 
 static void dyn_push_byte_imm(Bit8s imm) {
 	gen_mov_dword_to_reg_imm(FC_OP1,(Bit32u)imm);
-	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
-	else gen_call_function_raw((void*)&dynrec_push_word);
+	dyn_push(decode.big_op);
 }
 
 static void dyn_push_word_imm(Bitu imm) {
-	if (decode.big_op) {
-		gen_mov_dword_to_reg_imm(FC_OP1,imm);
-		gen_call_function_raw((void*)&dynrec_push_dword);
-	} else {
-		gen_mov_word_to_reg_imm(FC_OP1,(Bit16u)imm);
-		gen_call_function_raw((void*)&dynrec_push_word);
-	}
+	if (decode.big_op) gen_mov_dword_to_reg_imm(FC_OP1,imm);
+	else gen_mov_word_to_reg_imm(FC_OP1,(Bit16u)imm);
+	dyn_push(decode.big_op);
 }
 
 static void dyn_pop_ev(void) {
@@ -447,8 +451,7 @@ static void dyn_pop_ev(void) {
 		// save original ESP
 		MOV_REG_WORD32_TO_HOST_REG(FC_OP2,DRC_REG_ESP);
 		gen_protect_reg(FC_OP2);
-		if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
-		else gen_call_function_raw((void*)&dynrec_pop_word);
+		dyn_pop(FC_RETOP,decode.big_op);
 		dyn_fill_ea(FC_ADDR);
 		gen_mov_regs(FC_OP2,FC_RETOP);
 		gen_mov_regs(FC_OP1,FC_ADDR);
@@ -462,8 +465,7 @@ static void dyn_pop_ev(void) {
 		dyn_check_exception(FC_RETOP);
 		gen_fill_branch(no_fault);
 	} else {
-		if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
-		else gen_call_function_raw((void*)&dynrec_pop_word);
+		dyn_pop(FC_RETOP,decode.big_op);
 		MOV_REG_WORD_FROM_HOST_REG(FC_RETOP,decode.modrm.rm,decode.big_op);
 	}
 }
@@ -828,6 +830,8 @@ static bool dyn_grp4_eb(void) {
 
 static Bitu dyn_grp4_ev(void) {
 	dyn_get_modrm();
+	// far transfers access memory unchecked, see DYN_PAGING_FALLBACK
+	if (GCC_UNLIKELY(decode.paging) && ((decode.modrm.reg==3) || (decode.modrm.reg==5))) return 2;
 	if (decode.modrm.mod<3) {
 		dyn_fill_ea(FC_ADDR);
 		if ((decode.modrm.reg<2) || (decode.modrm.reg==3) || (decode.modrm.reg==5))  gen_protect_addr_reg();
@@ -851,8 +855,7 @@ static Bitu dyn_grp4_ev(void) {
 		gen_protect_addr_reg();
 		gen_mov_word_to_reg(FC_OP1,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
 		gen_add_imm(FC_OP1,(Bit32u)(decode.code-decode.code_start));
-		if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
-		else gen_call_function_raw((void*)&dynrec_push_word);
+		dyn_push(decode.big_op);
 
 		gen_restore_addr_reg();
 		gen_mov_word_from_reg(FC_ADDR,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
@@ -875,8 +878,7 @@ static Bitu dyn_grp4_ev(void) {
 			decode.big_op,FC_OP2,FC_ADDR,FC_RETOP);
 		return 1;
 	case 0x6:		// PUSH Ev
-		if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
-		else gen_call_function_raw((void*)&dynrec_push_word);
+		dyn_push(decode.big_op);
 		break;
 	default:
 //		IllegalOptionDynrec("dyn_grp4_ev");
@@ -1181,13 +1183,9 @@ static void dyn_loop(LoopTypes type) {
 
 
 static void dyn_ret_near(Bitu bytes) {
+	dyn_pop(FC_RETOP,decode.big_op);
+	if (!decode.big_op) gen_extend_word(false,FC_RETOP);
 	dyn_reduce_cycles();
-
-	if (decode.big_op) gen_call_function_raw((void*)&dynrec_pop_dword);
-	else {
-		gen_call_function_raw((void*)&dynrec_pop_word);
-		gen_extend_word(false,FC_RETOP);
-	}
 	gen_mov_word_from_reg(FC_RETOP,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),true);
 
 	if (bytes) gen_add_direct_word(&reg_esp,bytes,true);
@@ -1200,8 +1198,7 @@ static void dyn_call_near_imm(void) {
 	if (decode.big_op) imm=(Bit32s)decode_fetchd();
 	else imm=(Bit16s)decode_fetchw();
 	dyn_set_eip_end(FC_OP1);
-	if (decode.big_op) gen_call_function_raw((void*)&dynrec_push_dword);
-	else gen_call_function_raw((void*)&dynrec_push_word);
+	dyn_push(decode.big_op);
 
 	dyn_set_eip_end(FC_OP1,imm);
 	gen_mov_word_from_reg(FC_OP1,decode.big_op?(void*)(&reg_eip):(void*)(&reg_ip),decode.big_op);
@@ -1395,44 +1392,77 @@ static void dyn_enter(void) {
 	gen_call_function_III((void *)&CPU_ENTER,decode.big_op,bytes,level);
 }
 
-static void dynrec_leave_word(void) {
-	reg_esp&=cpu.stack.notmask;
-	reg_esp|=(reg_ebp&cpu.stack.mask);
-	reg_bp=(Bit16u)CPU_Pop16();
+// leave, pusha and popa return true on a page fault with all registers untouched,
+// like the stack functions in operators.h
+static bool dynrec_leave_word(void) {
+	Bit32u new_esp=(reg_esp&cpu.stack.notmask)|(reg_ebp&cpu.stack.mask);
+	Bit16u val;
+	if (GCC_UNLIKELY(mem_readw_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),&val))) return true;
+	reg_esp=(new_esp&cpu.stack.notmask)|((new_esp+2)&cpu.stack.mask);
+	reg_bp=val;
+	return false;
 }
 
-static void dynrec_leave_dword(void) {
-	reg_esp&=cpu.stack.notmask;
-	reg_esp|=(reg_ebp&cpu.stack.mask);
-	reg_ebp=CPU_Pop32();
+static bool dynrec_leave_dword(void) {
+	Bit32u new_esp=(reg_esp&cpu.stack.notmask)|(reg_ebp&cpu.stack.mask);
+	Bit32u val;
+	if (GCC_UNLIKELY(mem_readd_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),&val))) return true;
+	reg_esp=(new_esp&cpu.stack.notmask)|((new_esp+4)&cpu.stack.mask);
+	reg_ebp=val;
+	return false;
 }
 
 static void dyn_leave(void) {
 	if (decode.big_op) gen_call_function_raw((void *)dynrec_leave_dword);
 	else gen_call_function_raw((void *)dynrec_leave_word);
+	dyn_check_exception(FC_RETOP);
 }
 
 
-static void dynrec_pusha_word(void) {
-	Bit16u old_sp=reg_sp;
-	CPU_Push16(reg_ax);CPU_Push16(reg_cx);CPU_Push16(reg_dx);CPU_Push16(reg_bx);
-	CPU_Push16(old_sp);CPU_Push16(reg_bp);CPU_Push16(reg_si);CPU_Push16(reg_di);
+static bool dynrec_pusha_word(void) {
+	Bit16u vals[8]={reg_di,reg_si,reg_bp,reg_sp,reg_bx,reg_dx,reg_cx,reg_ax};
+	Bit32u new_esp=reg_esp;
+	for (Bitu i=0;i<8;i++) {
+		new_esp=(new_esp&cpu.stack.notmask)|((new_esp-2)&cpu.stack.mask);
+		if (GCC_UNLIKELY(mem_writew_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),vals[7-i]))) return true;
+	}
+	reg_esp=new_esp;
+	return false;
 }
 
-static void dynrec_pusha_dword(void) {
-	Bitu tmpesp = reg_esp;
-	CPU_Push32(reg_eax);CPU_Push32(reg_ecx);CPU_Push32(reg_edx);CPU_Push32(reg_ebx);
-	CPU_Push32(tmpesp);CPU_Push32(reg_ebp);CPU_Push32(reg_esi);CPU_Push32(reg_edi);
+static bool dynrec_pusha_dword(void) {
+	Bit32u vals[8]={reg_edi,reg_esi,reg_ebp,reg_esp,reg_ebx,reg_edx,reg_ecx,reg_eax};
+	Bit32u new_esp=reg_esp;
+	for (Bitu i=0;i<8;i++) {
+		new_esp=(new_esp&cpu.stack.notmask)|((new_esp-4)&cpu.stack.mask);
+		if (GCC_UNLIKELY(mem_writed_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),vals[7-i]))) return true;
+	}
+	reg_esp=new_esp;
+	return false;
 }
 
-static void dynrec_popa_word(void) {
-	reg_di=(Bit16u)CPU_Pop16();reg_si=(Bit16u)CPU_Pop16();
-	reg_bp=(Bit16u)CPU_Pop16();CPU_Pop16();		//Don't save SP
-	reg_bx=(Bit16u)CPU_Pop16();reg_dx=(Bit16u)CPU_Pop16();
-	reg_cx=(Bit16u)CPU_Pop16();reg_ax=(Bit16u)CPU_Pop16();
+static bool dynrec_popa_word(void) {
+	Bit16u vals[8];
+	Bit32u new_esp=reg_esp;
+	for (Bitu i=0;i<8;i++) {
+		if (GCC_UNLIKELY(mem_readw_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),&vals[i]))) return true;
+		new_esp=(new_esp&cpu.stack.notmask)|((new_esp+2)&cpu.stack.mask);
+	}
+	reg_esp=new_esp;
+	reg_di=vals[0];reg_si=vals[1];reg_bp=vals[2];		//Don't save SP
+	reg_bx=vals[4];reg_dx=vals[5];reg_cx=vals[6];reg_ax=vals[7];
+	return false;
 }
 
-static void dynrec_popa_dword(void) {
-	reg_edi=CPU_Pop32();reg_esi=CPU_Pop32();reg_ebp=CPU_Pop32();CPU_Pop32();	//Don't save ESP
-	reg_ebx=CPU_Pop32();reg_edx=CPU_Pop32();reg_ecx=CPU_Pop32();reg_eax=CPU_Pop32();
+static bool dynrec_popa_dword(void) {
+	Bit32u vals[8];
+	Bit32u new_esp=reg_esp;
+	for (Bitu i=0;i<8;i++) {
+		if (GCC_UNLIKELY(mem_readd_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),&vals[i]))) return true;
+		new_esp=(new_esp&cpu.stack.notmask)|((new_esp+4)&cpu.stack.mask);
+	}
+	reg_esp=new_esp;
+	reg_edi=vals[0];reg_esi=vals[1];reg_ebp=vals[2];	//Don't save ESP
+	reg_ebx=vals[4];reg_edx=vals[5];reg_ecx=vals[6];reg_eax=vals[7];
+	return false;
 }
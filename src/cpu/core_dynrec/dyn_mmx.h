@@ -0,0 +1,651 @@
+/*
+ *  Copyright (C) 2002-2018  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+	MMX instructions for the recompiler core.
+
+	The MMX registers stay in reg_mmx[] (they are not aliased onto the FPU
+	stack in DOSBox), so nothing has to be flushed around them and EMMS only
+	resets the FPU tag word, exactly like the normal core does.
+	Register and memory moves are generated inline through the 32bit
+	load/store primitives every backend provides; the packed arithmetic is
+	done by small helper functions. A memory source operand is first fetched
+	into dyn_mmx_ea (with the usual exception checks) and then handed to the
+	helper as "register" 8.
+	The normal core only decodes MMX with a 32bit operand size (and does so
+	whatever the CPU type), so the same set is translated here and anything
+	else is still left to it.
+	dyn_read_word/dyn_write_word may clobber FC_ADDR, so it is protected
+	when the second half of a 64bit operand needs it.
+*/
+
+#include "mmx.h"
+
+static MMX_reg dyn_mmx_ea;
+
+#define DYN_MMX_EA 8
+
+static INLINE MMX_reg * dyn_mmx_src(Bitu src) {
+	return (src == DYN_MMX_EA) ? &dyn_mmx_ea : &reg_mmx[src];
+}
+
+static void dyn_mmx_emms(void) {
+	setFPU(TAG_Empty);
+}
+
+
+/* Shift helpers, count is the full 64bit count as with the normal core */
+
+static void dyn_mmx_sllw(MMX_reg * dest,Bit64u count) {
+	if (count > 15) dest->q = 0;
+	else {
+		dest->uw.w0 <<= count;
+		dest->uw.w1 <<= count;
+		dest->uw.w2 <<= count;
+		dest->uw.w3 <<= count;
+	}
+}
+
+static void dyn_mmx_srlw(MMX_reg * dest,Bit64u count) {
+	if (count > 15) dest->q = 0;
+	else {
+		dest->uw.w0 >>= count;
+		dest->uw.w1 >>= count;
+		dest->uw.w2 >>= count;
+		dest->uw.w3 >>= count;
+	}
+}
+
+static void dyn_mmx_sraw(MMX_reg * dest,Bit64u count) {
+	if (count > 15) count = 15;
+	dest->uw.w0 = (Bit16u)((Bit16s)dest->uw.w0 >> count);
+	dest->uw.w1 = (Bit16u)((Bit16s)dest->uw.w1 >> count);
+	dest->uw.w2 = (Bit16u)((Bit16s)dest->uw.w2 >> count);
+	dest->uw.w3 = (Bit16u)((Bit16s)dest->uw.w3 >> count);
+}
+
+static void dyn_mmx_slld(MMX_reg * dest,Bit64u count) {
+	if (count > 31) dest->q = 0;
+	else {
+		dest->ud.d0 <<= count;
+		dest->ud.d1 <<= count;
+	}
+}
+
+static void dyn_mmx_srld(MMX_reg * dest,Bit64u count) {
+	if (count > 31) dest->q = 0;
+	else {
+		dest->ud.d0 >>= count;
+		dest->ud.d1 >>= count;
+	}
+}
+
+static void dyn_mmx_srad(MMX_reg * dest,Bit64u count) {
+	if (count > 31) count = 31;
+	dest->ud.d0 = (Bit32u)((Bit32s)dest->ud.d0 >> count);
+	dest->ud.d1 = (Bit32u)((Bit32s)dest->ud.d1 >> count);
+}
+
+static void dyn_mmx_sllq(MMX_reg * dest,Bit64u count) {
+	if (count > 63) dest->q = 0;
+	else dest->q <<= count;
+}
+
+static void dyn_mmx_srlq(MMX_reg * dest,Bit64u count) {
+	if (count > 63) dest->q = 0;
+	else dest->q >>= count;
+}
+
+static void dyn_mmx_psllw(Bitu dest,Bitu src) { dyn_mmx_sllw(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_psrlw(Bitu dest,Bitu src) { dyn_mmx_srlw(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_psraw(Bitu dest,Bitu src) { dyn_mmx_sraw(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_pslld(Bitu dest,Bitu src) { dyn_mmx_slld(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_psrld(Bitu dest,Bitu src) { dyn_mmx_srld(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_psrad(Bitu dest,Bitu src) { dyn_mmx_srad(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_psllq(Bitu dest,Bitu src) { dyn_mmx_sllq(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+static void dyn_mmx_psrlq(Bitu dest,Bitu src) { dyn_mmx_srlq(&reg_mmx[dest],dyn_mmx_src(src)->q); }
+
+static void dyn_mmx_psllw_imm(Bitu dest,Bitu count) { dyn_mmx_sllw(&reg_mmx[dest],count); }
+static void dyn_mmx_psrlw_imm(Bitu dest,Bitu count) { dyn_mmx_srlw(&reg_mmx[dest],count); }
+static void dyn_mmx_psraw_imm(Bitu dest,Bitu count) { dyn_mmx_sraw(&reg_mmx[dest],count); }
+static void dyn_mmx_pslld_imm(Bitu dest,Bitu count) { dyn_mmx_slld(&reg_mmx[dest],count); }
+static void dyn_mmx_psrld_imm(Bitu dest,Bitu count) { dyn_mmx_srld(&reg_mmx[dest],count); }
+static void dyn_mmx_psrad_imm(Bitu dest,Bitu count) { dyn_mmx_srad(&reg_mmx[dest],count); }
+static void dyn_mmx_psllq_imm(Bitu dest,Bitu count) { dyn_mmx_sllq(&reg_mmx[dest],count); }
+static void dyn_mmx_psrlq_imm(Bitu dest,Bitu count) { dyn_mmx_srlq(&reg_mmx[dest],count); }
+
+
+/* Boolean logic */
+
+static void dyn_mmx_pand(Bitu dest,Bitu src)  { reg_mmx[dest].q &= dyn_mmx_src(src)->q; }
+static void dyn_mmx_pandn(Bitu dest,Bitu src) { reg_mmx[dest].q = ~reg_mmx[dest].q & dyn_mmx_src(src)->q; }
+static void dyn_mmx_por(Bitu dest,Bitu src)   { reg_mmx[dest].q |= dyn_mmx_src(src)->q; }
+static void dyn_mmx_pxor(Bitu dest,Bitu src)  { reg_mmx[dest].q ^= dyn_mmx_src(src)->q; }
+
+
+/* Math */
+
+static void dyn_mmx_paddb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 += src.ub.b0;
+	dest->ub.b1 += src.ub.b1;
+	dest->ub.b2 += src.ub.b2;
+	dest->ub.b3 += src.ub.b3;
+	dest->ub.b4 += src.ub.b4;
+	dest->ub.b5 += src.ub.b5;
+	dest->ub.b6 += src.ub.b6;
+	dest->ub.b7 += src.ub.b7;
+}
+
+static void dyn_mmx_paddw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 += src.uw.w0;
+	dest->uw.w1 += src.uw.w1;
+	dest->uw.w2 += src.uw.w2;
+	dest->uw.w3 += src.uw.w3;
+}
+
+static void dyn_mmx_paddd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ud.d0 += src.ud.d0;
+	dest->ud.d1 += src.ud.d1;
+}
+
+static void dyn_mmx_paddsb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->sb.b0 = SaturateWordSToByteS((Bit16s)dest->sb.b0+(Bit16s)src.sb.b0);
+	dest->sb.b1 = SaturateWordSToByteS((Bit16s)dest->sb.b1+(Bit16s)src.sb.b1);
+	dest->sb.b2 = SaturateWordSToByteS((Bit16s)dest->sb.b2+(Bit16s)src.sb.b2);
+	dest->sb.b3 = SaturateWordSToByteS((Bit16s)dest->sb.b3+(Bit16s)src.sb.b3);
+	dest->sb.b4 = SaturateWordSToByteS((Bit16s)dest->sb.b4+(Bit16s)src.sb.b4);
+	dest->sb.b5 = SaturateWordSToByteS((Bit16s)dest->sb.b5+(Bit16s)src.sb.b5);
+	dest->sb.b6 = SaturateWordSToByteS((Bit16s)dest->sb.b6+(Bit16s)src.sb.b6);
+	dest->sb.b7 = SaturateWordSToByteS((Bit16s)dest->sb.b7+(Bit16s)src.sb.b7);
+}
+
+static void dyn_mmx_paddsw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->sw.w0 = SaturateDwordSToWordS((Bit32s)dest->sw.w0+(Bit32s)src.sw.w0);
+	dest->sw.w1 = SaturateDwordSToWordS((Bit32s)dest->sw.w1+(Bit32s)src.sw.w1);
+	dest->sw.w2 = SaturateDwordSToWordS((Bit32s)dest->sw.w2+(Bit32s)src.sw.w2);
+	dest->sw.w3 = SaturateDwordSToWordS((Bit32s)dest->sw.w3+(Bit32s)src.sw.w3);
+}
+
+static void dyn_mmx_paddusb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 = SaturateWordSToByteU((Bit16s)dest->ub.b0+(Bit16s)src.ub.b0);
+	dest->ub.b1 = SaturateWordSToByteU((Bit16s)dest->ub.b1+(Bit16s)src.ub.b1);
+	dest->ub.b2 = SaturateWordSToByteU((Bit16s)dest->ub.b2+(Bit16s)src.ub.b2);
+	dest->ub.b3 = SaturateWordSToByteU((Bit16s)dest->ub.b3+(Bit16s)src.ub.b3);
+	dest->ub.b4 = SaturateWordSToByteU((Bit16s)dest->ub.b4+(Bit16s)src.ub.b4);
+	dest->ub.b5 = SaturateWordSToByteU((Bit16s)dest->ub.b5+(Bit16s)src.ub.b5);
+	dest->ub.b6 = SaturateWordSToByteU((Bit16s)dest->ub.b6+(Bit16s)src.ub.b6);
+	dest->ub.b7 = SaturateWordSToByteU((Bit16s)dest->ub.b7+(Bit16s)src.ub.b7);
+}
+
+static void dyn_mmx_paddusw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 = SaturateDwordSToWordU((Bit32s)dest->uw.w0+(Bit32s)src.uw.w0);
+	dest->uw.w1 = SaturateDwordSToWordU((Bit32s)dest->uw.w1+(Bit32s)src.uw.w1);
+	dest->uw.w2 = SaturateDwordSToWordU((Bit32s)dest->uw.w2+(Bit32s)src.uw.w2);
+	dest->uw.w3 = SaturateDwordSToWordU((Bit32s)dest->uw.w3+(Bit32s)src.uw.w3);
+}
+
+static void dyn_mmx_psubb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 -= src.ub.b0;
+	dest->ub.b1 -= src.ub.b1;
+	dest->ub.b2 -= src.ub.b2;
+	dest->ub.b3 -= src.ub.b3;
+	dest->ub.b4 -= src.ub.b4;
+	dest->ub.b5 -= src.ub.b5;
+	dest->ub.b6 -= src.ub.b6;
+	dest->ub.b7 -= src.ub.b7;
+}
+
+static void dyn_mmx_psubw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 -= src.uw.w0;
+	dest->uw.w1 -= src.uw.w1;
+	dest->uw.w2 -= src.uw.w2;
+	dest->uw.w3 -= src.uw.w3;
+}
+
+static void dyn_mmx_psubd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ud.d0 -= src.ud.d0;
+	dest->ud.d1 -= src.ud.d1;
+}
+
+static void dyn_mmx_psubsb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->sb.b0 = SaturateWordSToByteS((Bit16s)dest->sb.b0-(Bit16s)src.sb.b0);
+	dest->sb.b1 = SaturateWordSToByteS((Bit16s)dest->sb.b1-(Bit16s)src.sb.b1);
+	dest->sb.b2 = SaturateWordSToByteS((Bit16s)dest->sb.b2-(Bit16s)src.sb.b2);
+	dest->sb.b3 = SaturateWordSToByteS((Bit16s)dest->sb.b3-(Bit16s)src.sb.b3);
+	dest->sb.b4 = SaturateWordSToByteS((Bit16s)dest->sb.b4-(Bit16s)src.sb.b4);
+	dest->sb.b5 = SaturateWordSToByteS((Bit16s)dest->sb.b5-(Bit16s)src.sb.b5);
+	dest->sb.b6 = SaturateWordSToByteS((Bit16s)dest->sb.b6-(Bit16s)src.sb.b6);
+	dest->sb.b7 = SaturateWordSToByteS((Bit16s)dest->sb.b7-(Bit16s)src.sb.b7);
+}
+
+static void dyn_mmx_psubsw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->sw.w0 = SaturateDwordSToWordS((Bit32s)dest->sw.w0-(Bit32s)src.sw.w0);
+	dest->sw.w1 = SaturateDwordSToWordS((Bit32s)dest->sw.w1-(Bit32s)src.sw.w1);
+	dest->sw.w2 = SaturateDwordSToWordS((Bit32s)dest->sw.w2-(Bit32s)src.sw.w2);
+	dest->sw.w3 = SaturateDwordSToWordS((Bit32s)dest->sw.w3-(Bit32s)src.sw.w3);
+}
+
+static void dyn_mmx_psubusb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	MMX_reg result;
+	result.q = 0;
+	if (dest->ub.b0>src.ub.b0) result.ub.b0 = dest->ub.b0 - src.ub.b0;
+	if (dest->ub.b1>src.ub.b1) result.ub.b1 = dest->ub.b1 - src.ub.b1;
+	if (dest->ub.b2>src.ub.b2) result.ub.b2 = dest->ub.b2 - src.ub.b2;
+	if (dest->ub.b3>src.ub.b3) result.ub.b3 = dest->ub.b3 - src.ub.b3;
+	if (dest->ub.b4>src.ub.b4) result.ub.b4 = dest->ub.b4 - src.ub.b4;
+	if (dest->ub.b5>src.ub.b5) result.ub.b5 = dest->ub.b5 - src.ub.b5;
+	if (dest->ub.b6>src.ub.b6) result.ub.b6 = dest->ub.b6 - src.ub.b6;
+	if (dest->ub.b7>src.ub.b7) result.ub.b7 = dest->ub.b7 - src.ub.b7;
+	dest->q = result.q;
+}
+
+static void dyn_mmx_psubusw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	MMX_reg result;
+	result.q = 0;
+	if (dest->uw.w0>src.uw.w0) result.uw.w0 = dest->uw.w0 - src.uw.w0;
+	if (dest->uw.w1>src.uw.w1) result.uw.w1 = dest->uw.w1 - src.uw.w1;
+	if (dest->uw.w2>src.uw.w2) result.uw.w2 = dest->uw.w2 - src.uw.w2;
+	if (dest->uw.w3>src.uw.w3) result.uw.w3 = dest->uw.w3 - src.uw.w3;
+	dest->q = result.q;
+}
+
+static void dyn_mmx_pmulhw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 = (Bit16u)(((Bit32s)dest->sw.w0 * (Bit32s)src.sw.w0) >> 16);
+	dest->uw.w1 = (Bit16u)(((Bit32s)dest->sw.w1 * (Bit32s)src.sw.w1) >> 16);
+	dest->uw.w2 = (Bit16u)(((Bit32s)dest->sw.w2 * (Bit32s)src.sw.w2) >> 16);
+	dest->uw.w3 = (Bit16u)(((Bit32s)dest->sw.w3 * (Bit32s)src.sw.w3) >> 16);
+}
+
+static void dyn_mmx_pmullw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 = (Bit16u)((Bit32u)dest->uw.w0 * (Bit32u)src.uw.w0);
+	dest->uw.w1 = (Bit16u)((Bit32u)dest->uw.w1 * (Bit32u)src.uw.w1);
+	dest->uw.w2 = (Bit16u)((Bit32u)dest->uw.w2 * (Bit32u)src.uw.w2);
+	dest->uw.w3 = (Bit16u)((Bit32u)dest->uw.w3 * (Bit32u)src.uw.w3);
+}
+
+static void dyn_mmx_pmaddwd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	if (dest->ud.d0 == 0x80008000 && src.ud.d0 == 0x80008000)
+		dest->ud.d0 = 0x80000000;
+	else
+		dest->sd.d0 = (Bit32s)dest->sw.w0 * (Bit32s)src.sw.w0 + (Bit32s)dest->sw.w1 * (Bit32s)src.sw.w1;
+	if (dest->ud.d1 == 0x80008000 && src.ud.d1 == 0x80008000)
+		dest->ud.d1 = 0x80000000;
+	else
+		dest->sd.d1 = (Bit32s)dest->sw.w2 * (Bit32s)src.sw.w2 + (Bit32s)dest->sw.w3 * (Bit32s)src.sw.w3;
+}
+
+
+/* Comparison */
+
+static void dyn_mmx_pcmpeqb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 = dest->ub.b0==src.ub.b0?0xff:0;
+	dest->ub.b1 = dest->ub.b1==src.ub.b1?0xff:0;
+	dest->ub.b2 = dest->ub.b2==src.ub.b2?0xff:0;
+	dest->ub.b3 = dest->ub.b3==src.ub.b3?0xff:0;
+	dest->ub.b4 = dest->ub.b4==src.ub.b4?0xff:0;
+	dest->ub.b5 = dest->ub.b5==src.ub.b5?0xff:0;
+	dest->ub.b6 = dest->ub.b6==src.ub.b6?0xff:0;
+	dest->ub.b7 = dest->ub.b7==src.ub.b7?0xff:0;
+}
+
+static void dyn_mmx_pcmpeqw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 = dest->uw.w0==src.uw.w0?0xffff:0;
+	dest->uw.w1 = dest->uw.w1==src.uw.w1?0xffff:0;
+	dest->uw.w2 = dest->uw.w2==src.uw.w2?0xffff:0;
+	dest->uw.w3 = dest->uw.w3==src.uw.w3?0xffff:0;
+}
+
+static void dyn_mmx_pcmpeqd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ud.d0 = dest->ud.d0==src.ud.d0?0xffffffff:0;
+	dest->ud.d1 = dest->ud.d1==src.ud.d1?0xffffffff:0;
+}
+
+static void dyn_mmx_pcmpgtb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 = dest->sb.b0>src.sb.b0?0xff:0;
+	dest->ub.b1 = dest->sb.b1>src.sb.b1?0xff:0;
+	dest->ub.b2 = dest->sb.b2>src.sb.b2?0xff:0;
+	dest->ub.b3 = dest->sb.b3>src.sb.b3?0xff:0;
+	dest->ub.b4 = dest->sb.b4>src.sb.b4?0xff:0;
+	dest->ub.b5 = dest->sb.b5>src.sb.b5?0xff:0;
+	dest->ub.b6 = dest->sb.b6>src.sb.b6?0xff:0;
+	dest->ub.b7 = dest->sb.b7>src.sb.b7?0xff:0;
+}
+
+static void dyn_mmx_pcmpgtw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 = dest->sw.w0>src.sw.w0?0xffff:0;
+	dest->uw.w1 = dest->sw.w1>src.sw.w1?0xffff:0;
+	dest->uw.w2 = dest->sw.w2>src.sw.w2?0xffff:0;
+	dest->uw.w3 = dest->sw.w3>src.sw.w3?0xffff:0;
+}
+
+static void dyn_mmx_pcmpgtd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ud.d0 = dest->sd.d0>src.sd.d0?0xffffffff:0;
+	dest->ud.d1 = dest->sd.d1>src.sd.d1?0xffffffff:0;
+}
+
+
+/* Data packing */
+
+static void dyn_mmx_packsswb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->sb.b0 = SaturateWordSToByteS(dest->sw.w0);
+	dest->sb.b1 = SaturateWordSToByteS(dest->sw.w1);
+	dest->sb.b2 = SaturateWordSToByteS(dest->sw.w2);
+	dest->sb.b3 = SaturateWordSToByteS(dest->sw.w3);
+	dest->sb.b4 = SaturateWordSToByteS(src.sw.w0);
+	dest->sb.b5 = SaturateWordSToByteS(src.sw.w1);
+	dest->sb.b6 = SaturateWordSToByteS(src.sw.w2);
+	dest->sb.b7 = SaturateWordSToByteS(src.sw.w3);
+}
+
+static void dyn_mmx_packssdw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->sw.w0 = SaturateDwordSToWordS(dest->sd.d0);
+	dest->sw.w1 = SaturateDwordSToWordS(dest->sd.d1);
+	dest->sw.w2 = SaturateDwordSToWordS(src.sd.d0);
+	dest->sw.w3 = SaturateDwordSToWordS(src.sd.d1);
+}
+
+static void dyn_mmx_packuswb(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 = SaturateWordSToByteU(dest->sw.w0);
+	dest->ub.b1 = SaturateWordSToByteU(dest->sw.w1);
+	dest->ub.b2 = SaturateWordSToByteU(dest->sw.w2);
+	dest->ub.b3 = SaturateWordSToByteU(dest->sw.w3);
+	dest->ub.b4 = SaturateWordSToByteU(src.sw.w0);
+	dest->ub.b5 = SaturateWordSToByteU(src.sw.w1);
+	dest->ub.b6 = SaturateWordSToByteU(src.sw.w2);
+	dest->ub.b7 = SaturateWordSToByteU(src.sw.w3);
+}
+
+static void dyn_mmx_punpckhbw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b0 = dest->ub.b4;
+	dest->ub.b1 = src.ub.b4;
+	dest->ub.b2 = dest->ub.b5;
+	dest->ub.b3 = src.ub.b5;
+	dest->ub.b4 = dest->ub.b6;
+	dest->ub.b5 = src.ub.b6;
+	dest->ub.b6 = dest->ub.b7;
+	dest->ub.b7 = src.ub.b7;
+}
+
+static void dyn_mmx_punpckhwd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w0 = dest->uw.w2;
+	dest->uw.w1 = src.uw.w2;
+	dest->uw.w2 = dest->uw.w3;
+	dest->uw.w3 = src.uw.w3;
+}
+
+static void dyn_mmx_punpckhdq(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ud.d0 = dest->ud.d1;
+	dest->ud.d1 = src.ud.d1;
+}
+
+static void dyn_mmx_punpcklbw(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ub.b7 = src.ub.b3;
+	dest->ub.b6 = dest->ub.b3;
+	dest->ub.b5 = src.ub.b2;
+	dest->ub.b4 = dest->ub.b2;
+	dest->ub.b3 = src.ub.b1;
+	dest->ub.b2 = dest->ub.b1;
+	dest->ub.b1 = src.ub.b0;
+}
+
+static void dyn_mmx_punpcklwd(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->uw.w3 = src.uw.w1;
+	dest->uw.w2 = dest->uw.w1;
+	dest->uw.w1 = src.uw.w0;
+}
+
+static void dyn_mmx_punpckldq(Bitu dest_idx,Bitu src_idx) {
+	MMX_reg * dest=&reg_mmx[dest_idx];
+	MMX_reg src=*dyn_mmx_src(src_idx);
+	dest->ud.d1 = src.ud.d0;
+}
+
+
+/* Code generation */
+
+// fetch the 64bit memory operand into dyn_mmx_ea, FC_ADDR holds the address
+static void dyn_mmx_read_ea(void) {
+	dyn_fill_ea(FC_ADDR);
+	gen_protect_addr_reg();
+	dyn_read_word(FC_ADDR,FC_OP1,true);
+	gen_mov_word_from_reg(FC_OP1,&dyn_mmx_ea.ud.d0,true);
+	gen_restore_addr_reg();
+	gen_add_imm(FC_ADDR,4);
+	dyn_read_word(FC_ADDR,FC_OP1,true);
+	gen_mov_word_from_reg(FC_OP1,&dyn_mmx_ea.ud.d1,true);
+}
+
+// op Pq,Qq with the operation done by a helper function
+static void dyn_mmx_op(void * func) {
+	if (decode.modrm.mod==3) {
+		gen_call_function_II(func,decode.modrm.reg,decode.modrm.rm);
+	} else {
+		dyn_mmx_read_ea();
+		gen_call_function_II(func,decode.modrm.reg,DYN_MMX_EA);
+	}
+}
+
+// the normal core ignores the undefined encodings of the 0x71/0x72 groups
+static void dyn_mmx_shift_imm(void * left,void * right_logical,void * right_arith) {
+	Bitu count=decode_fetchb();
+	void * func=NULL;
+	switch (decode.modrm.reg) {
+		case 0x02:func=right_logical;break;
+		case 0x04:func=right_arith;break;
+		case 0x06:func=left;break;
+	}
+	if (func!=NULL) gen_call_function_II(func,decode.modrm.rm,count);
+}
+
+// and treats every 0x73 encoding as a left (reg&4) or right shift
+static void dyn_mmx_shift_imm_q(void) {
+	Bitu count=decode_fetchb();
+	if (decode.modrm.reg&4) gen_call_function_II((void*)&dyn_mmx_psllq_imm,decode.modrm.rm,count);
+	else gen_call_function_II((void*)&dyn_mmx_psrlq_imm,decode.modrm.rm,count);
+}
+
+// returns false if the instruction has to be left to the normal core
+static bool dyn_mmx(Bitu dual_code) {
+	if (!decode.big_op) return false;
+
+	if (dual_code==0x77) {		// EMMS
+		gen_call_function_raw((void*)&dyn_mmx_emms);
+		return true;
+	}
+
+	dyn_get_modrm();
+	switch (dual_code) {
+		case 0x6e:		// MOVD Pq,Ed
+			if (decode.modrm.mod==3) {
+				MOV_REG_WORD32_TO_HOST_REG(FC_OP1,decode.modrm.rm);
+			} else {
+				dyn_fill_ea(FC_ADDR);
+				dyn_read_word(FC_ADDR,FC_OP1,true);
+			}
+			gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d0,true);
+			gen_mov_direct_dword(&reg_mmx[decode.modrm.reg].ud.d1,0);
+			break;
+		case 0x7e:		// MOVD Ed,Pq
+			if (decode.modrm.mod==3) {
+				gen_mov_word_to_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d0,true);
+				MOV_REG_WORD32_FROM_HOST_REG(FC_OP1,decode.modrm.rm);
+			} else {
+				dyn_fill_ea(FC_ADDR);
+				gen_mov_word_to_reg(FC_OP2,&reg_mmx[decode.modrm.reg].ud.d0,true);
+				dyn_write_word(FC_ADDR,FC_OP2,true);
+			}
+			break;
+		case 0x6f:		// MOVQ Pq,Qq
+			if (decode.modrm.mod==3) {
+				gen_mov_word_to_reg(FC_OP1,&reg_mmx[decode.modrm.rm].ud.d0,true);
+				gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d0,true);
+				gen_mov_word_to_reg(FC_OP1,&reg_mmx[decode.modrm.rm].ud.d1,true);
+				gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d1,true);
+			} else {
+				// both halves are read before the register is touched
+				dyn_mmx_read_ea();
+				gen_mov_word_to_reg(FC_OP1,&dyn_mmx_ea.ud.d0,true);
+				gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d0,true);
+				gen_mov_word_to_reg(FC_OP1,&dyn_mmx_ea.ud.d1,true);
+				gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d1,true);
+			}
+			break;
+		case 0x7f:		// MOVQ Qq,Pq
+			if (decode.modrm.mod==3) {
+				gen_mov_word_to_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d0,true);
+				gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.rm].ud.d0,true);
+				gen_mov_word_to_reg(FC_OP1,&reg_mmx[decode.modrm.reg].ud.d1,true);
+				gen_mov_word_from_reg(FC_OP1,&reg_mmx[decode.modrm.rm].ud.d1,true);
+			} else {
+				dyn_fill_ea(FC_ADDR);
+				gen_protect_addr_reg();
+				gen_mov_word_to_reg(FC_OP2,&reg_mmx[decode.modrm.reg].ud.d0,true);
+				dyn_write_word(FC_ADDR,FC_OP2,true);
+				gen_restore_addr_reg();
+				gen_add_imm(FC_ADDR,4);
+				gen_mov_word_to_reg(FC_OP2,&reg_mmx[decode.modrm.reg].ud.d1,true);
+				dyn_write_word(FC_ADDR,FC_OP2,true);
+			}
+			break;
+
+		case 0x71:
+			if (decode.modrm.mod!=3) return false;
+			dyn_mmx_shift_imm((void*)&dyn_mmx_psllw_imm,(void*)&dyn_mmx_psrlw_imm,(void*)&dyn_mmx_psraw_imm);
+			break;
+		case 0x72:
+			if (decode.modrm.mod!=3) return false;
+			dyn_mmx_shift_imm((void*)&dyn_mmx_pslld_imm,(void*)&dyn_mmx_psrld_imm,(void*)&dyn_mmx_psrad_imm);
+			break;
+		case 0x73:
+			if (decode.modrm.mod!=3) return false;
+			dyn_mmx_shift_imm_q();
+			break;
+
+		case 0x60:dyn_mmx_op((void*)&dyn_mmx_punpcklbw);break;
+		case 0x61:dyn_mmx_op((void*)&dyn_mmx_punpcklwd);break;
+		case 0x62:dyn_mmx_op((void*)&dyn_mmx_punpckldq);break;
+		case 0x63:dyn_mmx_op((void*)&dyn_mmx_packsswb);break;
+		case 0x64:dyn_mmx_op((void*)&dyn_mmx_pcmpgtb);break;
+		case 0x65:dyn_mmx_op((void*)&dyn_mmx_pcmpgtw);break;
+		case 0x66:dyn_mmx_op((void*)&dyn_mmx_pcmpgtd);break;
+		case 0x67:dyn_mmx_op((void*)&dyn_mmx_packuswb);break;
+		case 0x68:dyn_mmx_op((void*)&dyn_mmx_punpckhbw);break;
+		case 0x69:dyn_mmx_op((void*)&dyn_mmx_punpckhwd);break;
+		case 0x6a:dyn_mmx_op((void*)&dyn_mmx_punpckhdq);break;
+		case 0x6b:dyn_mmx_op((void*)&dyn_mmx_packssdw);break;
+		case 0x74:dyn_mmx_op((void*)&dyn_mmx_pcmpeqb);break;
+		case 0x75:dyn_mmx_op((void*)&dyn_mmx_pcmpeqw);break;
+		case 0x76:dyn_mmx_op((void*)&dyn_mmx_pcmpeqd);break;
+
+		case 0xd1:dyn_mmx_op((void*)&dyn_mmx_psrlw);break;
+		case 0xd2:dyn_mmx_op((void*)&dyn_mmx_psrld);break;
+		case 0xd3:dyn_mmx_op((void*)&dyn_mmx_psrlq);break;
+		case 0xd5:dyn_mmx_op((void*)&dyn_mmx_pmullw);break;
+		case 0xd8:dyn_mmx_op((void*)&dyn_mmx_psubusb);break;
+		case 0xd9:dyn_mmx_op((void*)&dyn_mmx_psubusw);break;
+		case 0xdb:dyn_mmx_op((void*)&dyn_mmx_pand);break;
+		case 0xdc:dyn_mmx_op((void*)&dyn_mmx_paddusb);break;
+		case 0xdd:dyn_mmx_op((void*)&dyn_mmx_paddusw);break;
+		case 0xdf:dyn_mmx_op((void*)&dyn_mmx_pandn);break;
+		case 0xe1:dyn_mmx_op((void*)&dyn_mmx_psraw);break;
+		case 0xe2:dyn_mmx_op((void*)&dyn_mmx_psrad);break;
+		case 0xe5:dyn_mmx_op((void*)&dyn_mmx_pmulhw);break;
+		case 0xe8:dyn_mmx_op((void*)&dyn_mmx_psubsb);break;
+		case 0xe9:dyn_mmx_op((void*)&dyn_mmx_psubsw);break;
+		case 0xeb:dyn_mmx_op((void*)&dyn_mmx_por);break;
+		case 0xec:dyn_mmx_op((void*)&dyn_mmx_paddsb);break;
+		case 0xed:dyn_mmx_op((void*)&dyn_mmx_paddsw);break;
+		case 0xef:dyn_mmx_op((void*)&dyn_mmx_pxor);break;
+		case 0xf1:dyn_mmx_op((void*)&dyn_mmx_psllw);break;
+		case 0xf2:dyn_mmx_op((void*)&dyn_mmx_pslld);break;
+		case 0xf3:dyn_mmx_op((void*)&dyn_mmx_psllq);break;
+		case 0xf5:dyn_mmx_op((void*)&dyn_mmx_pmaddwd);break;
+		case 0xf8:dyn_mmx_op((void*)&dyn_mmx_psubb);break;
+		case 0xf9:dyn_mmx_op((void*)&dyn_mmx_psubw);break;
+		case 0xfa:dyn_mmx_op((void*)&dyn_mmx_psubd);break;
+		case 0xfc:dyn_mmx_op((void*)&dyn_mmx_paddb);break;
+		case 0xfd:dyn_mmx_op((void*)&dyn_mmx_paddw);break;
+		case 0xfe:dyn_mmx_op((void*)&dyn_mmx_paddd);break;
+
+		default:
+			return false;
+	}
+	return true;
+}
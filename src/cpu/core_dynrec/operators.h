@@ -1967,30 +1967,35 @@ static Bit32u DRC_CALL_CONV dynrec_stosd_dword(Bit32u count,Bit32s add_index,Phy
 }
 
 
-static void DRC_CALL_CONV dynrec_push_word(Bit16u value) DRC_FC;
-static void DRC_CALL_CONV dynrec_push_word(Bit16u value) {
+// the stack functions return true on a page fault (cpu.exception is set up then)
+// and leave esp untouched, so the instruction can be restarted after the fault.
+// popped values are returned in core_dynrec.readdata like the checked reads.
+static bool DRC_CALL_CONV dynrec_push_word(Bit16u value) DRC_FC;
+static bool DRC_CALL_CONV dynrec_push_word(Bit16u value) {
 	Bit32u new_esp=(reg_esp&cpu.stack.notmask)|((reg_esp-2)&cpu.stack.mask);
-	mem_writew(SegPhys(ss) + (new_esp & cpu.stack.mask),value);
+	if (GCC_UNLIKELY(mem_writew_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),value))) return true;
 	reg_esp=new_esp;
+	return false;
 }
 
-static void DRC_CALL_CONV dynrec_push_dword(Bit32u value) DRC_FC;
-static void DRC_CALL_CONV dynrec_push_dword(Bit32u value) {
+static bool DRC_CALL_CONV dynrec_push_dword(Bit32u value) DRC_FC;
+static bool DRC_CALL_CONV dynrec_push_dword(Bit32u value) {
 	Bit32u new_esp=(reg_esp&cpu.stack.notmask)|((reg_esp-4)&cpu.stack.mask);
-	mem_writed(SegPhys(ss) + (new_esp & cpu.stack.mask) ,value);
+	if (GCC_UNLIKELY(mem_writed_checked(SegPhys(ss) + (new_esp & cpu.stack.mask),value))) return true;
 	reg_esp=new_esp;
+	return false;
 }
 
-static Bit16u DRC_CALL_CONV dynrec_pop_word(void) DRC_FC;
-static Bit16u DRC_CALL_CONV dynrec_pop_word(void) {
-	Bit16u val=mem_readw(SegPhys(ss) + (reg_esp & cpu.stack.mask));
+static bool DRC_CALL_CONV dynrec_pop_word(void) DRC_FC;
+static bool DRC_CALL_CONV dynrec_pop_word(void) {
+	if (GCC_UNLIKELY(mem_readw_checked(SegPhys(ss) + (reg_esp & cpu.stack.mask),(Bit16u*)(&core_dynrec.readdata)))) return true;
 	reg_esp=(reg_esp&cpu.stack.notmask)|((reg_esp+2)&cpu.stack.mask);
-	return val;
+	return false;
 }
 
-static Bit32u DRC_CALL_CONV dynrec_pop_dword(void) DRC_FC;
-static Bit32u DRC_CALL_CONV dynrec_pop_dword(void) {
-	Bit32u val=mem_readd(SegPhys(ss) + (reg_esp & cpu.stack.mask));
+static bool DRC_CALL_CONV dynrec_pop_dword(void) DRC_FC;
+static bool DRC_CALL_CONV dynrec_pop_dword(void) {
+	if (GCC_UNLIKELY(mem_readd_checked(SegPhys(ss) + (reg_esp & cpu.stack.mask),(Bit32u*)(&core_dynrec.readdata)))) return true;
 	reg_esp=(reg_esp&cpu.stack.notmask)|((reg_esp+4)&cpu.stack.mask);
-	return val;
+	return false;
 }
@@ -32,12 +32,68 @@ enum STRING_OP {
 
 extern int cpu_rep_max;
 
+/* Forward REP STOS/MOVS into a page handler that takes spans (planar VGA memory)
+ * hand whole runs of units to it instead of going through it unit by unit. A run
+ * stays within the destination page (and the source page for MOVS), doesn't wrap
+ * the index registers and ends on the unit that would have run CPU_Cycles out in
+ * the loops below, counting the access delay the handler charges per write.
+ * Returns the number of units written, 0 to go on unit by unit. span_off is set
+ * to the destination page once it turns out not to take spans there, the caller
+ * tries again on the next page. A page that is not mapped yet (init or foiling
+ * handler) is tried again after the next unit, whose write maps it. */
+static Bitu DoString_Span(Bitu &span_off,PhysPt di_lin,Bitu di_index,PhysPt si_lin,Bitu si_index,bool movs,
+	Bitu add_mask,Bitu width,Bitu val,Bitu count) {
+	if (get_tlb_write(di_lin) != NULL) {
+		span_off = di_lin >> 12;
+		return 0;
+	}
+	PageHandler *ph = get_tlb_writehandler(di_lin);
+	if (ph->getFlags() & PFLAG_INIT) return 0;
+
+	const Bit8u *data = NULL;
+	if (movs) {
+		const HostPt tlb_read = get_tlb_read(si_lin);
+		if (tlb_read == NULL) {
+			if (!(get_tlb_readhandler(si_lin)->getFlags() & PFLAG_INIT)) span_off = di_lin >> 12;
+			return 0;
+		}
+		data = tlb_read + si_lin;
+	}
+
+	Bitu units = (0x1000u - (di_lin & 0xfffu)) / width;
+	if (units > count) units = count;
+	Bitu limit = (Bitu)(((Bit64u)add_mask - di_index + 1u) / width);
+	if (units > limit) units = limit;
+	if (movs) {
+		limit = (0x1000u - (si_lin & 0xfffu)) / width;
+		if (units > limit) units = limit;
+		limit = (Bitu)(((Bit64u)add_mask - si_index + 1u) / width);
+		if (units > limit) units = limit;
+	}
+	if (units < 2) return 0;
+
+	const Bits cost = ph->writedelay() + 1;
+	if (CPU_Cycles <= 0) return 0;
+	limit = (Bitu)((CPU_Cycles + cost - 1) / cost);
+	if (units > limit) units = limit;
+	if (units < 2) return 0;
+
+	if (!(movs ? ph->writeblock(di_lin,data,width,units) : ph->writefill(di_lin,val,width,units))) {
+		span_off = di_lin >> 12;
+		return 0;
+	}
+	CPU_Cycles -= (Bits)units;
+	return units;
+}
+
 void DoString(STRING_OP type) {
 	static PhysPt  si_base,di_base;
 	static Bitu	si_index,di_index;
 	static Bitu	add_mask;
 	static Bitu	count,count_left;
 	static Bits	add_index;
+	Bitu span_off = ~(Bitu)0;	/* destination page DoString_Span gave up on */
+	Bitu n;
 
 	count_left=0;
 	si_base=BaseDS;
@@ -151,6 +207,13 @@ void DoString(STRING_OP type) {
 
 				case R_STOSB:
 					do {
+						if (add_index > 0 && ((di_base+di_index)>>12) != span_off && (n=DoString_Span(span_off,di_base+di_index,di_index,0,0,false,add_mask,1,reg_al,count)) != 0) {
+							di_index=(di_index+n*add_index) & add_mask;
+							count-=n;
+
+							if (CPU_Cycles <= 0) break;
+							continue;
+						}
 						SaveMb(di_base+di_index,reg_al);
 						di_index=(di_index+add_index) & add_mask;
 						count--;
@@ -160,6 +223,13 @@ void DoString(STRING_OP type) {
 				case R_STOSW:
 					add_index<<=1;
 					do {
+						if (add_index > 0 && ((di_base+di_index)>>12) != span_off && (n=DoString_Span(span_off,di_base+di_index,di_index,0,0,false,add_mask,2,reg_ax,count)) != 0) {
+							di_index=(di_index+n*add_index) & add_mask;
+							count-=n;
+
+							if (CPU_Cycles <= 0) break;
+							continue;
+						}
 						SaveMw(di_base+di_index,reg_ax);
 						di_index=(di_index+add_index) & add_mask;
 						count--;
@@ -169,6 +239,13 @@ void DoString(STRING_OP type) {
 				case R_STOSD:
 					add_index<<=2;
 					do {
+						if (add_index > 0 && ((di_base+di_index)>>12) != span_off && (n=DoString_Span(span_off,di_base+di_index,di_index,0,0,false,add_mask,4,reg_eax,count)) != 0) {
+							di_index=(di_index+n*add_index) & add_mask;
+							count-=n;
+
+							if (CPU_Cycles <= 0) break;
+							continue;
+						}
 						SaveMd(di_base+di_index,reg_eax);
 						di_index=(di_index+add_index) & add_mask;
 						count--;
@@ -178,6 +255,14 @@ void DoString(STRING_OP type) {
 
 				case R_MOVSB:
 					do {
+						if (add_index > 0 && ((di_base+di_index)>>12) != span_off && (n=DoString_Span(span_off,di_base+di_index,di_index,si_base+si_index,si_index,true,add_mask,1,0,count)) != 0) {
+							di_index=(di_index+n*add_index) & add_mask;
+							si_index=(si_index+n*add_index) & add_mask;
+							count-=n;
+
+							if (CPU_Cycles <= 0) break;
+							continue;
+						}
 						SaveMb(di_base+di_index,LoadMb(si_base+si_index));
 						di_index=(di_index+add_index) & add_mask;
 						si_index=(si_index+add_index) & add_mask;
@@ -188,6 +273,14 @@ void DoString(STRING_OP type) {
 				case R_MOVSW:
 					add_index<<=1;
 					do {
+						if (add_index > 0 && ((di_base+di_index)>>12) != span_off && (n=DoString_Span(span_off,di_base+di_index,di_index,si_base+si_index,si_index,true,add_mask,2,0,count)) != 0) {
+							di_index=(di_index+n*add_index) & add_mask;
+							si_index=(si_index+n*add_index) & add_mask;
+							count-=n;
+
+							if (CPU_Cycles <= 0) break;
+							continue;
+						}
 						SaveMw(di_base+di_index,LoadMw(si_base+si_index));
 						di_index=(di_index+add_index) & add_mask;
 						si_index=(si_index+add_index) & add_mask;
@@ -198,6 +291,14 @@ void DoString(STRING_OP type) {
 				case R_MOVSD:
 					add_index<<=2;
 					do {
+						if (add_index > 0 && ((di_base+di_index)>>12) != span_off && (n=DoString_Span(span_off,di_base+di_index,di_index,si_base+si_index,si_index,true,add_mask,4,0,count)) != 0) {
+							di_index=(di_index+n*add_index) & add_mask;
+							si_index=(si_index+n*add_index) & add_mask;
+							count-=n;
+
+							if (CPU_Cycles <= 0) break;
+							continue;
+						}
 						SaveMd(di_base+di_index,LoadMd(si_base+si_index));
 						di_index=(di_index+add_index) & add_mask;
 						si_index=(si_index+add_index) & add_mask;
@@ -154,6 +154,7 @@ char core_mode[16];
 CPU_Decoder * cpudecoder;
 bool CPU_CycleAutoAdjust = false;
 bool CPU_SkipCycleAutoAdjust = false;
+bool CPU_CycleGovernor = false;
 Bitu CPU_AutoDetermineMode = 0;
 
 Bitu CPU_ArchitectureType = CPU_ARCHTYPE_MIXED;
@@ -2896,6 +2897,7 @@ void CPU_Disable_SkipAutoAdjust(void) {
 extern Bit32s ticksDone;
 extern Bit32u ticksScheduled;
 extern int dynamic_core_cache_block_size;
+extern int dynamic_core_cache_size;
 
 void CPU_Reset_AutoAdjust(void) {
 	CPU_IODelayRemoved = 0;
@@ -3109,6 +3111,9 @@ public:
 		dynamic_core_cache_block_size = section->Get_int("dynamic core cache block size");
 		if (dynamic_core_cache_block_size < 1 || dynamic_core_cache_block_size > 65536) dynamic_core_cache_block_size = 32;
 
+		dynamic_core_cache_size = section->Get_int("dynamic core cache size");
+		if (dynamic_core_cache_size < 2 || dynamic_core_cache_size > 256) dynamic_core_cache_size = 8;
+
 		Prop_multival* p = section->Get_multival("cycles");
 		std::string type = p->GetSection()->Get_string("type");
 		std::string str ;
@@ -3195,6 +3200,7 @@ public:
         enable_cmpxchg8b=section->Get_bool("enable cmpxchg8b");
 		CPU_CycleUp=section->Get_int("cycleup");
 		CPU_CycleDown=section->Get_int("cycledown");
+		CPU_CycleGovernor=section->Get_bool("cycle governor");
 		std::string core(section->Get_string("core"));
 		cpudecoder=&CPU_Core_Normal_Run;
 		safe_strncpy(core_mode,core.c_str(),15);
@@ -91,6 +91,15 @@ bool PageHandler::writew_checked(PhysPt addr,Bitu val) {
 bool PageHandler::writed_checked(PhysPt addr,Bitu val) {
 	writed(addr,val);	return false;
 }
+bool PageHandler::writefill(PhysPt /*addr*/,Bitu /*val*/,Bitu /*width*/,Bitu /*count*/) {
+	return false;
+}
+bool PageHandler::writeblock(PhysPt /*addr*/,const Bit8u * /*data*/,Bitu /*width*/,Bitu /*count*/) {
+	return false;
+}
+Bits PageHandler::writedelay(void) {
+	return 0;
+}
 
 
 
@@ -274,6 +283,20 @@ bool use_dynamic_core_with_paging = false; /* allow dynamic core even with pagin
 bool dosbox_allow_nonrecursive_page_fault = false;	/* when set, do nonrecursive mode (when executing instruction) */
 
 bool CPU_IsDynamicCore(void);
+#if !(C_DYNAMIC_X86) && (C_DYNREC)
+extern bool dynrec_recursive_faults;
+#endif
+
+// true if a page fault can't be thrown, the host stack holds generated code
+static inline bool PAGING_FaultMustRecurse(void) {
+#if (C_DYNAMIC_X86)
+	return CPU_IsDynamicCore();
+#elif (C_DYNREC)
+	return dynrec_recursive_faults;
+#else
+	return false;
+#endif
+}
 
 // PAGING_NewPageFault
 // lin_addr, page_addr: the linear and page address the fault happened at
@@ -286,7 +309,7 @@ static void PAGING_NewPageFault(PhysPt lin_addr, Bitu page_addr, bool prepare_on
 	if (prepare_only) {
 		cpu.exception.which = EXCEPTION_PF;
 		cpu.exception.error = faultcode;
-	} else if (dosbox_allow_nonrecursive_page_fault && !CPU_IsDynamicCore()) {
+	} else if (dosbox_allow_nonrecursive_page_fault && !PAGING_FaultMustRecurse()) {
 		throw GuestPageFaultException(lin_addr,page_addr,faultcode);
 	} else {
 		// Save the state of the cpu cores
@@ -356,6 +379,8 @@ private:
 		if (handler->getFlags() & PFLAG_WRITEABLE)
 			paging.tlb.write[lin_page] = handler->GetHostWritePt(phys_page) - (lin_page << 12);
 		else paging.tlb.write[lin_page]=0;
+		// writes to the page can happen from now on, whatever handler serves it
+		MEM_MarkPageDirty(phys_page);
 		paging.tlb.writehandler[lin_page]=handler;
 
 		return;
@@ -878,6 +903,8 @@ static void PAGING_LinkPageNew(Bitu lin_page, Bitu phys_page, Bitu linkmode, boo
 				handler->GetHostWritePt(phys_page)-lin_base;
 			else paging.tlb.write[lin_page]=0;
 	paging.tlb.writehandler[lin_page]=handler;
+			// writes to the page can happen from now on, whatever handler serves it
+			MEM_MarkPageDirty(phys_page);
 		} else {
 			paging.tlb.writehandler[lin_page]= &foiling_handler;
 			paging.tlb.write[lin_page]=0;
@@ -934,6 +961,8 @@ void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 	else paging.tlb.read[lin_page]=0;
 	if (handler->getFlags() & PFLAG_WRITEABLE) paging.tlb.write[lin_page]=handler->GetHostWritePt(phys_page)-lin_base;
 	else paging.tlb.write[lin_page]=0;
+	// writes to the page can happen from now on, whatever handler serves it
+	MEM_MarkPageDirty(phys_page);
 
 	paging.links.entries[paging.links.used++]=lin_page;
 	paging.tlb.readhandler[lin_page]=handler;
@@ -980,6 +1009,7 @@ void PAGING_SwitchCPL(bool isUser) {
 				if (handler->getFlags()&PFLAG_WRITEABLE)
 					paging.tlb.write[tlb_index] = handler->GetHostWritePt(phys_page)-lin_base;
 				else paging.tlb.write[tlb_index] = 0;
+				MEM_MarkPageDirty(phys_page);
 			} else {
 				paging.tlb.writehandler[tlb_index] = &foiling_handler;
 				paging.tlb.write[tlb_index] = 0;
@@ -1035,6 +1065,7 @@ void PAGING_SwitchCPL(bool isUser) {
 					if (handler->getFlags()&PFLAG_WRITEABLE)
 						paging.tlb.write[tlb_index] = handler->GetHostWritePt(phys_page)-lin_base;
 					else paging.tlb.write[tlb_index] = 0;
+					MEM_MarkPageDirty(phys_page);
 				} else {
 					paging.tlb.writehandler[tlb_index] = &foiling_handler;
 					paging.tlb.write[tlb_index] = 0;
@@ -1119,6 +1150,8 @@ void PAGING_LinkPage(Bitu lin_page,Bitu phys_page) {
 	else entry->read=0;
 	if (handler->getFlags() & PFLAG_WRITEABLE) entry->write=handler->GetHostWritePt(phys_page)-lin_base;
 	else entry->write=0;
+	// writes to the page can happen from now on, whatever handler serves it
+	MEM_MarkPageDirty(phys_page);
 
  	paging.links.entries[paging.links.used++]=lin_page;
 	entry->readhandler=handler;
@@ -22,6 +22,7 @@
 
 #include <string.h>
 #include <list>
+#include <map>
 #include <ctype.h>
 #include <fstream>
 #include <iomanip>
@@ -121,7 +122,15 @@ static ofstream 	cpuLogFile;
 static bool		cpuLog			= false;
 static int		cpuLogCounter	= 0;
 static int		cpuLogType		= 1;	// log detail
+static FILE*	cpuBinLogFile	= NULL;
+static Bit32u	cpuBinLogCounter = 0;
+static bool		cpuBinLogEndless = false;	// LOGB without count, runs until the debugger is entered
 static bool zeroProtect = false;
+#define TRACE_CODE_BYTES 15		// longest x86 instruction
+#define TRACE_RES_BYTES 23		// memory operand column, including the terminator
+static bool OpenBinLog(const char* name);
+static void CloseBinLog(void);
+static void DecodeBinLog(const char* inname, const char* outname);
 bool	logHeavy	= false;
 #endif
 
@@ -301,6 +310,61 @@ enum EBreakpoint { BKPNT_UNKNOWN, BKPNT_PHYSICAL, BKPNT_INTERRUPT, BKPNT_MEMORY,
 
 #define BPINT_ALL 0x100
 
+#if C_HEAVY_DEBUG
+// Set by DebugWatchPageHandler whenever the guest writes to a watched page
+static bool debugWatchWritten = false;
+
+// Stands in for the handler of a RAM page that holds a memory breakpoint.
+// It keeps reads on the fast host pointer path but drops PFLAG_WRITEABLE, so
+// every write to the page comes through here and flags the breakpoints for
+// evaluation instead of them being compared on every instruction.
+class DebugWatchPageHandler : public PageHandler {
+public:
+	DebugWatchPageHandler(PageHandler* _inner,Bitu _page) : PageHandler(_inner->flags & ~PFLAG_WRITEABLE), inner(_inner), page(_page), refs(0) {}
+	void SetInner(PageHandler* _inner) {
+		inner = _inner;
+		flags = inner->flags & ~PFLAG_WRITEABLE;
+	}
+	Bitu readb(PhysPt addr) {
+		if (inner->flags & PFLAG_READABLE) return host_readb(inner->GetHostReadPt(page)+(addr & 4095));
+		return inner->readb(addr);
+	}
+	Bitu readw(PhysPt addr) {
+		if (inner->flags & PFLAG_READABLE) return host_readw(inner->GetHostReadPt(page)+(addr & 4095));
+		return inner->readw(addr);
+	}
+	Bitu readd(PhysPt addr) {
+		if (inner->flags & PFLAG_READABLE) return host_readd(inner->GetHostReadPt(page)+(addr & 4095));
+		return inner->readd(addr);
+	}
+	void writeb(PhysPt addr,Bitu val) {
+		debugWatchWritten = true;
+		if (inner->flags & PFLAG_WRITEABLE) host_writeb(inner->GetHostWritePt(page)+(addr & 4095),(Bit8u)val);
+		else inner->writeb(addr,val);
+	}
+	void writew(PhysPt addr,Bitu val) {
+		debugWatchWritten = true;
+		if (inner->flags & PFLAG_WRITEABLE) host_writew(inner->GetHostWritePt(page)+(addr & 4095),(Bit16u)val);
+		else inner->writew(addr,val);
+	}
+	void writed(PhysPt addr,Bitu val) {
+		debugWatchWritten = true;
+		if (inner->flags & PFLAG_WRITEABLE) host_writed(inner->GetHostWritePt(page)+(addr & 4095),(Bit32u)val);
+		else inner->writed(addr,val);
+	}
+	HostPt GetHostReadPt(Bitu phys_page) {
+		return inner->GetHostReadPt(phys_page);
+	}
+	Bits writedelay(void) {
+		return inner->writedelay();
+	}
+
+	PageHandler*	inner;
+	Bitu			page;
+	Bitu			refs;
+};
+#endif
+
 class CBreakpoint
 {
 public:
@@ -341,6 +405,16 @@ public:
 
 
 private:
+	// index maintenance, every add/remove of BPoints goes through these
+	static void				AddToIndex			(CBreakpoint* bp);
+	static void				RemoveFromIndex		(CBreakpoint* bp);
+	static void				Remove				(std::list<CBreakpoint*>::iterator i);
+	static Bitu				AddressHash			(Bitu seg, Bitu off)		{ return (off ^ (off >> 8) ^ (off >> 16) ^ seg ^ (seg >> 8)) & 0xFF; };
+#if C_HEAVY_DEBUG
+	static bool				WatchBreakpoint		(CBreakpoint* bp);
+	static void				UnwatchBreakpoint	(CBreakpoint* bp);
+#endif
+
 	EBreakpoint	type;
 	// Physical
 	PhysPt		location;
@@ -353,13 +427,31 @@ private:
 	// Shared
 	bool		active;
 	bool		once;
+	// Memory, the physical page trapped for it or ~0
+	Bitu		watchPage;
 
 	static std::list<CBreakpoint*>	BPoints;
+
+	// Lookup structures so that the per-instruction checks don't have to
+	// walk BPoints: physical breakpoints hashed on segment:offset (matched
+	// that way, so they keep firing when a descriptor base changes), the
+	// interrupt breakpoints of each vector and the memory breakpoints.
+	static std::list<CBreakpoint*>	BPAddrHash[256];
+	static Bitu						BPAddrCount;
+	static std::list<CBreakpoint*>	BPIntList[256];
+	static std::list<CBreakpoint*>	BPMemList;
+#if C_HEAVY_DEBUG
+	// Trapped pages by physical page number, and whether the memory
+	// breakpoints have to be compared on the next instruction anyway
+	static std::map<Bitu,DebugWatchPageHandler*>	BPWatchPages;
+	static bool						BPMemPoll;
+	static Bitu						BPMemTick;
+#endif
 public:
 	static CBreakpoint*				ignoreOnce;
 };
 
-CBreakpoint::CBreakpoint(void):type(BKPNT_UNKNOWN),location(0),segment(0),offset(0),intNr(0),ahValue(0),active(false),once(false) { };
+CBreakpoint::CBreakpoint(void):type(BKPNT_UNKNOWN),location(0),segment(0),offset(0),intNr(0),ahValue(0),active(false),once(false),watchPage(~(Bitu)0) { };
 
 void CBreakpoint::Activate(bool _active)
 {
@@ -385,15 +477,143 @@ void CBreakpoint::Activate(bool _active)
 
 // Statics
 std::list<CBreakpoint*> CBreakpoint::BPoints;
+std::list<CBreakpoint*> CBreakpoint::BPAddrHash[256];
+Bitu					CBreakpoint::BPAddrCount = 0;
+std::list<CBreakpoint*> CBreakpoint::BPIntList[256];
+std::list<CBreakpoint*> CBreakpoint::BPMemList;
+#if C_HEAVY_DEBUG
+std::map<Bitu,DebugWatchPageHandler*> CBreakpoint::BPWatchPages;
+bool					CBreakpoint::BPMemPoll = false;
+Bitu					CBreakpoint::BPMemTick = 0;
+#endif
 CBreakpoint*			CBreakpoint::ignoreOnce = 0;
 Bitu					ignoreAddressOnce = 0;
 
+void CBreakpoint::AddToIndex(CBreakpoint* bp)
+{
+	switch (bp->GetType()) {
+		case BKPNT_PHYSICAL:
+			BPAddrHash[AddressHash(bp->GetSegment(),bp->GetOffset())].push_front(bp);
+			BPAddrCount++;
+			break;
+		case BKPNT_INTERRUPT:
+			BPIntList[bp->GetIntNr()].push_front(bp);
+			break;
+		case BKPNT_MEMORY:
+		case BKPNT_MEMORY_PROT:
+		case BKPNT_MEMORY_LINEAR:
+			BPMemList.push_front(bp);
+#if C_HEAVY_DEBUG
+			// the type may still change, the page is trapped on the next check
+			BPMemPoll = true;
+#endif
+			break;
+		default:
+			break;
+	}
+};
+
+void CBreakpoint::RemoveFromIndex(CBreakpoint* bp)
+{
+	switch (bp->GetType()) {
+		case BKPNT_PHYSICAL:
+			BPAddrHash[AddressHash(bp->GetSegment(),bp->GetOffset())].remove(bp);
+			if (BPAddrCount > 0) BPAddrCount--;
+			break;
+		case BKPNT_INTERRUPT:
+			BPIntList[bp->GetIntNr()].remove(bp);
+			break;
+		case BKPNT_MEMORY:
+		case BKPNT_MEMORY_PROT:
+		case BKPNT_MEMORY_LINEAR:
+#if C_HEAVY_DEBUG
+			UnwatchBreakpoint(bp);
+#endif
+			BPMemList.remove(bp);
+			break;
+		default:
+			break;
+	}
+};
+
+void CBreakpoint::Remove(std::list<CBreakpoint*>::iterator i)
+{
+	CBreakpoint* bp = (*i);
+	RemoveFromIndex(bp);
+	(BPoints.erase)(i);
+	if (ignoreOnce == bp) ignoreOnce = 0;
+	bp->Activate(false);
+	delete bp;
+};
+
+#if C_HEAVY_DEBUG
+bool CBreakpoint::WatchBreakpoint(CBreakpoint* bp)
+// Traps writes to the page of a memory breakpoint, false if it has to be polled
+{
+	Bitu address;
+	if (bp->GetType()==BKPNT_MEMORY_LINEAR) address = bp->GetOffset();
+	else address = (Bitu)GetAddress(bp->GetSegment(),bp->GetOffset());
+
+	Bitu page = address >> 12;
+	bool trappable = PAGING_MakePhysPage(page);
+	if (trappable) {
+		if (!MEM_A20_Enabled() && (page & ~0xFul) == 0x100ul) page &= 0xFF;
+		// Only plain RAM, the adapter and ROM pages swap their handlers too often
+		trappable = (page < 0xA0) || (page >= 0x100 && page < MEM_TotalPages());
+	}
+	if (!trappable) {
+		UnwatchBreakpoint(bp);
+		return false;
+	}
+
+	if (bp->watchPage != page) {
+		UnwatchBreakpoint(bp);
+		std::map<Bitu,DebugWatchPageHandler*>::iterator i = BPWatchPages.find(page);
+		DebugWatchPageHandler* watch;
+		if (i == BPWatchPages.end()) {
+			watch = new DebugWatchPageHandler(MEM_GetPageHandler(page),page);
+			BPWatchPages[page] = watch;
+		} else watch = i->second;
+		watch->refs++;
+		bp->watchPage = page;
+	}
+
+	// (Re)install, something may have mapped its own handler over the page since
+	DebugWatchPageHandler* watch = BPWatchPages[page];
+	PageHandler* cur = MEM_GetPageHandler(page);
+	if (cur != watch) {
+		watch->SetInner(cur);
+		MEM_SetPageHandler(page,1,watch);
+		PAGING_ClearTLB();
+	}
+	return true;
+};
+
+void CBreakpoint::UnwatchBreakpoint(CBreakpoint* bp)
+{
+	if (bp->watchPage == ~(Bitu)0) return;
+	std::map<Bitu,DebugWatchPageHandler*>::iterator i = BPWatchPages.find(bp->watchPage);
+	bp->watchPage = ~(Bitu)0;
+	if (i == BPWatchPages.end()) return;
+
+	DebugWatchPageHandler* watch = i->second;
+	if (--watch->refs > 0) return;
+	if (MEM_GetPageHandler(watch->page) == watch) {
+		MEM_SetPageHandler(watch->page,1,watch->inner);
+		PAGING_ClearTLB();
+	}
+	BPWatchPages.erase(i);
+	delete watch;
+};
+#endif
+
 CBreakpoint* CBreakpoint::AddBreakpoint(Bit16u seg, Bit32u off, bool once)
 {
 	CBreakpoint* bp = new CBreakpoint();
 	bp->SetAddress		(seg,off);
 	bp->SetOnce			(once);
 	BPoints.push_front	(bp);
+	AddToIndex			(bp);
 	return bp;
 };
 
@@ -403,9 +623,12 @@ CBreakpoint* CBreakpoint::AddIntBreakpoint(Bit8u intNum, Bit16u ah, bool once)
 	bp->SetInt			(intNum,ah);
 	bp->SetOnce			(once);
 	BPoints.push_front	(bp);
+	AddToIndex			(bp);
 	return bp;
 };
 
+// The caller may still change the type between the memory breakpoint
+// variants, which all live in BPMemList.
 CBreakpoint* CBreakpoint::AddMemBreakpoint(Bit16u seg, Bit32u off)
 {
 	CBreakpoint* bp = new CBreakpoint();
@@ -413,6 +636,7 @@ CBreakpoint* CBreakpoint::AddMemBreakpoint(Bit16u seg, Bit32u off)
 	bp->SetOnce			(false);
 	bp->SetType			(BKPNT_MEMORY);
 	BPoints.push_front	(bp);
+	AddToIndex			(bp);
 	return bp;
 };
 
@@ -442,11 +666,12 @@ bool CBreakpoint::CheckBreakpoint(Bitu seg, Bitu off)
 		ignoreAddressOnce = 0;
 
 	// Search matching breakpoint
-	std::list<CBreakpoint*>::iterator i;
-	CBreakpoint* bp;
-	for(i=BPoints.begin(); i != BPoints.end(); i++) {
-		bp = (*i);
-		if ((bp->GetType()==BKPNT_PHYSICAL) && bp->IsActive() && (bp->GetSegment()==seg) && (bp->GetOffset()==off)) {
+	if (BPAddrCount != 0) {
+		std::list<CBreakpoint*>& bucket = BPAddrHash[AddressHash(seg,off)];
+		for (std::list<CBreakpoint*>::iterator j=bucket.begin(); j != bucket.end(); j++) {
+			CBreakpoint* bp = (*j);
+			if ((bp->GetSegment()!=seg) || (bp->GetOffset()!=off)) continue;
+			if (!bp->IsActive()) continue;
 			// Ignore Once ?
 			if (ignoreOnce==bp) {
 				ignoreOnce=0;
@@ -456,43 +681,58 @@ bool CBreakpoint::CheckBreakpoint(Bitu seg, Bitu off)
 			// Found, 
 			if (bp->GetOnce()) {
 				// delete it, if it should only be used once
-				(BPoints.erase)(i);
-				bp->Activate(false);
-				delete bp;
+				std::list<CBreakpoint*>::iterator i;
+				for(i=BPoints.begin(); i != BPoints.end(); i++) {
+					if ((*i)==bp) {
+						Remove(i);
+						break;
+					}
+				}
 			} else {
 				ignoreOnce = bp;
 			};
 			return true;
-		} 
+		}
+	}
 #if C_HEAVY_DEBUG
-		// Memory breakpoint support
-		else if (bp->IsActive()) {
-			if ((bp->GetType()==BKPNT_MEMORY) || (bp->GetType()==BKPNT_MEMORY_PROT) || (bp->GetType()==BKPNT_MEMORY_LINEAR)) {
-				// Watch Protected Mode Memoryonly in pmode
-				if (bp->GetType()==BKPNT_MEMORY_PROT) {
-					// Check if pmode is active
-					if (!cpu.pmode) return false;
-					// Check if descriptor is valid
-					Descriptor desc;
-					if (!cpu.gdt.GetDescriptor(bp->GetSegment(),desc)) return false;
-					if (desc.GetLimit()==0) return false;
-				}
-
-				Bitu address; 
-				if (bp->GetType()==BKPNT_MEMORY_LINEAR) address = bp->GetOffset();
-				else address = (Bitu)GetAddress(bp->GetSegment(),bp->GetOffset());
-				Bit8u value=0;
-				if (mem_readb_checked(address,&value)) return false;
-				if (bp->GetValue() != value) {
-					// Yup, memory value changed
-					DEBUG_ShowMsg("DEBUG: Memory breakpoint %s: %04X:%04X - %02X -> %02X\n",(bp->GetType()==BKPNT_MEMORY_PROT)?"(Prot)":"",bp->GetSegment(),bp->GetOffset(),bp->GetValue(),value);
-					bp->SetValue(value);
-					return true;
-				};		
-			} 		
-		};
-#endif
+	// Memory breakpoint support. The pages are trapped, so the values are only
+	// compared after a write to one of them, while an untrappable breakpoint
+	// exists, and every 256 instructions to follow remapping and the writes
+	// that bypass the page handlers (DMA).
+	if (BPMemList.empty()) return false;
+	if (!debugWatchWritten && !BPMemPoll && ((++BPMemTick) & 0xFF) != 0) return false;
+	debugWatchWritten = false;
+	BPMemPoll = false;
+	std::list<CBreakpoint*>::iterator i;
+	for(i=BPMemList.begin(); i != BPMemList.end(); i++) {
+		CBreakpoint* bp = (*i);
+		if (!bp->IsActive()) continue;
+		// Watch Protected Mode Memoryonly in pmode
+		if (bp->GetType()==BKPNT_MEMORY_PROT) {
+			// Check if pmode is active
+			if (!cpu.pmode) continue;
+			// Check if descriptor is valid
+			Descriptor desc;
+			if (!cpu.gdt.GetDescriptor(bp->GetSegment(),desc)) continue;
+			if (desc.GetLimit()==0) continue;
+		}
+		if (!WatchBreakpoint(bp)) BPMemPoll = true;
+
+		Bitu address; 
+		if (bp->GetType()==BKPNT_MEMORY_LINEAR) address = bp->GetOffset();
+		else address = (Bitu)GetAddress(bp->GetSegment(),bp->GetOffset());
+		Bit8u value=0;
+		if (mem_readb_checked(address,&value)) continue;
+		if (bp->GetValue() != value) {
+			// Yup, memory value changed
+			DEBUG_ShowMsg("DEBUG: Memory breakpoint %s: %04X:%04X - %02X -> %02X\n",(bp->GetType()==BKPNT_MEMORY_PROT)?"(Prot)":"",bp->GetSegment(),bp->GetOffset(),bp->GetValue(),value);
+			bp->SetValue(value);
+			// compare the rest again on the next instruction
+			BPMemPoll = true;
+			return true;
+		};		
 	};
+#endif
 	return false;
 };
 
@@ -505,31 +745,35 @@ bool CBreakpoint::CheckIntBreakpoint(PhysPt adr, Bit8u intNr, Bit16u ahValue)
 	} else
 		ignoreAddressOnce = 0;
 
-	// Search matching breakpoint
-	std::list<CBreakpoint*>::iterator i;
+	// Search matching breakpoint among those of this vector
+	std::list<CBreakpoint*>& vec = BPIntList[intNr];
+	std::list<CBreakpoint*>::iterator j;
 	CBreakpoint* bp;
-	for(i=BPoints.begin(); i != BPoints.end(); i++) {
-		bp = (*i);
-		if ((bp->GetType()==BKPNT_INTERRUPT) && bp->IsActive() && (bp->GetIntNr()==intNr)) {
-			if ((bp->GetValue()==BPINT_ALL) || (bp->GetValue()==ahValue)) {
-				// Ignore it once ?
-				if (ignoreOnce==bp) {
-					ignoreOnce=0;
-					bp->Activate(true);
-					return false;
-				};
-				// Found
-				if (bp->GetOnce()) {
-					// delete it, if it should only be used once
-					(BPoints.erase)(i);
-					bp->Activate(false);
-					delete bp;
-				} else {
-					ignoreOnce = bp;
+	for(j=vec.begin(); j != vec.end(); j++) {
+		bp = (*j);
+		if (!bp->IsActive()) continue;
+		if ((bp->GetValue()==BPINT_ALL) || (bp->GetValue()==ahValue)) {
+			// Ignore it once ?
+			if (ignoreOnce==bp) {
+				ignoreOnce=0;
+				bp->Activate(true);
+				return false;
+			};
+			// Found
+			if (bp->GetOnce()) {
+				// delete it, if it should only be used once
+				std::list<CBreakpoint*>::iterator i;
+				for(i=BPoints.begin(); i != BPoints.end(); i++) {
+					if ((*i)==bp) {
+						Remove(i);
+						break;
+					}
 				}
-				return true;
+			} else {
+				ignoreOnce = bp;
 			}
-		};
+			return true;
+		}
 	};
 	return false;
 };
@@ -541,9 +785,19 @@ void CBreakpoint::DeleteAll()
 	for(i=BPoints.begin(); i != BPoints.end(); i++) {
 		bp = (*i);
 		bp->Activate(false);
+#if C_HEAVY_DEBUG
+		UnwatchBreakpoint(bp);
+#endif
 		delete bp;
 	};
 	(BPoints.clear)();
+	for (Bitu n=0;n < 256;n++) {
+		(BPAddrHash[n].clear)();
+		(BPIntList[n].clear)();
+	}
+	BPAddrCount = 0;
+	(BPMemList.clear)();
+	ignoreOnce = 0;
 };
 
 
@@ -552,13 +806,9 @@ bool CBreakpoint::DeleteByIndex(Bit16u index)
 	// Search matching breakpoint
 	int nr = 0;
 	std::list<CBreakpoint*>::iterator i;
-	CBreakpoint* bp;
 	for(i=BPoints.begin(); i != BPoints.end(); i++) {
 		if (nr==index) {
-			bp = (*i);
-			(BPoints.erase)(i);
-			bp->Activate(false);
-			delete bp;
+			Remove(i);
 			return true;
 		}
 		nr++;
@@ -574,9 +824,7 @@ bool CBreakpoint::DeleteBreakpoint(PhysPt where)
 	for(i=BPoints.begin(); i != BPoints.end(); i++) {
 		bp = (*i);
 		if ((bp->GetType()==BKPNT_PHYSICAL) && (bp->GetLocation()==where)) {
-			(BPoints.erase)(i);
-			bp->Activate(false);
-			delete bp;
+			Remove(i);
 			return true;
 		}
 	};
@@ -1502,6 +1750,29 @@ bool ParseCommand(char* str) {
 		command = "logcode";
 	}
 
+	if (command == "LOGB") { // Create binary cpu trace
+		if (!OpenBinLog("LOGCPU.BIN")) {
+			DEBUG_ShowMsg("DEBUG: Tracefile couldn't be created.\n");
+			return false;
+		}
+		DEBUG_ShowMsg("DEBUG: Starting binary trace\n");
+		// without a count the trace runs until the debugger is entered again
+		cpuBinLogEndless = (found[0] == 0);
+		cpuBinLogCounter = cpuBinLogEndless ? 0 : GetHexValue(found,found);
+
+		debugging = false;
+		CBreakpoint::ActivateBreakpoints(SegPhys(cs)+reg_eip,true);						
+		ignoreAddressOnce = SegPhys(cs)+reg_eip;
+		DOSBOX_SetNormalLoop();	
+		return true;
+	};
+
+	if (command == "LOGBTXT") { // Decode binary cpu trace
+		DEBUG_ShowMsg("DEBUG: Decoding LOGCPU.BIN to LOGCPU_BIN.TXT\n");
+		DecodeBinLog("LOGCPU.BIN","LOGCPU_BIN.TXT");
+		return true;
+	};
+
 	if (command == "logcode") { //Shared code between all logs
 		DEBUG_ShowMsg("DEBUG: Starting log\n");
 		cpuLogFile.open("LOGCPU.TXT");
@@ -1662,6 +1933,8 @@ bool ParseCommand(char* str) {
 #if C_HEAVY_DEBUG
 		DEBUG_ShowMsg("LOG [num]                 - Write cpu log file.\n");
 		DEBUG_ShowMsg("LOGS/LOGL [num]           - Write short/long cpu log file.\n");
+		DEBUG_ShowMsg("LOGB [num]                - Write binary cpu trace LOGCPU.BIN, no num: until break.\n");
+		DEBUG_ShowMsg("LOGBTXT                   - Decode LOGCPU.BIN into LOGCPU_BIN.TXT.\n");
 		DEBUG_ShowMsg("HEAVYLOG                  - Enable/Disable automatic cpu log when dosbox exits.\n");
 		DEBUG_ShowMsg("ZEROPROTECT               - Enable/Disable zero code execution detecion.\n");
 #endif
@@ -2387,6 +2660,14 @@ void DEBUG_Enable(bool pressed) {
     LoopHandler *ol = DOSBOX_GetLoop();
     if (ol != DEBUG_Loop) old_loop = ol;
 
+#if C_HEAVY_DEBUG
+	// an open ended LOGB trace ends here
+	if (cpuBinLogFile != NULL) {
+		CloseBinLog();
+		DEBUG_ShowMsg("DEBUG: cpu trace LOGCPU.BIN created\n");
+	}
+#endif
+
 	debugging=true;
     debug_running=false;
     check_rescroll=true;
@@ -2814,6 +3095,241 @@ static void LogInstruction(Bit16u segValue, Bit32u eipValue,  ofstream& out) {
 	}
 	out << endl;
 };
+
+/* Binary cpu trace (LOGB). Recording only copies state into a buffer, the
+ * disassembly is done afterwards by LOGBTXT. The file starts with the
+ * signature "DBXTRC02", followed by one record per instruction:
+ *   Bit16u mask	bit 0-8: eax,ecx,edx,ebx,esp,ebp,esi,edi,eflags follow
+ *			bit 9-14: es,cs,ss,ds,fs,gs follow, bit 15: 32-bit code
+ *   Bit32u eip
+ *   Bit8u  length, code[length]	the instruction at cs:eip, 0 if not in RAM
+ *   Bit8u  length, text[length]	memory operand and its value, as in the
+ *					code window, only recorded with EXTEND on
+ *   Bit32u for every register, Bit16u for every segment flagged in mask
+ * A register is only stored when it changed since the previous record.
+ * All values are little endian. */
+#define TRACE_SIGNATURE			"DBXTRC02"
+#define TRACE_REGS				9
+#define TRACE_SEGS				6
+#define TRACE_MASK_BIG			0x8000
+#define TRACE_RECORD_MAX		(2+4+1+TRACE_CODE_BYTES+1+TRACE_RES_BYTES+(TRACE_REGS*4)+(TRACE_SEGS*2))
+#define TRACE_BUFFER_SIZE		(1024*1024)
+#define TRACE_LENGTH_CACHE		1024
+
+static Bit8u*	cpuBinLogBuf = NULL;
+static Bitu		cpuBinLogPos = 0;
+static Bit32u	cpuBinLogRegs[TRACE_REGS];
+static Bit16u	cpuBinLogSegs[TRACE_SEGS];
+static bool		cpuBinLogFirst = true;
+
+static const char* const trace_reg_names[TRACE_REGS] = { "EAX","ECX","EDX","EBX","ESP","EBP","ESI","EDI","FLG" };
+static const char* const trace_seg_names[TRACE_SEGS] = { "ES","CS","SS","DS","FS","GS" };
+
+/* Copies up to TRACE_CODE_BYTES from start through the host pointers of the
+ * pages. Pages without one (MMIO, unmapped, not present) end the copy, so
+ * tracing never causes device side effects or guest page faults. */
+static Bitu FetchCodeBytes(PhysPt start, Bit8u* code) {
+	Bitu got = 0;
+	while (got < TRACE_CODE_BYTES) {
+		PhysPt adr = start+(PhysPt)got;
+		Bitu page = adr >> 12;
+		if (!PAGING_MakePhysPage(page)) break;
+		PageHandler* handler = MEM_GetPageHandler(page);
+		if (!(handler->flags & PFLAG_READABLE)) break;
+		HostPt host = handler->GetHostReadPt(page);
+		if (host == NULL) break;
+		Bitu ofs = adr & 4095;
+		Bitu count = 4096-ofs;
+		if (count > TRACE_CODE_BYTES-got) count = TRACE_CODE_BYTES-got;
+		memcpy(code+got,host+ofs,count);
+		got += count;
+	}
+	return got;
+}
+
+/* Instruction lengths by address, so that loops don't run the disassembler
+ * over and over. An entry is only used while the bytes it was decoded from
+ * are unchanged, which also covers self modifying code. */
+struct TraceLengthEntry {
+	PhysPt	adr;
+	bool	big;
+	Bit8u	len;
+	Bit8u	code[TRACE_CODE_BYTES];
+};
+static TraceLengthEntry traceLengthCache[TRACE_LENGTH_CACHE];
+
+static Bitu TraceInstructionLength(PhysPt start, const Bit8u* code, Bitu avail, bool big) {
+	TraceLengthEntry& e = traceLengthCache[(start ^ (start >> 10)) & (TRACE_LENGTH_CACHE-1)];
+	if (e.len != 0 && e.adr == start && e.big == big && e.len <= avail && memcmp(e.code,code,e.len) == 0)
+		return e.len;
+
+	char dline[200];
+	Bitu len = DasmI386Buffer(dline, code, avail, 0, big);
+	if (len > avail) len = avail;
+	e.adr = start;
+	e.big = big;
+	e.len = (Bit8u)len;
+	memcpy(e.code,code,len);
+	return len;
+}
+
+/* Fetches the instruction at cs:eip into code and returns its length. With
+ * EXTEND on, res receives the memory operand column of the code window. */
+static Bitu FetchInstruction(Bit8u* code, char* res) {
+	PhysPt start = (PhysPt)GetAddress(SegValue(cs),reg_eip);
+	Bitu avail = FetchCodeBytes(start,code);
+	res[0] = 0;
+	if (avail == 0) return 0;
+	if (!showExtend) return TraceInstructionLength(start,code,avail,cpu.code.big);
+
+	char dline[200];
+	Bitu len = DasmI386Buffer(dline, code, avail, reg_eip, cpu.code.big);
+	if (len > avail) len = avail;
+	char* analysis = AnalyzeInstruction(dline,false);
+	if (analysis) {
+		strncpy(res,analysis,TRACE_RES_BYTES-1);
+		res[TRACE_RES_BYTES-1] = 0;
+	}
+	return len;
+}
+
+static bool OpenBinLog(const char* name) {
+	cpuBinLogFile = fopen(name,"wb");
+	if (cpuBinLogFile == NULL) return false;
+	if (cpuBinLogBuf == NULL) cpuBinLogBuf = new Bit8u[TRACE_BUFFER_SIZE];
+	fwrite(TRACE_SIGNATURE,8,1,cpuBinLogFile);
+	cpuBinLogPos = 0;
+	cpuBinLogFirst = true;
+	return true;
+}
+
+static void CloseBinLog(void) {
+	if (cpuBinLogFile == NULL) return;
+	if (cpuBinLogPos != 0) fwrite(cpuBinLogBuf,cpuBinLogPos,1,cpuBinLogFile);
+	fclose(cpuBinLogFile);
+	cpuBinLogFile = NULL;
+	cpuBinLogPos = 0;
+	cpuBinLogCounter = 0;
+	cpuBinLogEndless = false;
+}
+
+static void LogInstructionBin(void) {
+	Bit32u regs[TRACE_REGS];
+	Bit16u segs[TRACE_SEGS];
+	Bit16u mask = cpu.code.big ? TRACE_MASK_BIG : 0;
+	Bitu i;
+
+	regs[0] = reg_eax; regs[1] = reg_ecx; regs[2] = reg_edx; regs[3] = reg_ebx;
+	regs[4] = reg_esp; regs[5] = reg_ebp; regs[6] = reg_esi; regs[7] = reg_edi;
+	regs[8] = (Bit32u)FillFlags();
+	segs[0] = SegValue(es); segs[1] = SegValue(cs); segs[2] = SegValue(ss);
+	segs[3] = SegValue(ds); segs[4] = SegValue(fs); segs[5] = SegValue(gs);
+
+	for (i=0;i < TRACE_REGS;i++) {
+		if (cpuBinLogFirst || regs[i] != cpuBinLogRegs[i]) mask |= 1u << i;
+	}
+	for (i=0;i < TRACE_SEGS;i++) {
+		if (cpuBinLogFirst || segs[i] != cpuBinLogSegs[i]) mask |= 1u << (TRACE_REGS+i);
+	}
+	cpuBinLogFirst = false;
+
+	if ((cpuBinLogPos+TRACE_RECORD_MAX) > TRACE_BUFFER_SIZE) {
+		fwrite(cpuBinLogBuf,cpuBinLogPos,1,cpuBinLogFile);
+		cpuBinLogPos = 0;
+	}
+
+	Bit8u* w = cpuBinLogBuf+cpuBinLogPos;
+	host_writew(w,mask); w += 2;
+	host_writed(w,reg_eip); w += 4;
+	char res[TRACE_RES_BYTES];
+	Bitu len = FetchInstruction(w+1,res);
+	*w = (Bit8u)len; w += 1+len;
+	len = strlen(res);
+	*w = (Bit8u)len; w++;
+	memcpy(w,res,len); w += len;
+	for (i=0;i < TRACE_REGS;i++) {
+		if (mask & (1u << i)) {
+			host_writed(w,regs[i]); w += 4;
+			cpuBinLogRegs[i] = regs[i];
+		}
+	}
+	for (i=0;i < TRACE_SEGS;i++) {
+		if (mask & (1u << (TRACE_REGS+i))) {
+			host_writew(w,segs[i]); w += 2;
+			cpuBinLogSegs[i] = segs[i];
+		}
+	}
+	cpuBinLogPos = (Bitu)(w-cpuBinLogBuf);
+}
+
+static void DecodeBinLog(const char* inname, const char* outname) {
+	FILE* in = fopen(inname,"rb");
+	if (in == NULL) {
+		DEBUG_ShowMsg("DEBUG: Can't open %s.\n",inname);
+		return;
+	}
+	char sig[8];
+	if (fread(sig,8,1,in) != 1 || memcmp(sig,TRACE_SIGNATURE,8) != 0) {
+		DEBUG_ShowMsg("DEBUG: %s is not a cpu trace.\n",inname);
+		fclose(in);
+		return;
+	}
+	FILE* out = fopen(outname,"wt");
+	if (out == NULL) {
+		DEBUG_ShowMsg("DEBUG: Can't create %s.\n",outname);
+		fclose(in);
+		return;
+	}
+
+	Bit32u regs[TRACE_REGS] = {0};
+	Bit16u segs[TRACE_SEGS] = {0};
+	Bit8u code[TRACE_CODE_BYTES];
+	char res[TRACE_RES_BYTES];
+	Bit8u tmp[4];
+	Bit32u count = 0;
+	Bitu i;
+	while (fread(tmp,2,1,in) == 1) {
+		Bit16u mask = host_readw(tmp);
+		if (fread(tmp,4,1,in) != 1) break;
+		Bit32u eip = host_readd(tmp);
+		if (fread(tmp,1,1,in) != 1) break;
+		Bitu codelen = tmp[0];
+		if (codelen > TRACE_CODE_BYTES) break;
+		if (codelen != 0 && fread(code,codelen,1,in) != 1) break;
+		if (fread(tmp,1,1,in) != 1) break;
+		Bitu reslen = tmp[0];
+		if (reslen >= TRACE_RES_BYTES) break;
+		if (reslen != 0 && fread(res,reslen,1,in) != 1) break;
+		res[reslen] = 0;
+		for (i=0;i < TRACE_REGS;i++) {
+			if (!(mask & (1u << i))) continue;
+			if (fread(tmp,4,1,in) != 1) break;
+			regs[i] = host_readd(tmp);
+		}
+		if (i != TRACE_REGS) break;
+		for (i=0;i < TRACE_SEGS;i++) {
+			if (!(mask & (1u << (TRACE_REGS+i)))) continue;
+			if (fread(tmp,2,1,in) != 1) break;
+			segs[i] = host_readw(tmp);
+		}
+		if (i != TRACE_SEGS) break;
+
+		char dline[200];
+		if (codelen != 0) DasmI386Buffer(dline, code, codelen, eip, (mask & TRACE_MASK_BIG) != 0);
+		else strcpy(dline,"(not in RAM)");
+		char ibytes[TRACE_CODE_BYTES*3+1];
+		ibytes[0] = 0;
+		for (Bitu j=0;j < codelen;j++) sprintf(ibytes+j*3,"%02X ",code[j]);
+		fprintf(out,"%04X:%08X  %-30s  %-22s  %-21s",segs[1],eip,dline,res,ibytes);
+		for (i=0;i < TRACE_REGS;i++) fprintf(out," %s:%08X",trace_reg_names[i],regs[i]);
+		for (i=0;i < TRACE_SEGS;i++) fprintf(out," %s:%04X",trace_seg_names[i],segs[i]);
+		fprintf(out,"\n");
+		count++;
+	}
+	fclose(out);
+	fclose(in);
+	DEBUG_ShowMsg("DEBUG: Decoded %u instructions.\n",(unsigned int)count);
+}
 #endif
 
 #if 0
@@ -3235,36 +3751,22 @@ struct TLogInst {
 	bool a;
 	bool p;
 	bool i;
-	char dline[31];
-	char res[23];
+	bool big;
+	Bit8u len;
+	Bit8u code[TRACE_CODE_BYTES];
+	char res[TRACE_RES_BYTES];
 };
 
 TLogInst logInst[LOGCPUMAX];
 
+// Only the raw state is recorded here, disassembly is done when the log
+// is written out, so logging costs a copy instead of a disassembly.
 void DEBUG_HeavyLogInstruction(void) {
-
-	static char empty[23] = { 32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,0 };
-
-	PhysPt start = GetAddress(SegValue(cs),reg_eip);
-	char dline[200];
-	DasmI386(dline, start, reg_eip, cpu.code.big);
-	char* res = empty;
-	if (showExtend) {
-		res = AnalyzeInstruction(dline,false);
-		if (!res || !(*res)) res = empty;
-		Bitu reslen = strlen(res);
-		if (reslen<22) for (Bitu i=0; i<22-reslen; i++) res[reslen+i] = ' '; res[22] = 0;
-	};
-
-	Bitu len = strlen(dline);
-	if (len < 30) for (Bitu i=0; i < 30-len; i++) dline[len+i] = ' ';
-	dline[30] = 0;
-
 	TLogInst & inst = logInst[logCount];
-	strcpy(inst.dline,dline);
+	inst.len  = (Bit8u)FetchInstruction(inst.code,inst.res);
+	inst.big  = cpu.code.big;
 	inst.s_cs = SegValue(cs);
 	inst.eip  = reg_eip;
-	strcpy(inst.res,res);
 	inst.eax  = reg_eax;
 	inst.ebx  = reg_ebx;
 	inst.ecx  = reg_ecx;
@@ -3305,8 +3807,19 @@ void DEBUG_HeavyWriteLogInstruction(void) {
 	do {
 		// Write Instructions
 		TLogInst & inst = logInst[startLog];
+		char dline[200];
+		if (inst.len != 0) DasmI386Buffer(dline, inst.code, inst.len, inst.eip, inst.big);
+		else strcpy(dline,"(not in RAM)");
+		Bitu len = strlen(dline);
+		if (len < 30) for (Bitu i=0; i < 30-len; i++) dline[len+i] = ' ';
+		dline[30] = 0;
+		char res[TRACE_RES_BYTES];
+		strcpy(res,inst.res);
+		len = strlen(res);
+		for (Bitu i=len; i < TRACE_RES_BYTES-1; i++) res[i] = ' ';
+		res[TRACE_RES_BYTES-1] = 0;
 		out << setw(4) << inst.s_cs << ":" << setw(8) << inst.eip << "  " 
-		    << inst.dline << "  " << inst.res << " EAX:" << setw(8)<< inst.eax
+		    << dline << "  " << res << " EAX:" << setw(8)<< inst.eax
 		    << " EBX:" << setw(8) << inst.ebx << " ECX:" << setw(8) << inst.ecx
 		    << " EDX:" << setw(8) << inst.edx << " ESI:" << setw(8) << inst.esi
 		    << " EDI:" << setw(8) << inst.edi << " EBP:" << setw(8) << inst.ebp
@@ -3330,6 +3843,20 @@ void DEBUG_HeavyWriteLogInstruction(void) {
 
 bool DEBUG_HeavyIsBreakpoint(void) {
 	static Bitu zero_count = 0;
+	if (cpuBinLogFile != NULL && cpuBinLogEndless) {
+		LogInstructionBin();
+	} else if (cpuBinLogFile != NULL) {
+		if (cpuBinLogCounter>0) {
+			LogInstructionBin();
+			cpuBinLogCounter--;
+		}
+		if (cpuBinLogCounter==0) {
+			CloseBinLog();
+			DEBUG_ShowMsg("DEBUG: cpu trace LOGCPU.BIN created\n");
+			DEBUG_EnableDebugger();
+			return true;
+		}
+	}
 	if (cpuLog) {
 		if (cpuLogCounter>0) {
 			LogInstruction(SegValue(cs),reg_eip,cpuLogFile);
@@ -3372,6 +3899,10 @@ void DEBUG_StopLog(void) {
         DEBUG_ShowMsg("DEBUG: cpu log LOGCPU.TXT stopped\n");
         cpuLog = false;
     }
+    if (cpuBinLogFile != NULL) {
+        CloseBinLog();
+        DEBUG_ShowMsg("DEBUG: cpu trace LOGCPU.BIN stopped\n");
+    }
 }
 
 #endif // HEAVY DEBUG
@@ -461,9 +461,18 @@ static char *addr_to_hex(UINT32 addr, int splitup) {
 static PhysPt getbyte_mac;
 static PhysPt startPtr;
 
+/* when set, instruction bytes come from this buffer instead of guest memory */
+static const Bit8u* getbyte_buf = NULL;
+static Bitu getbyte_buflen = 0;
+
 static UINT8 getbyte(void) {
     Bit8u c;
 
+	if (getbyte_buf != NULL) {
+		Bitu ofs = (Bitu)(getbyte_mac++ - startPtr);
+		return (ofs < getbyte_buflen) ? getbyte_buf[ofs] : 0xFF;
+	}
+
 	if (!mem_readb_checked(getbyte_mac++,&c))
         return c;
 
@@ -1118,6 +1127,19 @@ Bitu DasmI386(char* buffer, PhysPt pc, Bitu cur_ip, bool bit32)
 	return getbyte_mac-pc;
 }
 
+/* disassemble from a copy of the instruction bytes, e.g. from a cpu trace */
+Bitu DasmI386Buffer(char* buffer, const Bit8u* bytes, Bitu len, Bitu cur_ip, bool bit32)
+{
+	Bitu size;
+
+	getbyte_buf = bytes;
+	getbyte_buflen = len;
+	size = DasmI386(buffer, 0, cur_ip, bit32);
+	getbyte_buf = NULL;
+	getbyte_buflen = 0;
+	return size;
+}
+
 int DasmLastOperandSize()
 {
 	return opsize;
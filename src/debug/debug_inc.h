@@ -117,6 +117,7 @@ extern DBGBlock dbg;
 
 /* Local Debug Stuff */
 Bitu DasmI386(char* buffer, PhysPt pc, Bitu cur_ip, bool bit32);
+Bitu DasmI386Buffer(char* buffer, const Bit8u* bytes, Bitu len, Bitu cur_ip, bool bit32);
 int  DasmLastOperandSize(void);
 #endif
 
@@ -45,6 +45,7 @@
 #include "video.h"
 #include <time.h>
 #include "menu.h"
+#include "selftest.h"
 bool Mouse_Drv=true;
 bool Mouse_Vertical = false;
 
@@ -4711,6 +4712,7 @@ void DOS_SetupPrograms(void) {
 	PROGRAMS_MakeFile("A20GATE.COM",A20GATE_ProgramStart);
 	PROGRAMS_MakeFile("SHOWGUI.COM",SHOWGUI_ProgramStart);
 	PROGRAMS_MakeFile("NMITEST.COM",NMITEST_ProgramStart);
+	PROGRAMS_MakeFile("SELFTEST.COM",SELFTEST_ProgramStart);
     PROGRAMS_MakeFile("RE-DOS.COM",REDOS_ProgramStart);
 
 	if (IS_VGA_ARCH && svgaCard != SVGA_None)
@@ -21,6 +21,7 @@
 #include "dos_inc.h"
 #include "support.h"
 #include "cross.h"
+#include "pic.h"
 
 // STL stuff
 #include <vector>
@@ -32,6 +33,12 @@
 #include <windows.h>
 #endif
 
+#if C_HAVE_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
 #if defined (OS2)
 #define INCL_DOSERRORS
 #define INCL_DOSFILEMGR
@@ -69,6 +76,10 @@ DOS_Drive_Cache::DOS_Drive_Cache(void) {
 	for (Bit32u i=0; i<MAX_OPENDIRS; i++) { dirSearch[i] = 0; dirFindFirst[i] = 0; };
 	SetDirSort(DIRALPHABETICAL);
 	updatelabel = true;
+	watchMode		= WATCH_OFF;
+	watchFd			= -1;
+	watchPollTicks	= 0;
+	lastLookup		= 0;
 }
 
 DOS_Drive_Cache::DOS_Drive_Cache(const char* path, DOS_Drive *drive) {
@@ -79,6 +90,10 @@ DOS_Drive_Cache::DOS_Drive_Cache(const char* path, DOS_Drive *drive) {
 	nextFreeFindFirst	= 0;
 	for (Bit32u i=0; i<MAX_OPENDIRS; i++) { dirSearch[i] = 0; dirFindFirst[i] = 0; };
 	SetDirSort(DIRALPHABETICAL);
+	watchMode		= WATCH_OFF;
+	watchFd			= -1;
+	watchPollTicks	= 0;
+	lastLookup		= 0;
 	SetBaseDir(path,drive);
 	updatelabel = true;
 }
@@ -86,12 +101,24 @@ DOS_Drive_Cache::DOS_Drive_Cache(const char* path, DOS_Drive *drive) {
 DOS_Drive_Cache::~DOS_Drive_Cache(void) {
 	Clear();
 	for (Bit32u i=0; i<MAX_OPENDIRS; i++) { DeleteFileInfo(dirFindFirst[i]); dirFindFirst[i]=0; };
+#if C_HAVE_INOTIFY
+	if (watchFd >= 0) close(watchFd);
+#endif
 }
 
 void DOS_Drive_Cache::Clear(void) {
 	DeleteFileInfo(dirBase); dirBase = 0;
 	nextFreeFindFirst	= 0;
 	for (Bit32u i=0; i<MAX_OPENDIRS; i++) dirSearch[i] = 0;
+	FlushLookups();
+}
+
+/* The resolved paths are only valid as long as the cached directories don't
+ * change, so anything that adds, removes or reads in entries drops them all.
+ * Opening files is far more common than changing the directories. */
+void DOS_Drive_Cache::FlushLookups(void) {
+	lookups.clear();
+	lastLookup = 0;
 }
 
 void DOS_Drive_Cache::EmptyCache(void) {
@@ -100,6 +127,7 @@ void DOS_Drive_Cache::EmptyCache(void) {
 	dirBase		= new CFileInfo;
 	save_dir	= 0;
 	srchNr		= 0;
+	watchPoll.clear();
 	SetBaseDir(basePath,drive);
 }
 
@@ -170,6 +198,14 @@ char* DOS_Drive_Cache::GetExpandName(const char* path) {
 	static char work [CROSS_LEN] = { 0 };
 	char dir [CROSS_LEN]; 
 
+	std::map<std::string,CLookup>::iterator it = lookups.find(path);
+	if (it != lookups.end()) {
+		lastLookup = &it->second;
+		strcpy(work,it->second.expanded.c_str());
+		return work;
+	}
+	lastLookup = 0;
+
 	work[0] = 0;
 	strcpy (dir,path);
 
@@ -195,6 +231,12 @@ char* DOS_Drive_Cache::GetExpandName(const char* path) {
 			work[len-1] = 0; // Remove trailing slashes except when in root
 		}
 	}
+
+	if (lookups.size() >= 4096) FlushLookups();
+	CLookup &lookup = lookups[path];
+	lookup.expanded = work;
+	lookup.type = FILETYPE_UNKNOWN;
+	lastLookup = &lookup;
 	return work;
 }
 
@@ -214,6 +256,7 @@ void DOS_Drive_Cache::AddEntry(const char* path, bool checkExists) {
 		}
 
 		CreateEntry(dir,file,false);
+		FlushLookups();
 
 		Bits index = GetLongName(dir,file);
 		if (index>=0) {
@@ -266,6 +309,10 @@ void DOS_Drive_Cache::CacheOut(const char* path, bool ignoreLastDir) {
 	}
 
 //	LOG_DEBUG("DIR: Caching out %s : dir %s",expand,dir->orgname);
+	CacheOutDir(dir);
+}
+
+void DOS_Drive_Cache::CacheOutDir(CFileInfo* dir) {
 //	clear cache first?
 	for (Bit32u i=0; i<MAX_OPENDIRS; i++) {
 		dirSearch[i] = 0; //free[i] = true;    
@@ -279,6 +326,7 @@ void DOS_Drive_Cache::CacheOut(const char* path, bool ignoreLastDir) {
 	dir->fileList.clear();
 	dir->longNameList.clear();
 	save_dir = 0;
+	FlushLookups();
 }
 
 bool DOS_Drive_Cache::IsCachedIn(CFileInfo* curDir) {
@@ -773,6 +821,9 @@ bool DOS_Drive_Cache::ReadDir(Bit16u id, char* &result) {
 
 		// close dir
 		drive->closedir(dirp);
+		FlushLookups();
+
+		if (watchMode != WATCH_OFF) WatchDir(dirPath);
 
 		// Info
 /*		if (!dirp) {
@@ -889,3 +940,130 @@ void DOS_Drive_Cache::DeleteFileInfo(CFileInfo *dir) {
 		ClearFileInfo(dir);
 	delete dir;
 }
+
+/* Host change tracking, used instead of emptying the whole cache on every call
+ * for drives mounted with -nocachedir. Every directory that gets cached in is
+ * watched, and when the host reports a change to one only that directory (and
+ * what hangs below it) is cached out and read again on the next access.
+ * With inotify the kernel queues the changes for us, otherwise the cached
+ * directories are stat()ed at most every 100ms and compared by mtime. */
+bool DOS_Drive_Cache::WatchHostChanges(bool allowPoll) {
+	if (watchMode == WATCH_OFF) {
+#if C_HAVE_INOTIFY
+		watchFd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+		if (watchFd >= 0) watchMode = WATCH_NOTIFY;
+		else LOG(LOG_DOSMISC,LOG_WARN)("DIRCACHE: inotify not available (%s), polling for host changes",strerror(errno));
+#endif
+		if (watchMode == WATCH_OFF) watchMode = WATCH_POLL;
+		// the directories cached in so far are not watched
+		EmptyCache();
+	}
+	return (watchMode == WATCH_NOTIFY) || allowPoll;
+}
+
+void DOS_Drive_Cache::WatchDir(const char* path) {
+#if C_HAVE_INOTIFY
+	if (watchMode == WATCH_NOTIFY) {
+		int wd = drive->watch_directory(watchFd,path);
+		if (wd >= 0) {
+			watchNotify[wd] = path;
+			return;
+		}
+		// out of watches (fs.inotify.max_user_watches), poll this one
+	}
+#endif
+	PollInfo info;
+	if (drive->stat_directory(path,info.mtime)) {
+		info.readtime = time(NULL);
+	} else {
+		// can't tell, rescan it every time
+		info.mtime = info.readtime = 0;
+	}
+	watchPoll[path] = info;
+}
+
+DOS_Drive_Cache::CFileInfo* DOS_Drive_Cache::FindCachedDir(const char* path) {
+	// walk the cache along the host names, without reading anything in
+	size_t len = strlen(basePath);
+	if (strncmp(path,basePath,len) != 0) return 0;
+
+	char dir[CROSS_LEN];
+	const char* start = path + len;
+	CFileInfo* curDir = dirBase;
+	while (curDir && *start) {
+		const char* pos = strchr(start,CROSS_FILESPLIT);
+		len = pos ? (size_t)(pos - start) : strlen(start);
+		safe_strncpy(dir,start,len+1);
+		start += pos ? len+1 : len;
+
+		CFileInfo* nextDir = 0;
+		for (Bitu i=0; i<curDir->fileList.size(); i++) {
+			if (curDir->fileList[i]->isDir && (strcmp(curDir->fileList[i]->orgname,dir) == 0)) {
+				nextDir = curDir->fileList[i];
+				break;
+			}
+		}
+		curDir = nextDir;
+	}
+	return curDir;
+}
+
+void DOS_Drive_Cache::PollDirs(void) {
+	if (watchPoll.empty() || (PIC_Ticks - watchPollTicks) < 100) return;
+	watchPollTicks = PIC_Ticks;
+
+	time_t now = time(NULL);
+	std::vector<std::string> changed;
+	std::map<std::string,PollInfo>::iterator it;
+	for (it=watchPoll.begin(); it!=watchPoll.end(); ++it) {
+		time_t mtime;
+		if (!drive->stat_directory(it->first.c_str(),mtime) || (mtime != it->second.mtime) ||
+			// modified in the second it was read in, mtime can't tell whether that was before or after
+			((it->second.mtime >= it->second.readtime) && (now > it->second.readtime)))
+			changed.push_back(it->first);
+	}
+	for (Bitu i=0; i<changed.size(); i++) {
+		const std::string &path = changed[i];
+		// the directories below are cached out with it
+		it = watchPoll.lower_bound(path);
+		while ((it != watchPoll.end()) && (it->first.compare(0,path.size(),path) == 0)) watchPoll.erase(it++);
+
+		CFileInfo* dir = FindCachedDir(path.c_str());
+		if (dir && IsCachedIn(dir)) CacheOutDir(dir);
+	}
+}
+
+void DOS_Drive_Cache::CheckHostChanges(void) {
+#if C_HAVE_INOTIFY
+	if (watchMode == WATCH_NOTIFY) {
+		Bit32u buf[1024];	// aligned for struct inotify_event
+		bool overflow = false;
+		ssize_t len;
+		while ((len = read(watchFd,buf,sizeof(buf))) > 0) {
+			ssize_t ofs = 0;
+			while (ofs < len) {
+				const struct inotify_event* ev = (const struct inotify_event*)((const char*)buf + ofs);
+				ofs += (ssize_t)(sizeof(struct inotify_event) + ev->len);
+
+				if (ev->mask & (IN_Q_OVERFLOW|IN_UNMOUNT)) {
+					overflow = true;
+					continue;
+				}
+				std::map<int,std::string>::iterator it = watchNotify.find(ev->wd);
+				if (it == watchNotify.end()) continue;
+				if (ev->mask & IN_IGNORED) {
+					watchNotify.erase(it);
+					continue;
+				}
+				CFileInfo* dir = FindCachedDir(it->second.c_str());
+				if (dir && IsCachedIn(dir)) CacheOutDir(dir);
+			}
+		}
+		if (overflow) {
+			LOG(LOG_DOSMISC,LOG_NORMAL)("DIRCACHE: Lost track of host changes, emptying cache");
+			EmptyCache();
+		}
+	}
+#endif
+	if (watchMode != WATCH_OFF) PollDirs();
+}
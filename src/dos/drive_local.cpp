@@ -31,6 +31,9 @@
 #include "inout.h"
 #ifndef WIN32
 #include <utime.h>
+#if C_HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
 #else
 #include <sys/utime.h>
 #include <sys/locking.h>
@@ -351,8 +354,25 @@ char *CodePageHostToGuest(const host_cnv_char_t *s) {
     return (char*)cpcnv_temp;
 }
 
+/* stat() the path the directory cache expanded last. Whether a file or a
+ * directory is there is kept with the expanded path, so programs that test
+ * for the same files over and over don't go to the host every time. Files
+ * and missing names are only taken from there while host changes are
+ * watched (-nocachedir), see DOS_Drive_Cache::GetExpandedType(). */
+static DOS_Drive_Cache::TFileType StatExpanded(DOS_Drive_Cache &dirCache,const host_cnv_char_t *host_name) {
+	DOS_Drive_Cache::TFileType type = dirCache.GetExpandedType();
+	if (type == DOS_Drive_Cache::FILETYPE_UNKNOWN) {
+		ht_stat_t status;
+		if (ht_stat(host_name,&status) != 0) type = DOS_Drive_Cache::FILETYPE_NONE;
+		else if (status.st_mode & S_IFDIR) type = DOS_Drive_Cache::FILETYPE_DIR;
+		else type = DOS_Drive_Cache::FILETYPE_FILE;
+		dirCache.SetExpandedType(type);
+	}
+	return type;
+}
+
 bool localDrive::FileCreate(DOS_File * * file,const char * name,Bit16u /*attributes*/) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
     if (readonly) {
 		DOS_SetError(DOSERR_WRITE_PROTECTED);
@@ -396,7 +416,8 @@ bool localDrive::FileCreate(DOS_File * * file,const char * name,Bit16u /*attribu
 		return false;
 	}
    
-	if(!existing_file) {
+	if(existing_file) dirCache.SetExpandedType(DOS_Drive_Cache::FILETYPE_FILE);
+	else {
 		strcpy(newname,basedir);
 		strcat(newname,name);
 		CROSS_FILENAME(newname);
@@ -411,7 +432,7 @@ bool localDrive::FileCreate(DOS_File * * file,const char * name,Bit16u /*attribu
 }
 
 bool localDrive::FileOpen(DOS_File * * file,const char * name,Bit32u flags) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
     if (readonly) {
         if ((flags&0xf) == OPEN_WRITE || (flags&0xf) == OPEN_READWRITE) {
@@ -435,6 +456,8 @@ bool localDrive::FileOpen(DOS_File * * file,const char * name,Bit32u flags) {
 	strcat(newname,name);
 	CROSS_FILENAME(newname);
 	dirCache.ExpandName(newname);
+	// known not to be there
+	if (dirCache.GetExpandedType() == DOS_Drive_Cache::FILETYPE_NONE) return false;
 
 	//Flush the buffer of handles for the same file. (Betrayal in Antara)
 	Bit8u i,drive=DOS_DRIVES;
@@ -467,6 +490,7 @@ bool localDrive::FileOpen(DOS_File * * file,const char * name,Bit32u flags) {
 #endif
 //	Bit32u err=errno;
 	if (!hand) { 
+		if (errno == ENOENT) dirCache.SetExpandedType(DOS_Drive_Cache::FILETYPE_NONE);
 		if((flags&0xf) != OPEN_READ) {
 #ifdef host_cnv_use_wchar
 			FILE * hmm=_wfopen(host_name,L"rb");
@@ -606,10 +630,10 @@ bool localDrive::FindFirst(const char * _dir,DOS_DTA & dta,bool fcb_findfirst) {
 	strcat(tempDir,_dir);
 	CROSS_FILENAME(tempDir);
 
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
 	if (allocation.mediaid==0xF0 ) {
-		EmptyCache(); //rescan floppie-content on each findfirst
+		RefreshCache(false); //rescan floppie-content on each findfirst, unless the host reports changes
 	}
     
 	char end[2]={CROSS_FILESPLIT,0};
@@ -727,7 +751,7 @@ again:
 }
 
 bool localDrive::GetFileAttr(const char * name,Bit16u * attr) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
 	char newname[CROSS_LEN];
 	strcpy(newname,basedir);
@@ -743,10 +767,10 @@ bool localDrive::GetFileAttr(const char * name,Bit16u * attr) {
         return false;
     }
 
-	ht_stat_t status;
-	if (ht_stat(host_name,&status)==0) {
+	DOS_Drive_Cache::TFileType type = StatExpanded(dirCache,host_name);
+	if (type != DOS_Drive_Cache::FILETYPE_NONE) {
 		*attr=DOS_ATTR_ARCHIVE;
-		if(status.st_mode & S_IFDIR) *attr|=DOS_ATTR_DIRECTORY;
+		if(type == DOS_Drive_Cache::FILETYPE_DIR) *attr|=DOS_ATTR_DIRECTORY;
 		return true;
 	}
 	*attr=0;
@@ -754,7 +778,7 @@ bool localDrive::GetFileAttr(const char * name,Bit16u * attr) {
 }
 
 bool localDrive::MakeDir(const char * dir) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
     if (readonly) {
         DOS_SetError(DOSERR_WRITE_PROTECTED);
@@ -787,7 +811,7 @@ bool localDrive::MakeDir(const char * dir) {
 }
 
 bool localDrive::RemoveDir(const char * dir) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
     if (readonly) {
         DOS_SetError(DOSERR_WRITE_PROTECTED);
@@ -819,7 +843,7 @@ bool localDrive::RemoveDir(const char * dir) {
 }
 
 bool localDrive::TestDir(const char * dir) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
 	char newdir[CROSS_LEN];
 	strcpy(newdir,basedir);
@@ -838,9 +862,8 @@ bool localDrive::TestDir(const char * dir) {
 	size_t len = strlen(newdir);
 	if (len && (newdir[len-1]!='\\')) {
 		// It has to be a directory !
-		ht_stat_t test;
-		if (ht_stat(host_name,&test))		return false;
-		if ((test.st_mode & S_IFDIR)==0)	return false;
+		if (StatExpanded(dirCache,host_name) != DOS_Drive_Cache::FILETYPE_DIR) return false;
+		return true;
 	};
 	int temp=ht_access(host_name,F_OK);
 	return (temp==0);
@@ -909,7 +932,7 @@ bool localDrive::AllocationInfo(Bit16u * _bytes_sector,Bit8u * _sectors_cluster,
 }
 
 bool localDrive::FileExists(const char* name) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
 	char newname[CROSS_LEN];
 	strcpy(newname,basedir);
@@ -924,14 +947,11 @@ bool localDrive::FileExists(const char* name) {
         return false;
     }
 
-	ht_stat_t temp_stat;
-	if(ht_stat(host_name,&temp_stat)!=0) return false;
-	if(temp_stat.st_mode & S_IFDIR) return false;
-	return true;
+	return (StatExpanded(dirCache,host_name) == DOS_Drive_Cache::FILETYPE_FILE);
 }
 
 bool localDrive::FileStat(const char* name, FileStat_Block * const stat_block) {
-    if (nocachedir) EmptyCache();
+    if (nocachedir) RefreshCache(true);
 
 	char newname[CROSS_LEN];
 	strcpy(newname,basedir);
@@ -1030,6 +1050,44 @@ next:
     return false;
 }
 
+int localDrive::watch_directory(int watch_fd, const char *dir) {
+#if C_HAVE_INOTIFY
+    // guest to host code page translation
+    host_cnv_char_t *host_name = CodePageGuestToHost(dir);
+    if (host_name == NULL) return -1;
+
+    // only changes to the directory listing matter to the cache
+    return inotify_add_watch(watch_fd,host_name,IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR);
+#else
+    (void)watch_fd;
+    (void)dir;
+    return -1;
+#endif
+}
+
+bool localDrive::stat_directory(const char *dir, time_t &mtime) {
+    char newdir[CROSS_LEN];
+    strcpy(newdir,dir);
+    // stat() on Windows does not like trailing slashes
+    size_t len = strlen(newdir);
+    if ((len > 1) && (newdir[len-1] == CROSS_FILESPLIT) && (newdir[len-2] != ':')) newdir[len-1] = 0;
+
+    // guest to host code page translation
+    host_cnv_char_t *host_name = CodePageGuestToHost(newdir);
+    if (host_name == NULL) return false;
+
+    ht_stat_t status;
+    if (ht_stat(host_name,&status) != 0) return false;
+    mtime = status.st_mtime;
+    return true;
+}
+
+void localDrive::RefreshCache(bool allowPoll) {
+    // pick up changes made on the host, rescanning everything is the last resort
+    if (dirCache.WatchHostChanges(allowPoll)) dirCache.CheckHostChanges();
+    else EmptyCache();
+}
+
 localDrive::localDrive(const char * startdir,Bit16u _bytes_sector,Bit8u _sectors_cluster,Bit16u _total_clusters,Bit16u _free_clusters,Bit8u _mediaid) {
 	strcpy(basedir,startdir);
 	sprintf(info,"local directory %s",startdir);
@@ -79,11 +79,14 @@ public:
 	virtual void closedir(void *handle);
 	virtual bool read_directory_first(void *handle, char* entry_name, bool& is_directory);
 	virtual bool read_directory_next(void *handle, char* entry_name, bool& is_directory);
+	virtual int watch_directory(int watch_fd, const char *dir);
+	virtual bool stat_directory(const char *dir, time_t &mtime);
 
 	virtual void EmptyCache(void) { dirCache.EmptyCache(); };
 	virtual void MediaChange() {};
 
 protected:
+	void RefreshCache(bool allowPoll);
 	DOS_Drive_Cache dirCache;
 	char basedir[CROSS_LEN];
 	friend void DOS_Shell::CMD_SUBST(char* args); 	
@@ -126,6 +129,8 @@ public:
 	virtual void closedir(void *handle);
 	virtual bool read_directory_first(void *handle, char* entry_name, bool& is_directory);
 	virtual bool read_directory_next(void *handle, char* entry_name, bool& is_directory);
+	virtual int watch_directory(int watch_fd, const char *dir) { (void)watch_fd; (void)dir; return -1; };
+	virtual bool stat_directory(const char *dir, time_t &mtime) { (void)dir; (void)mtime; return false; };
 	virtual const char *GetInfo(void);
 	virtual ~physfsDrive(void);
 };
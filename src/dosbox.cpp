@@ -45,6 +45,7 @@
  *      actual leaks among the noise and to patch them up. Thus, "valgrind hunting" --J.C. */
 
 #include <stdlib.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -164,6 +165,7 @@ bool				ticksLocked;
 bool				mono_cga=false;
 bool				ignore_opcode_63 = true;
 int				dynamic_core_cache_block_size = 32;
+int				dynamic_core_cache_size = 8;
 Bitu				VGA_BIOS_Size_override = 0;
 Bitu				VGA_BIOS_SEG = 0xC000;
 Bitu				VGA_BIOS_SEG_END = 0xC800;
@@ -295,11 +297,134 @@ extern bool allow_keyb_reset;
 
 extern bool DOSBox_Paused();
 
+/* Cycle governor ("cycle governor" in [cpu]).
+ *
+ * Host time in the main loop is charged to buckets (see cpu.h) at the points
+ * where the loop switches between CPU emulation, device events, the GUI and
+ * idling, and around the end of frame in the renderer. Every window of about
+ * 100ms the busy time is divided by the emulated time of the window. Unlike
+ * the ratio used by the default adjustment this keeps growing past 100% when
+ * emulation falls behind, so it also tells by how much.
+ *
+ * An incremental PI controller then moves log(CPU_CycleMax) toward a load of
+ * 90% of the max percentage. Working on the logarithm makes the response the
+ * same at 3000 and at 300000 cycles. */
+#define GOV_WINDOW_US		100000
+#define GOV_KP				1.0
+#define GOV_KI				2.0		/* per second */
+#define GOV_STEP_UP			0.2		/* at most +22% per window */
+#define GOV_STEP_DOWN		0.5		/* at most -40% per window */
+
+bool CPU_GovernorActive = false;
+
+static struct {
+	Bit64u stamp;					/* time of the last charge */
+	Bit64u window_start;
+	Bit64u host[CPU_GOV_MAX];		/* us charged this window */
+	Bit32u emulated;				/* ms emulated this window */
+	double error;					/* error of the previous window */
+	double load[CPU_GOV_MAX];		/* last window, fraction of the emulated time */
+	bool running;
+	bool valid;
+} governor;
+
+void CPU_GovernorCharge(unsigned int what) {
+	Bit64u now = GetTicksUs();
+
+	governor.host[what] += now - governor.stamp;
+	governor.stamp = now;
+}
+
+static void CPU_GovernorNewWindow(Bit64u now) {
+	for (unsigned int i=0;i < CPU_GOV_MAX;i++) governor.host[i] = 0;
+	governor.emulated = 0;
+	governor.window_start = now;
+	CPU_IODelayRemoved = 0;
+}
+
+static void CPU_GovernorStart(void) {
+	Bit64u now = GetTicksUs();
+
+	CPU_GovernorNewWindow(now);
+	governor.stamp = now;
+	governor.error = 0;
+	governor.running = true;
+}
+
+static void CPU_GovernorUpdate(void) {
+	Bit64u now = GetTicksUs();
+	Bit64u window = now - governor.window_start;
+
+	if (window < GOV_WINDOW_US) return;
+
+	/* skip windows without emulated time, with the adjustment suspended, or
+	 * that took far too long (host busy with something else, paused) */
+	if (governor.emulated == 0 || CPU_SkipCycleAutoAdjust || window >= (GOV_WINDOW_US * 10)) {
+		governor.error = 0;
+		CPU_GovernorNewWindow(now);
+		return;
+	}
+
+	double emulated_us = (double)governor.emulated * 1000.0;
+	double load = 0;
+	for (unsigned int i=0;i < CPU_GOV_MAX;i++) {
+		governor.load[i] = (double)governor.host[i] / emulated_us;
+		if (i != CPU_GOV_IDLE) load += governor.load[i];
+	}
+	governor.valid = true;
+
+	double error = ((double)CPU_CyclePercUsed * 0.9 / 100.0) - load;
+	double step = (GOV_KP * (error - governor.error)) + (GOV_KI * error * ((double)window / 1000000.0));
+	governor.error = error;
+	if (step > GOV_STEP_UP) step = GOV_STEP_UP;
+	else if (step < -GOV_STEP_DOWN) step = -GOV_STEP_DOWN;
+
+	double new_cmax = (double)CPU_CycleMax * exp(step);
+	if (new_cmax < CPU_CYCLES_LOWER_LIMIT) new_cmax = CPU_CYCLES_LOWER_LIMIT;
+	if (CPU_CycleLimit > 0 && new_cmax > CPU_CycleLimit) new_cmax = CPU_CycleLimit;
+	if (new_cmax > 0x7FFFFFFF) new_cmax = 0x7FFFFFFF;
+	CPU_CycleMax = (Bit32s)new_cmax;
+
+	LOG(LOG_CPU,LOG_DEBUG)("Cycle governor: load %.1f%% (cpu %.1f, dev %.1f, render %.1f, gui %.1f) over %u ms, cycles %d",
+		load * 100.0,governor.load[CPU_GOV_CPU] * 100.0,governor.load[CPU_GOV_DEVICES] * 100.0,
+		governor.load[CPU_GOV_RENDER] * 100.0,governor.load[CPU_GOV_GUI] * 100.0,
+		(unsigned int)governor.emulated,(int)CPU_CycleMax);
+
+	CPU_GovernorNewWindow(now);
+}
+
+/* for the title bar, NULL if the governor is not in control */
+const char *CPU_GovernorStatus(void) {
+	static char tmp[96];
+
+	if (!CPU_GovernorActive || !governor.valid) return NULL;
+
+	double load = 0;
+	for (unsigned int i=0;i < CPU_GOV_MAX;i++) {
+		if (i != CPU_GOV_IDLE) load += governor.load[i];
+	}
+	sprintf(tmp,"load %d%% (cpu %d dev %d render %d gui %d)",
+		(int)floor((load * 100.0) + 0.5),
+		(int)floor((governor.load[CPU_GOV_CPU] * 100.0) + 0.5),
+		(int)floor((governor.load[CPU_GOV_DEVICES] * 100.0) + 0.5),
+		(int)floor((governor.load[CPU_GOV_RENDER] * 100.0) + 0.5),
+		(int)floor((governor.load[CPU_GOV_GUI] * 100.0) + 0.5));
+	return tmp;
+}
+
 static Bitu Normal_Loop(void) {
     bool saved_allow = dosbox_allow_nonrecursive_page_fault;
     Bit32u ticksNew;
 	Bits ret;
 
+    CPU_GovernorActive = CPU_CycleGovernor && CPU_CycleAutoAdjust && !ticksLocked;
+    if (CPU_GovernorActive) {
+        if (!governor.running) CPU_GovernorStart();
+    } else {
+        governor.running = false;
+        governor.valid = false;
+    }
+
     if (!menu.hidecycles || menu.showrt) { /* sdlmain.cpp/render.cpp doesn't even maintain the frames count when hiding cycles! */
         ticksNew = GetTicks();
         if (ticksNew >= Ticks) {
@@ -323,6 +448,8 @@ static Bitu Normal_Loop(void) {
     try {
         while (1) {
             if (PIC_RunQueue()) {
+                if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_DEVICES);
+
                 /* now is the time to check for the NMI (Non-maskable interrupt) */
                 CPU_Check_NMI();
 
@@ -331,6 +458,8 @@ static Bitu Normal_Loop(void) {
                 ret = (*cpudecoder)();
                 dosbox_allow_nonrecursive_page_fault = saved_allow;
 
+                if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_CPU);
+
                 if (GCC_UNLIKELY(ret<0))
                     return 1;
 
@@ -344,6 +473,7 @@ static Bitu Normal_Loop(void) {
                     dosbox_allow_nonrecursive_page_fault = false;
                     Bitu blah = (*CallBack_Handlers[ret])();
                     dosbox_allow_nonrecursive_page_fault = saved_allow;
+                    if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_CPU);
                     if (GCC_UNLIKELY(blah))
                         return blah;
                 }
@@ -353,9 +483,14 @@ static Bitu Normal_Loop(void) {
 #endif
             } else {
                 GFX_Events();
+                if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_GUI);
                 if (DOSBox_Paused() == false && ticksRemain > 0) {
                     TIMER_AddTick();
                     ticksRemain--;
+                    if (CPU_GovernorActive) {
+                        CPU_GovernorCharge(CPU_GOV_DEVICES);
+                        governor.emulated++;
+                    }
                 } else {
                     goto increaseticks;
                 }
@@ -380,7 +515,12 @@ increaseticks:
                     ticksRemain = 20;
                 }
                 ticksAdded = ticksRemain;
-                if (CPU_CycleAutoAdjust && !CPU_SkipCycleAutoAdjust) {
+                if (CPU_GovernorActive) {
+                    /* the governor keeps its own books */
+                    CPU_GovernorUpdate();
+                    ticksDone = 0;
+                    ticksScheduled = 0;
+                } else if (CPU_CycleAutoAdjust && !CPU_SkipCycleAutoAdjust) {
                     if (ticksScheduled >= 250 || ticksDone >= 250 || (ticksAdded > 15 && ticksScheduled >= 5) ) {
                         if(ticksDone < 1) ticksDone = 1; // Protect against div by zero
                         /* ratio we are aiming for is around 90% usage*/
@@ -447,6 +587,7 @@ increaseticks:
             } else {
                 ticksAdded = 0;
                 SDL_Delay(1);
+                if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_IDLE);
                 ticksDone -= GetTicks() - ticksNew;
                 if (ticksDone < 0)
                     ticksDone = 0;
@@ -1215,6 +1356,32 @@ void DOSBOX_SetupConfigSections(void) {
 		"        or 386DX and 486 systems where the CPU communicated directly with the ISA bus (A24-A31 tied off)\n"
 		"    26: 64MB aliasing. Some 486s had only 26 external address bits, some motherboards tied off A26-A31");
 
+	Pbool = secprop->Add_bool("host huge pages", Property::Changeable::OnlyAtStart,true);
+	Pbool->Set_help("Ask the host to back guest RAM and video memory with transparent huge pages (Linux only).\n"
+			"This makes host TLB misses rarer when the guest uses a lot of memory.");
+
+	Pint = secprop->Add_int("rewind interval", Property::Changeable::OnlyAtStart,0);
+	Pint->SetMinMax(0,60000);
+	Pint->Set_help("Take an in-memory rewind snapshot every this many milliseconds (0 to disable).\n"
+			"Use the rewind mapper event (Host+F3) to step back one snapshot at a time.\n"
+			"Only the CPU state and RAM/video memory are rewound, device state is not.\n"
+			"WARNING: This option is experimental. The PIC, timers, VGA registers, DMA and sound devices are not rewound,\n"
+			"         so the machine may not match its own memory after stepping back.");
+
+	Pint = secprop->Add_int("rewind memory", Property::Changeable::OnlyAtStart,64);
+	Pint->SetMinMax(1,16384);
+	Pint->Set_help("Megabytes of memory the rewind snapshots may take up. The oldest snapshots are dropped to stay below it.\n"
+			"A copy of RAM and video memory is kept on top of this.");
+
+	Pint = secprop->Add_int("rewind depth", Property::Changeable::OnlyAtStart,0);
+	Pint->SetMinMax(0,100000);
+	Pint->Set_help("Number of rewind snapshots to keep at most (0 for no limit other than rewind memory).");
+
+	Pint = secprop->Add_int("rewind keyframe interval", Property::Changeable::OnlyAtStart,0);
+	Pint->SetMinMax(0,10000);
+	Pint->Set_help("Compare all of RAM instead of only the pages known to be written every this many snapshots (0 to never do so).\n"
+			"This catches changes made behind the emulated CPU's back.");
+
     Pbool = secprop->Add_bool("pc-98 BIOS copyright string",Property::Changeable::WhenIdle,false);
     Pbool->Set_help("If set, the PC-98 BIOS copyright string is placed at E800:0000. Enable this for software that does \"Epson Check\".");
 
@@ -1640,6 +1807,11 @@ void DOSBOX_SetupConfigSections(void) {
 			"also causes problems with 32-bit protected mode DOS games and reduces the performance\n"
 			"of the dynamic core.\n");
 
+	Pint = secprop->Add_int("dynamic core cache size",Property::Changeable::OnlyAtStart,8);
+	Pint->SetMinMax(2,256);
+	Pint->Set_help("Size of the dynamic core code cache in MB. Memory is only committed as the cache fills up.\n"
+			"Programs with a lot of code (protected mode games, Windows) retranslate less with a larger cache.");
+
 	Pstring = secprop->Add_string("cputype",Property::Changeable::Always,"auto");
 	Pstring->Set_values(cputype_values);
 	Pstring->Set_help("CPU Type used in emulation. auto emulates a 486 which tolerates Pentium instructions.");
@@ -1670,9 +1842,16 @@ void DOSBOX_SetupConfigSections(void) {
 	Pint->SetMinMax(1,1000000);
 	Pint->Set_help("Setting it lower than 100 will be a percentage.");
 
+	Pbool = secprop->Add_bool("cycle governor",Property::Changeable::Always,false);
+	Pbool->Set_help("With auto or max cycles, measure the host time spent emulating the CPU, devices, rendering\n"
+			"and the GUI, and steer the cycles toward the max percentage with a damped controller.\n"
+			"The measured load is shown in the title bar. Steadier than the default adjustment when\n"
+			"a scaler or video capture takes a varying amount of time.");
+
 	Pbool = secprop->Add_bool("use dynamic core with paging on",Property::Changeable::Always,true);
-	Pbool->Set_help("Dynamic core is NOT compatible with the way page faults in the guest are handled in DosBox-X.\n"
-			"Windows 9x may crash with paging on if dynamic core is enabled. Enable at your own risk.\n");
+	Pbool->Set_help("Keep using the dynamic core when the guest switches on paging. Page faults end the translated code at the\n"
+			"faulting instruction, instructions that can't be restarted that way are left to the normal core.\n"
+			"If disabled, the normal core runs while paging is on.\n");
 			
 	Pbool = secprop->Add_bool("ignore opcode 63",Property::Changeable::Always,true);
 	Pbool->Set_help("When debugging, do not report illegal opcode 0x63.\n"
@@ -1758,7 +1937,8 @@ void DOSBOX_SetupConfigSections(void) {
 
 	Pint = secprop->Add_int("prebuffer",Property::Changeable::OnlyAtStart,20);
 	Pint->SetMinMax(0,100);
-	Pint->Set_help("How many milliseconds of data to keep on top of the blocksize.");
+	Pint->Set_help("How many milliseconds of data to keep on top of the blocksize, at least.\n"
+			"More is kept when the sound card asks for data at uneven intervals.");
 
 	secprop=control->AddSection_prop("midi",&Null_Init,true);//done
 
@@ -1806,6 +1986,11 @@ void DOSBOX_SetupConfigSections(void) {
 	Pstring->Set_values(mt32thread);
 	Pstring->Set_help("MT-32 rendering in separate thread");
 
+	Pint = secprop->Add_int("mt32.render.threads",Property::Changeable::WhenIdle,0);
+	Pint->SetMinMax(0,16);
+	Pint->Set_help("Number of threads the MT-32 renders its partials on. 0 or 1 renders them on the\n"
+		"same thread as the rest of the MT-32. The output is the same for any value.");
+
 	Pstring = secprop->Add_string("mt32.dac",Property::Changeable::WhenIdle,"auto");
 	Pstring->Set_values(mt32DACModes);
 	Pstring->Set_help("MT-32 DAC input emulation mode\n"
@@ -2317,8 +2502,9 @@ void DOSBOX_SetupConfigSections(void) {
 		"                 (realport:COM1 realport:ttyS0).\n"
 		"for modem: listenport (optional).\n"
 		"for nullmodem: server, rxdelay, txdelay, telnet, usedtr,\n"
-		"               transparent, port, inhsocket, nonlocal (all optional).\n"
+		"               transparent, port, inhsocket, nonlocal, unpaced (all optional).\n"
         "               connections are limited to localhost unless you specify nonlocal:1\n"
+		"               unpaced:1 ignores the line timing, for links between two emulators.\n"
 		"Example: serial1=modem listenport:5000");
 
 	Pmulti_remain = secprop->Add_multiremain("serial2",Property::Changeable::WhenIdle," ");
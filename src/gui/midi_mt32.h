@@ -1,4 +1,8 @@
 #include "mt32emu.h"
+#if !defined(WIN32)
+#include <sys/types.h>
+#include <unistd.h>
+#endif
 #include <SDL_thread.h>
 #include <SDL_timer.h>
 #include "mixer.h"
@@ -72,6 +76,54 @@ private:
 		virtual void printDebug(const char *fmt, va_list list);
 	} reportHandler;
 
+	/* helper threads for rendering partials, the thread calling run() takes jobs as well */
+	class MT32RenderWorkers : public MT32Emu::RenderWorkers {
+	public:
+		static const unsigned int MAX_THREADS = 16;
+
+		MT32RenderWorkers() : threadCount(1), startSem(NULL), doneSem(NULL), jobMutex(NULL) {
+#if !defined(WIN32)
+			pid = getpid();
+#endif
+		}
+
+		bool Start(unsigned int count);
+		void Stop(void);
+
+		virtual unsigned int getThreadCount() const {
+			return threadCount;
+		}
+
+		virtual void run(void (*job)(void *context, unsigned int n), void *context, unsigned int count);
+
+	private:
+		unsigned int threadCount;
+		SDL_Thread *threads[MAX_THREADS];
+		SDL_semaphore *startSem, *doneSem;
+		SDL_mutex *jobMutex;
+		volatile bool quit;
+#if !defined(WIN32)
+		pid_t pid;
+#endif
+
+		void (*job)(void *context, unsigned int n);
+		void *jobContext;
+		unsigned int jobCount;
+		unsigned int jobNext;
+
+		void RunJobs(void);
+		static int WorkerThread(void *);
+
+		/* a fork server clone (see forkserver.cpp) inherits the pool but not its threads */
+		bool Inherited(void) const {
+#if !defined(WIN32)
+			return pid != getpid();
+#else
+			return false;
+#endif
+		}
+	} renderWorkers;
+
 	static void mixerCallBack(Bitu len);
 	static int processingThread(void *);
 
@@ -178,6 +230,12 @@ public:
 		noise = strcmp(section->Get_string("mt32.verbose"), "on") == 0;
 		renderInThread = strcmp(section->Get_string("mt32.thread"), "on") == 0;
 
+		int partialThreads = section->Get_int("mt32.render.threads");
+		if (partialThreads > 1 && renderWorkers.Start((unsigned int)partialThreads)) {
+			synth->setRenderWorkers(&renderWorkers);
+			LOG(LOG_MISC,LOG_DEBUG)("MT32: Rendering partials on %u threads", renderWorkers.getThreadCount());
+		}
+
 		chan = MIXER_AddChannel(mixerCallBack, MT32Emu::SAMPLE_RATE, "MT32");
 		if (renderInThread) {
 			mixerBufferSize = 0;
@@ -218,6 +276,7 @@ public:
 		synth->close();
 		delete synth;
 		synth = NULL;
+		renderWorkers.Stop();
 		open = false;
 	}
 
@@ -269,6 +328,93 @@ void MidiHandler_mt32::MT32ReportHandler::printDebug(const char *fmt, va_list li
 	}
 }
 
+bool MidiHandler_mt32::MT32RenderWorkers::Start(unsigned int count) {
+	if (count > MAX_THREADS) count = MAX_THREADS;
+	quit = false;
+#if !defined(WIN32)
+	pid = getpid();
+#endif
+	startSem = SDL_CreateSemaphore(0);
+	doneSem = SDL_CreateSemaphore(0);
+	jobMutex = SDL_CreateMutex();
+	if (startSem == NULL || doneSem == NULL || jobMutex == NULL) {
+		Stop();
+		return false;
+	}
+	for (threadCount = 1; threadCount < count; threadCount++) {
+#if defined(C_SDL2)
+		threads[threadCount] = SDL_CreateThread(WorkerThread, "MT32 partials", this);
+#else
+		threads[threadCount] = SDL_CreateThread(WorkerThread, this);
+#endif
+		if (threads[threadCount] == NULL) break;
+	}
+	if (threadCount < 2) {
+		Stop();
+		return false;
+	}
+	return true;
+}
+
+void MidiHandler_mt32::MT32RenderWorkers::Stop(void) {
+	quit = true;
+	if (!Inherited()) {
+		for (unsigned int i = 1; i < threadCount; i++) SDL_SemPost(startSem);
+		for (unsigned int i = 1; i < threadCount; i++) SDL_WaitThread(threads[i], NULL);
+	}
+	threadCount = 1;
+	if (startSem != NULL) SDL_DestroySemaphore(startSem);
+	if (doneSem != NULL) SDL_DestroySemaphore(doneSem);
+	if (jobMutex != NULL) SDL_DestroyMutex(jobMutex);
+	startSem = doneSem = NULL;
+	jobMutex = NULL;
+}
+
+void MidiHandler_mt32::MT32RenderWorkers::run(void (*newJob)(void *context, unsigned int n), void *context, unsigned int count) {
+	if (Inherited()) {
+		/* nobody would post doneSem, start a pool of our own */
+		unsigned int oldCount = threadCount;
+		Stop();
+		if (!Start(oldCount)) {
+			LOG(LOG_MISC,LOG_WARN)("MT32: Cannot restart the partial render threads, rendering serially");
+			for (unsigned int n = 0; n < count; n++) newJob(context, n);
+			return;
+		}
+	}
+	job = newJob;
+	jobContext = context;
+	jobCount = count;
+	jobNext = 0;
+	/* a single job isn't worth waking anybody up for */
+	unsigned int helpers = count > 1 ? threadCount - 1 : 0;
+	if (helpers > count - 1) helpers = count - 1;
+	for (unsigned int i = 0; i < helpers; i++) SDL_SemPost(startSem);
+	RunJobs();
+	for (unsigned int i = 0; i < helpers; i++) SDL_SemWait(doneSem);
+}
+
+void MidiHandler_mt32::MT32RenderWorkers::RunJobs(void) {
+	for (;;) {
+		SDL_LockMutex(jobMutex);
+		unsigned int n = jobNext;
+		if (n < jobCount) jobNext++;
+		SDL_UnlockMutex(jobMutex);
+		if (n >= jobCount) break;
+		job(jobContext, n);
+	}
+}
+
+int MidiHandler_mt32::MT32RenderWorkers::WorkerThread(void *data) {
+	MT32RenderWorkers *workers = (MT32RenderWorkers *)data;
+	for (;;) {
+		SDL_SemWait(workers->startSem);
+		if (workers->quit) break;
+		workers->RunJobs();
+		SDL_SemPost(workers->doneSem);
+	}
+	return 0;
+}
+
 void MidiHandler_mt32::mixerCallBack(Bitu len) {
 	if (midiHandler_mt32.renderInThread) {
 		SDL_SemWait(midiHandler_mt32.procIdleSem);
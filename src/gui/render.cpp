@@ -30,6 +30,7 @@
 #include "cross.h"
 #include "hardware.h"
 #include "support.h"
+#include "cpu.h"
 
 #include "render_scalers.h"
 #if defined(__SSE__)
@@ -197,6 +198,82 @@ static void RENDER_ClearCacheHandler(const void * src) {
 	render.scale.lineHandler( src );
 }
 
+/* Direct mode. When the scaler would only copy (32bpp in and out, one output line
+ * per source line, any scaling done by the output at present time) the lines are
+ * copied straight to the output surface. Lines are compared by a hash instead of
+ * against scalerSourceCache, so an unchanged line costs one read of the source.
+ * The cache is still written for changed lines, captures and the GUI use it. */
+static Bit64u render_lineHash[SCALER_MAXHEIGHT];
+
+static INLINE Bit64u RENDER_HashLine(const void * s) {
+	const Bitu *src = (const Bitu*)s;
+	Bit64u hash = 0xcbf29ce484222325ULL;
+	for (Bits count=render.src.start;count>0;count--) {
+		hash = (hash ^ (Bit64u)(*src++)) * 0x100000001b3ULL;
+		hash = (hash << 31) | (hash >> 33);
+	}
+	/* an odd width leaves a pixel past the last whole Bitu */
+	if ((render.src.width * 4) % sizeof(Bitu))
+		hash ^= ((const Bit32u*)s)[render.src.width - 1];
+	return hash;
+}
+
+static INLINE void RENDER_DirectAddLines(Bitu changed) {
+	if ((Scaler_ChangedLineIndex & 1) == changed) {
+		Scaler_ChangedLines[Scaler_ChangedLineIndex]++;
+	} else {
+		Scaler_ChangedLines[++Scaler_ChangedLineIndex] = 1;
+	}
+	render.scale.outWrite += render.scale.outPitch;
+}
+
+static void RENDER_DirectDrawLine(const void * s,Bit64u hash) {
+	if (!render.scale.outWrite) {
+		/* first changed line of the frame */
+		if (!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )) {
+			RENDER_DrawLine = RENDER_EmptyLineHandler;
+			return;
+		}
+		render.scale.outWrite += render.scale.outPitch * Scaler_ChangedLines[0];
+	}
+	render_lineHash[render.scale.inLine++] = hash;
+	render.scale.outLine++;
+	memcpy(render.scale.outWrite, s, render.src.width * 4);
+	memcpy(render.scale.cacheRead, s, render.src.width * 4);
+	render.scale.cacheRead += render.scale.cachePitch;
+	RENDER_DirectAddLines(1);
+}
+
+static void RENDER_DirectLineHandler(const void * s) {
+	if (s) {
+		Bit64u hash = RENDER_HashLine(s);
+		if (hash != render_lineHash[render.scale.inLine]) {
+			RENDER_DirectDrawLine(s, hash);
+			return;
+		}
+	}
+	render.scale.inLine++;
+	render.scale.outLine++;
+	render.scale.cacheRead += render.scale.cachePitch;
+	if (render.scale.outWrite)
+		RENDER_DirectAddLines(0);
+	else
+		Scaler_ChangedLines[0]++;
+}
+
+static void RENDER_DirectClearHandler(const void * s) {
+	if (s) {
+		RENDER_DirectDrawLine(s, RENDER_HashLine(s));
+	} else {
+		/* nothing to draw, make sure the line never matches the next frame */
+		render_lineHash[render.scale.inLine] = ~render_lineHash[render.scale.inLine];
+		render.scale.inLine++;
+		render.scale.outLine++;
+		render.scale.cacheRead += render.scale.cachePitch;
+		RENDER_DirectAddLines(0);
+	}
+}
+
 extern void GFX_SetTitle(Bit32s cycles,Bits frameskip,Bits timing,bool paused);
 
 bool RENDER_StartUpdate(void) {
@@ -226,7 +303,13 @@ bool RENDER_StartUpdate(void) {
 		if (GCC_UNLIKELY(!GFX_StartUpdate( render.scale.outWrite, render.scale.outPitch )))
 			return false;
 		render.fullFrame = true;
-		RENDER_DrawLine = RENDER_ClearCacheHandler;
+		RENDER_DrawLine = render.scale.direct ? RENDER_DirectClearHandler : RENDER_ClearCacheHandler;
+	} else if (render.scale.direct) {
+		RENDER_DrawLine = RENDER_DirectLineHandler;
+		if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO)))
+			render.fullFrame = true;
+		else
+			render.fullFrame = false;
 	} else {
 		if (render.pal.changed) {
 			/* Assume pal changes always do a full screen update anyway */
@@ -260,8 +343,10 @@ void PauseDOSBox(bool pressed);
 void RENDER_EndUpdate( bool abort ) {
 	if (GCC_UNLIKELY(!render.updating))
 		return;
+
+	if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_DEVICES);
 		
-	if (!abort && render.active && RENDER_DrawLine == RENDER_ClearCacheHandler)
+	if (!abort && render.active && (RENDER_DrawLine == RENDER_ClearCacheHandler || RENDER_DrawLine == RENDER_DirectClearHandler))
 	render.scale.clearCache = false;
 	
 	RENDER_DrawLine = RENDER_EmptyLineHandler;
@@ -297,6 +382,8 @@ void RENDER_EndUpdate( bool abort ) {
 	render.frameskip.index = (render.frameskip.index + 1) & (RENDER_SKIP_CACHE - 1);
 	render.updating=false;
 
+	if (CPU_GovernorActive) CPU_GovernorCharge(CPU_GOV_RENDER);
+
 	if (pause_on_vsync) {
 		pause_on_vsync = false;
 		PauseDOSBox(true);
@@ -622,6 +709,10 @@ forcenormal:
 		break;
 		//E_Exit("RENDER:Wrong source bpp %d", render.src.bpp );
 	}
+	/* The 1x scaler at 32bpp only copies, as long as no lines are repeated for aspect correction */
+	render.scale.direct = !complexBlock && simpleBlock == &ScaleNormal1x &&
+		render.scale.inMode == scalerMode32 && render.scale.outMode == scalerMode32 &&
+		height == render.src.height;
 	render.scale.blocks = render.src.width / SCALER_BLOCKSIZE;
 	render.scale.lastBlock = render.src.width % SCALER_BLOCKSIZE;
 	render.scale.inHeight = render.src.height;
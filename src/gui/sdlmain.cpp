@@ -667,7 +667,7 @@ void GFX_SetTitle(Bit32s cycles,Bits frameskip,Bits timing,bool paused){
 	static Bits internal_frameskip=0;
 	static Bit32s internal_cycles=0;
 	static Bits internal_timing=0;
-	char title[200] = {0};
+	char title[256] = {0};
 
     Section_prop *section = static_cast<Section_prop *>(control->GetSection("SDL"));
     assert(section != NULL);
@@ -695,6 +695,13 @@ void GFX_SetTitle(Bit32s cycles,Bits frameskip,Bits timing,bool paused){
         char *p = title + strlen(title); // append to end of string
 
         sprintf(p,", FPS %2d",(int)frames);
+
+        const char *gov = CPU_GovernorStatus();
+        if (gov != NULL) {
+            p = title + strlen(title); // append to end of string
+
+            sprintf(p,", %s",gov);
+        }
     }
 
     if (menu.showrt) {
@@ -6781,6 +6788,7 @@ bool DOSBOX_parse_argv() {
             fprintf(stderr,"  -time-limit <n>                         Kill the emulator after 'n' seconds\n");
 			fprintf(stderr,"  -fastbioslogo                           Fast BIOS logo (skip 1-second pause)\n");
             fprintf(stderr,"  -log-con                                Log CON output to a log file\n");
+            fprintf(stderr,"  -forkserver <socket>                    Boot, then serve forked clones of the machine on a Unix socket\n");
 
 #if defined(WIN32)
             DOSBox_ConsolePauseWait();
@@ -6795,6 +6803,9 @@ bool DOSBOX_parse_argv() {
         else if (optname == "log-con") {
             control->opt_log_con = true;
         }
+        else if (optname == "forkserver") {
+            if (!control->cmdline->NextOptArgv(control->opt_forkserver)) return false;
+        }
         else if (optname == "time-limit") {
             if (!control->cmdline->NextOptArgv(tmp)) return false;
             control->opt_time_limit = atof(tmp.c_str());
@@ -6998,8 +7009,22 @@ void IPX_Init();
 void IDE_Init();
 void NE2K_Init();
 void FDC_Primary_Init();
+void REWIND_Init();
 void AUTOEXEC_Init();
 
+/* startup timeline: the wall time of each init function, logged with -debug */
+static Bit64u startup_init_us = 0;
+
+static void STARTUP_Timed(const char *name,void (*func)(void)) {
+	Bit64u start = GetTicksUs();
+	func();
+	Bit64u t = GetTicksUs() - start;
+	startup_init_us += t;
+	LOG(LOG_MISC,LOG_DEBUG)("Startup: %-28s %8.3fms",name,(double)t / 1000.0);
+}
+
+#define STARTUP_INIT(x) STARTUP_Timed(#x,x)
+
 #if defined(WIN32)
 extern bool dpi_aware_enable;
 
@@ -8338,10 +8363,10 @@ int main(int argc, char* argv[]) {
 		}
 #endif
 
-		MSG_Init();
-		MAPPER_StartUp();
-		DOSBOX_InitTickLoop();
-		DOSBOX_RealInit();
+		STARTUP_INIT(MSG_Init);
+		STARTUP_INIT(MAPPER_StartUp);
+		STARTUP_INIT(DOSBOX_InitTickLoop);
+		STARTUP_INIT(DOSBOX_RealInit);
 
         /* at this point: If the machine type is PC-98, and the mapper keyboard layout was "Japanese",
          * then change the mapper layout to "Japanese PC-98" */
@@ -8367,56 +8392,57 @@ int main(int argc, char* argv[]) {
 			item->set_text("Fit to aspect ratio");
         }
 
-		RENDER_Init();
-		CAPTURE_Init();
-		IO_Init();
-		HARDWARE_Init();
-		Init_AddressLimitAndGateMask(); /* <- need to init address mask so Init_RAM knows the maximum amount of RAM possible */
-		Init_MemoryAccessArray(); /* <- NTS: In DOSBox-X this is the "cache" of devices that responded to memory access */
-		Init_A20_Gate(); // FIXME: Should be handled by motherboard!
-		Init_PS2_Port_92h(); // FIXME: Should be handled by motherboard!
-		Init_RAM();
-		Init_DMA();
-		Init_PIC();
-		TIMER_Init();
-		PCIBUS_Init();
-		PAGING_Init(); /* <- NTS: At this time, must come before memory init because paging is so well integrated into emulation code */
-		CMOS_Init();
-		ROMBIOS_Init();
-		CALLBACK_Init(); /* <- NTS: This relies on ROM BIOS allocation and it must happen AFTER ROMBIOS init */
+		STARTUP_INIT(RENDER_Init);
+		STARTUP_INIT(CAPTURE_Init);
+		STARTUP_INIT(IO_Init);
+		STARTUP_INIT(HARDWARE_Init);
+		STARTUP_INIT(Init_AddressLimitAndGateMask); /* <- need to init address mask so Init_RAM knows the maximum amount of RAM possible */
+		STARTUP_INIT(Init_MemoryAccessArray); /* <- NTS: In DOSBox-X this is the "cache" of devices that responded to memory access */
+		STARTUP_INIT(Init_A20_Gate); // FIXME: Should be handled by motherboard!
+		STARTUP_INIT(Init_PS2_Port_92h); // FIXME: Should be handled by motherboard!
+		STARTUP_INIT(Init_RAM);
+		STARTUP_INIT(Init_DMA);
+		STARTUP_INIT(Init_PIC);
+		STARTUP_INIT(TIMER_Init);
+		STARTUP_INIT(PCIBUS_Init);
+		STARTUP_INIT(PAGING_Init); /* <- NTS: At this time, must come before memory init because paging is so well integrated into emulation code */
+		STARTUP_INIT(CMOS_Init);
+		STARTUP_INIT(ROMBIOS_Init);
+		STARTUP_INIT(CALLBACK_Init); /* <- NTS: This relies on ROM BIOS allocation and it must happen AFTER ROMBIOS init */
 #if C_DEBUG
-		DEBUG_Init(); /* <- NTS: Relies on callback system */
-#endif
-		Init_VGABIOS();
-		VOODOO_Init();
-		PROGRAMS_Init(); /* <- NTS: Does not init programs, it inits the callback used later when creating the .COM programs on drive Z: */
-		PCSPEAKER_Init();
-		TANDYSOUND_Init();
-		MPU401_Init();
-		MIXER_Init();
-		MIDI_Init();
-		CPU_Init();
+		STARTUP_INIT(DEBUG_Init); /* <- NTS: Relies on callback system */
+#endif
+		STARTUP_INIT(Init_VGABIOS);
+		STARTUP_INIT(VOODOO_Init);
+		STARTUP_INIT(PROGRAMS_Init); /* <- NTS: Does not init programs, it inits the callback used later when creating the .COM programs on drive Z: */
+		STARTUP_INIT(PCSPEAKER_Init);
+		STARTUP_INIT(TANDYSOUND_Init);
+		STARTUP_INIT(MPU401_Init);
+		STARTUP_INIT(MIXER_Init);
+		STARTUP_INIT(MIDI_Init);
+		STARTUP_INIT(CPU_Init);
 #if C_FPU
-		FPU_Init();
-#endif
-		VGA_Init();
-		ISAPNP_Cfg_Init();
-		FDC_Primary_Init();
-		KEYBOARD_Init();
-		SBLASTER_Init();
-		JOYSTICK_Init();
-		PS1SOUND_Init();
-		DISNEY_Init();
-		GUS_Init();
-		IDE_Init();
-		INNOVA_Init();
-		BIOS_Init();
-		INT10_Init();
-		SERIAL_Init();
-		DONGLE_Init();
-		PARALLEL_Init();
+		STARTUP_INIT(FPU_Init);
+#endif
+		STARTUP_INIT(VGA_Init);
+		STARTUP_INIT(ISAPNP_Cfg_Init);
+		STARTUP_INIT(FDC_Primary_Init);
+		STARTUP_INIT(KEYBOARD_Init);
+		STARTUP_INIT(SBLASTER_Init);
+		STARTUP_INIT(JOYSTICK_Init);
+		STARTUP_INIT(PS1SOUND_Init);
+		STARTUP_INIT(DISNEY_Init);
+		STARTUP_INIT(GUS_Init);
+		STARTUP_INIT(IDE_Init);
+		STARTUP_INIT(INNOVA_Init);
+		STARTUP_INIT(BIOS_Init);
+		STARTUP_INIT(INT10_Init);
+		STARTUP_INIT(SERIAL_Init);
+		STARTUP_INIT(DONGLE_Init);
+		STARTUP_INIT(PARALLEL_Init);
+		STARTUP_INIT(REWIND_Init);
 #if C_NE2000
-		NE2K_Init();
+		STARTUP_INIT(NE2K_Init);
 #endif
 
 #if defined(WIN32) && !defined(C_SDL2)
@@ -8431,27 +8457,28 @@ int main(int argc, char* argv[]) {
 		MEM_A20_Enable(true);
 
 		/* OS init now */
-		DOS_Init();
-		DRIVES_Init();
-		DOS_KeyboardLayout_Init();
-		MOUSE_Init(); // FIXME: inits INT 15h and INT 33h at the same time. Also uses DOS_GetMemory() which is why DOS_Init must come first
-		XMS_Init();
-		EMS_Init();
-		AUTOEXEC_Init();
+		STARTUP_INIT(DOS_Init);
+		STARTUP_INIT(DRIVES_Init);
+		STARTUP_INIT(DOS_KeyboardLayout_Init);
+		STARTUP_INIT(MOUSE_Init); // FIXME: inits INT 15h and INT 33h at the same time. Also uses DOS_GetMemory() which is why DOS_Init must come first
+		STARTUP_INIT(XMS_Init);
+		STARTUP_INIT(EMS_Init);
+		STARTUP_INIT(AUTOEXEC_Init);
 #if C_IPX
-		IPX_Init();
+		STARTUP_INIT(IPX_Init);
 #endif
-		MSCDEX_Init();
+		STARTUP_INIT(MSCDEX_Init);
 
 		/* Init memhandle system. This part is used by DOSBox's XMS/EMS emulation to associate handles
 		 * per page. FIXME: I would like to push this down to the point that it's never called until
 		 * XMS/EMS emulation needs it. I would also like the code to free the mhandle array immediately
 		 * upon booting into a guest OS, since memory handles no longer have meaning in the guest OS
 		 * memory layout. */
-		Init_MemHandles();
+		STARTUP_INIT(Init_MemHandles);
 
 		/* finally, the mapper */
-		MAPPER_Init();
+		STARTUP_INIT(MAPPER_Init);
+		LOG(LOG_MISC,LOG_DEBUG)("Startup: %.3fms in init functions",(double)startup_init_us / 1000.0);
 
 		/* stop at this point, and show the mapper, if instructed */
 		if (control->opt_startmapper) {
@@ -13,6 +13,8 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <algorithm> // std::transform
+#include <deque>
+#include <vector>
 #ifdef WIN32
 # include <signal.h>
 # include <sys/stat.h>
@@ -40,8 +42,347 @@
 #include "cross.h"
 #include "keymap.h"
 
+#include <SDL_thread.h>
+
+#if C_ZLIB
+# include <zlib.h>
+#endif
+
+/* Entries are deflated with zlib when available. The emulator state is
+ * mostly long runs of zeros and repeated patterns, so even the fastest
+ * compression level shrinks memory.bin considerably and in turn cuts the
+ * time spent writing it out. */
+#define ZIP_ZBUF_SIZE               (256*1024)
+
+/* write() calls smaller than this are gathered into one chunk */
+#define ZIP_CHUNK_SIZE              (64*1024)
+
+struct ZIPFileEntryZ {
+#if C_ZLIB
+    z_stream        z;
+    off_t           compressed_position;    /* inflate: how much of the stored data was consumed */
+    unsigned char   buf[ZIP_ZBUF_SIZE];
+#endif
+};
+
+/* Writing goes through a background writer. An entry only collects copies
+ * of what is handed to write(), so a device can change its state right after
+ * the call. Closed entries are queued to a worker thread, which deflates them
+ * and writes them out with the central directory, while the emulation goes on
+ * as soon as all devices have handed over their state. The ZIP file on disk is
+ * complete once the worker finishes; opening the next ZIP file waits for it. */
+struct ZIPWriteChunk {
+    unsigned char*  data;
+    size_t          len;
+    size_t          alloc;
+};
+
+struct ZIPWriteJob {
+    std::string     name;
+    std::vector<ZIPWriteChunk> chunks;
+    bool            end;                    /* last job, closes the file */
+    bool            directory;              /* end: write the central directory first */
+    /* filled in by the worker */
+    uint16_t        method;
+    zipcrc_t        crc;
+    off_t           header_offset;
+    off_t           length;
+    off_t           compressed_length;
+
+    ZIPWriteJob() : end(false), directory(false), method(ZIP_METHOD_STORE), crc(0), header_offset(0), length(0), compressed_length(0) { }
+    ~ZIPWriteJob() {
+        free_chunks();
+    }
+    void append(const void *buffer,size_t count) {
+        const unsigned char *src = (const unsigned char*)buffer;
+
+        if (!chunks.empty()) {
+            ZIPWriteChunk &c = chunks.back();
+            size_t n = std::min(count,c.alloc - c.len);
+            memcpy(c.data + c.len,src,n);
+            c.len += n;
+            src += n;
+            count -= n;
+        }
+        if (count > 0) {
+            ZIPWriteChunk c;
+            c.alloc = std::max(count,(size_t)ZIP_CHUNK_SIZE);
+            c.data = new unsigned char[c.alloc];
+            c.len = count;
+            memcpy(c.data,src,count);
+            chunks.push_back(c);
+        }
+    }
+    void free_chunks(void) {
+        for (size_t i=0;i < chunks.size();i++) delete[] chunks[i].data;
+        chunks.clear();
+    }
+};
+
+struct ZIPWriter {
+    SDL_Thread*     thread;                 /* NULL: jobs are written as they are queued */
+    SDL_mutex*      mutex;
+    SDL_cond*       work;
+    std::deque<ZIPWriteJob*> queue;
+    std::vector<ZIPWriteJob*> done;
+    int             fd;
+    off_t           pos;
+    bool            failed;
+    unsigned char   buf[ZIP_ZBUF_SIZE];
+};
+
+static bool zip_write_fd(ZIPWriter *w,const void *buffer,size_t count) {
+    const unsigned char *p = (const unsigned char*)buffer;
+
+    while (count > 0) {
+        int n = (int)::write(w->fd,p,count);
+        if (n <= 0) {
+            w->failed = true;
+            return false;
+        }
+        p += n;
+        count -= (size_t)n;
+    }
+    return true;
+}
+
+static void zip_writer_entry(ZIPWriter *w,ZIPWriteJob *job) {
+    ZIPLocalFileHeader hdr;
+#if C_ZLIB
+    z_stream z;
+    bool deflating = false;
+
+    memset(&z,0,sizeof(z));
+    if (deflateInit2(&z, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+        deflating = true;
+    job->method = deflating ? ZIP_METHOD_DEFLATE : ZIP_METHOD_STORE;
+#else
+    job->method = ZIP_METHOD_STORE;
+#endif
+
+    job->header_offset = w->pos;
+    job->crc = zipcrc_init();
+
+    memset(&hdr,0,sizeof(hdr));
+    hdr.local_file_header_signature = htole32(0x04034b50);  /* PK\x03\x04 */
+    hdr.version_needed_to_extract = htole16(20);            /* PKZIP 2.0 */
+    hdr.general_purpose_bit_flag = htole16(0 << 1);
+    hdr.compression_method = htole16(job->method);
+    hdr.file_name_length = htole16((uint16_t)job->name.length());
+    zip_write_fd(w,&hdr,sizeof(hdr));
+    zip_write_fd(w,job->name.c_str(),job->name.length());
+
+    for (size_t i=0;i < job->chunks.size();i++) {
+        const ZIPWriteChunk &c = job->chunks[i];
+
+        job->crc = zipcrc_update(job->crc, c.data, c.len);
+        job->length += (off_t)c.len;
+#if C_ZLIB
+        if (deflating) {
+            z.next_in = (Bytef*)c.data;
+            z.avail_in = (uInt)c.len;
+            while (z.avail_in > 0) {
+                z.next_out = w->buf;
+                z.avail_out = ZIP_ZBUF_SIZE;
+                if (deflate(&z, Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                    w->failed = true;
+                    break;
+                }
+                size_t out = ZIP_ZBUF_SIZE - z.avail_out;
+                if (out > 0) {
+                    zip_write_fd(w,w->buf,out);
+                    job->compressed_length += (off_t)out;
+                }
+            }
+            continue;
+        }
+#endif
+        zip_write_fd(w,c.data,c.len);
+        job->compressed_length += (off_t)c.len;
+    }
+    job->free_chunks();
+
+#if C_ZLIB
+    if (deflating) {
+        int err;
+
+        z.next_in = NULL;
+        z.avail_in = 0;
+        do {
+            z.next_out = w->buf;
+            z.avail_out = ZIP_ZBUF_SIZE;
+            err = deflate(&z, Z_FINISH);
+            size_t out = ZIP_ZBUF_SIZE - z.avail_out;
+            if (out > 0) {
+                zip_write_fd(w,w->buf,out);
+                job->compressed_length += (off_t)out;
+            }
+        } while (err == Z_OK);
+        deflateEnd(&z);
+    }
+#endif
+
+    w->pos += (off_t)(sizeof(hdr) + job->name.length()) + job->compressed_length;
+
+    /* now that the sizes are known, complete the local header */
+    hdr.compressed_size = htole32(((uint32_t)job->compressed_length));
+    hdr.uncompressed_size = htole32(((uint32_t)job->length));
+    hdr.crc_32 = htole32(zipcrc_finalize(job->crc));
+    if (lseek(w->fd,job->header_offset,SEEK_SET) != job->header_offset || !zip_write_fd(w,&hdr,sizeof(hdr)) ||
+        lseek(w->fd,w->pos,SEEK_SET) != w->pos)
+        w->failed = true;
+}
+
+static void zip_writer_directory(ZIPWriter *w) {
+    struct pkzip_central_directory_header_main chdr;
+    struct pkzip_central_directory_header_end ehdr;
+    uint32_t cdircount = 0;
+    uint32_t cdirbytes = 0;
+    off_t cdirofs = w->pos;
+
+    for (size_t i=0;i < w->done.size();i++) {
+        const ZIPWriteJob &job = *w->done[i];
+
+        memset(&chdr,0,sizeof(chdr));
+        chdr.sig = htole32(PKZIP_CENTRAL_DIRECTORY_HEADER_SIG);
+        chdr.version_made_by = htole16((0 << 8) + 20);      /* PKZIP 2.0 */
+        chdr.version_needed_to_extract = htole16(20);       /* PKZIP 2.0 or higher */
+        chdr.general_purpose_bit_flag = htole16(0 << 1);    /* just lie and say that "normal" deflate was used */
+        chdr.compression_method = htole16(job.method);
+        chdr.last_mod_file_time = 0;
+        chdr.last_mod_file_date = 0;
+        chdr.compressed_size = htole32(((uint32_t)job.compressed_length));
+        chdr.uncompressed_size = htole32(((uint32_t)job.length));
+        chdr.filename_length = htole16((uint16_t)job.name.length());
+        chdr.disk_number_start = htole16(1u);
+        chdr.internal_file_attributes = 0;
+        chdr.external_file_attributes = 0;
+        chdr.relative_offset_of_local_header = htole32(job.header_offset);
+        chdr.crc32 = htole32(zipcrc_finalize(job.crc));
+
+        if (!zip_write_fd(w,&chdr,sizeof(chdr))) break;
+        cdirbytes += sizeof(chdr);
+        cdircount++;
+
+        assert(job.name.length() != 0);
+        if (!zip_write_fd(w,job.name.c_str(),job.name.length())) break;
+        cdirbytes += job.name.length();
+    }
+
+    memset(&ehdr,0,sizeof(ehdr));
+    ehdr.sig = htole32(PKZIP_CENTRAL_DIRECTORY_END_SIG);
+    ehdr.number_of_disk_with_start_of_central_directory = htole16(0);
+    ehdr.number_of_this_disk = htole16(0);
+    ehdr.total_number_of_entries_of_central_dir_on_this_disk = htole16(cdircount);
+    ehdr.total_number_of_entries_of_central_dir = htole16(cdircount);
+    ehdr.size_of_central_directory = htole32(cdirbytes);
+    ehdr.offset_of_central_directory_from_start_disk = htole32(cdirofs);
+    zip_write_fd(w,&ehdr,sizeof(ehdr));
+}
+
+/* returns true after the end job */
+static bool zip_writer_process(ZIPWriter *w,ZIPWriteJob *job) {
+    if (!job->end) {
+        zip_writer_entry(w,job);
+
+        /* a name written again replaces the earlier entry in the central directory,
+         * the earlier data stays in the file unreferenced */
+        for (size_t i=0;i < w->done.size();i++) {
+            if (w->done[i]->name == job->name) {
+                delete w->done[i];
+                w->done.erase(w->done.begin() + (ptrdiff_t)i);
+                break;
+            }
+        }
+        w->done.push_back(job);
+        return false;
+    }
+
+    if (job->directory) zip_writer_directory(w);
+    ::close(w->fd);
+    w->fd = -1;
+    delete job;
+    for (size_t i=0;i < w->done.size();i++) delete w->done[i];
+    w->done.clear();
+    return true;
+}
+
+static int zip_writer_thread(void *arg) {
+    ZIPWriter *w = (ZIPWriter*)arg;
+
+    for (;;) {
+        SDL_LockMutex(w->mutex);
+        while (w->queue.empty()) SDL_CondWait(w->work,w->mutex);
+        ZIPWriteJob *job = w->queue.front();
+        w->queue.pop_front();
+        SDL_UnlockMutex(w->mutex);
+
+        if (zip_writer_process(w,job)) break;
+    }
+    return 0;
+}
+
+void ZIPFile::start_writer(void) {
+    writer = new ZIPWriter;
+    writer->fd = file_fd;
+    writer->pos = 0;
+    writer->failed = false;
+    writer->thread = NULL;
+    writer->mutex = SDL_CreateMutex();
+    writer->work = SDL_CreateCond();
+    if (writer->mutex != NULL && writer->work != NULL) {
+#if defined(C_SDL2)
+        writer->thread = SDL_CreateThread(zip_writer_thread,"ZIP writer",writer);
+#else
+        writer->thread = SDL_CreateThread(zip_writer_thread,writer);
+#endif
+    }
+    if (writer->thread == NULL)
+        LOG_MSG("ZIPFile: cannot start writer thread, writing synchronously");
+}
+
+void ZIPFile::queue_write(ZIPWriteJob *job) {
+    if (writer->thread == NULL) {
+        zip_writer_process(writer,job);
+        return;
+    }
+
+    SDL_LockMutex(writer->mutex);
+    writer->queue.push_back(job);
+    SDL_CondSignal(writer->work);
+    SDL_UnlockMutex(writer->mutex);
+}
+
+/* wait until the previous ZIP file is completely on disk */
+void ZIPFile::wait_writer(void) {
+    if (writer == NULL) return;
+
+    if (writer->thread != NULL) SDL_WaitThread(writer->thread,NULL);
+    if (writer->work != NULL) SDL_DestroyCond(writer->work);
+    if (writer->mutex != NULL) SDL_DestroyMutex(writer->mutex);
+    if (writer->failed) LOG_MSG("ZIPFile: error writing %s",filename.c_str());
+    delete writer;
+    writer = NULL;
+}
+
+void ZIPFileEntry::free_zstate(void) {
+    if (zstate != NULL) {
+#if C_ZLIB
+        inflateEnd(&zstate->z);
+#endif
+        delete zstate;
+        zstate = NULL;
+    }
+}
+
 bool ZIPFileEntry::rewind(void) {
     if (can_write) return false;
+    if (compression_method != ZIP_METHOD_STORE) {
+        /* compressed data can only be read from the start, restart the stream */
+        free_zstate();
+        position = 0;
+        return true;
+    }
     return (seek_file(0) == 0);
 }
 
@@ -59,6 +400,56 @@ int ZIPFileEntry::read(void *buffer,size_t count) {
     if (file == NULL || file_offset == (off_t)0) return -1;
     if (position >= file_length) return 0;
 
+    if (compression_method == ZIP_METHOD_DEFLATE) {
+#if C_ZLIB
+        if (zstate == NULL) {
+            zstate = new ZIPFileEntryZ;
+            memset(&zstate->z,0,sizeof(zstate->z));
+            zstate->compressed_position = 0;
+            if (inflateInit2(&zstate->z, -MAX_WBITS) != Z_OK) {
+                delete zstate;
+                zstate = NULL;
+                return -1;
+            }
+        }
+
+        size_t mread = file_length - position;
+        if (mread > count) mread = count;
+
+        zstate->z.next_out = (Bytef*)buffer;
+        zstate->z.avail_out = (uInt)mread;
+        while (zstate->z.avail_out > 0) {
+            if (zstate->z.avail_in == 0) {
+                size_t in = compressed_length - zstate->compressed_position;
+                if (in > ZIP_ZBUF_SIZE) in = ZIP_ZBUF_SIZE;
+                if (in == 0) break;
+                if (file->seek_file(file_offset + zstate->compressed_position) != (file_offset + zstate->compressed_position)) return -1;
+                if ((size_t)file->read(zstate->buf,in) != in) return -1;
+                zstate->compressed_position += (off_t)in;
+                zstate->z.next_in = zstate->buf;
+                zstate->z.avail_in = (uInt)in;
+            }
+
+            int err = inflate(&zstate->z, Z_NO_FLUSH);
+            if (err == Z_STREAM_END) break;
+            if (err != Z_OK) {
+                LOG_MSG("ZIPFile: inflate error in %s",name.c_str());
+                return -1;
+            }
+        }
+
+        mread -= zstate->z.avail_out;
+        position += mread;
+        return mread;
+#else
+        LOG_MSG("ZIPFile: %s is compressed, but zlib support was not compiled in",name.c_str());
+        return -1;
+#endif
+    }
+    else if (compression_method != ZIP_METHOD_STORE) {
+        return -1;
+    }
+
     size_t mread = file_length - position;
     if (mread > count) mread = count;
 
@@ -72,18 +463,14 @@ int ZIPFileEntry::read(void *buffer,size_t count) {
 }
 
 int ZIPFileEntry::write(const void *buffer,size_t count) {
-    if (file == NULL || file_offset == (off_t)0 || !can_write) return -1;
+    if (file == NULL || job == NULL || !can_write) return -1;
 
-    /* write stream only, no seeking.
-     * this code assumes the file pointer will not change anywhere else,
-     * and always to the end */
+    /* write stream only, no seeking. The data is copied, the writer
+     * compresses and writes it once the entry is closed */
     if (count > 0) {
-        count = file->write(buffer,count);
-        if (count > 0) {
-            position += count;
-            write_crc = zipcrc_update(write_crc, buffer, count);
-            file_length = position;
-        }
+        job->append(buffer,count);
+        position += count;
+        file_length = position;
     }
     return count;
 }
@@ -93,15 +480,32 @@ ZIPFile::ZIPFile() {
 	write_pos = 0;
 	can_write = false;
 	wrote_trailer = false;
+	writer = NULL;
 }
 
 ZIPFile::~ZIPFile() {
     close();
+    wait_writer();
 }
 
 void ZIPFile::close(void) {
+    close_current();
+
+    for (std::map<std::string,ZIPFileEntry>::iterator i=entries.begin();i!=entries.end();i++)
+        i->second.free_zstate();
+
     if (file_fd >= 0) {
-        ::close(file_fd);
+        if (writer != NULL) {
+            /* the writer owns the file from here on and closes it when done */
+            if (!wrote_trailer) {
+                ZIPWriteJob *job = new ZIPWriteJob;
+                job->end = true;
+                queue_write(job);
+            }
+        }
+        else {
+            ::close(file_fd);
+        }
         file_fd = -1;
     }
 
@@ -136,44 +540,27 @@ ZIPFileEntry *ZIPFile::new_entry(const char *name) {
     /* close current entry, if open */
     close_current();
 
-    /* begin new entry at end */
+    /* begin new entry, the writer places it at the end of the file */
     current_entry = name;
-    write_pos = end_of_file();
 
     ZIPFileEntry *ent = &entries[name];
     ent->name = name;
     ent->can_write = true;
-    ent->file_header_offset = write_pos;
-    write_pos += sizeof(ZIPLocalFileHeader) + ent->name.length();
+    ent->file_header_offset = 0;
     ent->write_crc = zipcrc_init();
-    ent->file_offset = write_pos;
+    ent->file_offset = 0;
     ent->file = this;
-
-    if (seek_file(ent->file_header_offset) != ent->file_header_offset) {
-        close_current();
-        return NULL;
-    }
-
-    ZIPLocalFileHeader hdr;
-    memset(&hdr,0,sizeof(hdr));
-    hdr.local_file_header_signature = htole32(0x04034b50);  /* PK\x03\x04 */
-    hdr.version_needed_to_extract = htole16(20);            /* PKZIP 2.0 */
-    hdr.general_purpose_bit_flag = htole16(0 << 1);
-    hdr.compression_method = 0;                             /* store (no compression) */
-    hdr.file_name_length = htole16((uint16_t)ent->name.length());
-    if (write(&hdr,sizeof(hdr)) != sizeof(hdr)) {
-        close_current();
-        return NULL;
-    }
-    assert(ent->name.length() != 0);
-    if ((size_t)write(ent->name.c_str(),ent->name.length()) != ent->name.length()) {
-        close_current();
-        return NULL;
-    }
-    if (seek_file(ent->file_offset) != ent->file_offset) {
-        close_current();
-        return NULL;
-    }
+    ent->position = 0;
+    ent->file_length = 0;
+    ent->compressed_length = 0;
+#if C_ZLIB
+    ent->compression_method = ZIP_METHOD_DEFLATE;
+#else
+    ent->compression_method = ZIP_METHOD_STORE;
+#endif
+    ent->zstate = NULL;
+    ent->job = new ZIPWriteJob;
+    ent->job->name = name;
 
     return ent;
 }
@@ -187,18 +574,12 @@ void ZIPFile::close_current(void) {
 
     if (!current_entry.empty()) {
         ZIPFileEntry *ent = get_entry(current_entry.c_str());
-        ZIPLocalFileHeader hdr;
 
         if (ent != NULL && ent->can_write) {
             ent->can_write = false;
-
-            if (seek_file(ent->file_header_offset) == ent->file_header_offset && read(&hdr,sizeof(hdr)) == sizeof(hdr)) {
-                hdr.compressed_size = hdr.uncompressed_size = htole32(((uint32_t)ent->file_length));
-                hdr.crc_32 = htole32(zipcrc_finalize(ent->write_crc));
-
-                if (seek_file(ent->file_header_offset) == ent->file_header_offset && write(&hdr,sizeof(hdr)) == sizeof(hdr)) {
-                    /* good */
-                }
+            if (ent->job != NULL) {
+                queue_write(ent->job);
+                ent->job = NULL;
             }
         }
     }
@@ -210,6 +591,7 @@ int ZIPFile::open(const char *path,int mode) {
     unsigned char tmp[512];
 
     close();
+    wait_writer();
 
     if (path == NULL) return -1;
 
@@ -233,6 +615,7 @@ int ZIPFile::open(const char *path,int mode) {
     current_entry.clear();
     wrote_trailer = false;
     write_pos = 0;
+    filename = path;
 
     /* WARNING: This assumes O_RDONLY, O_WRONLY, O_RDWR are defined as in Linux (0, 1, 2) in the low two bits */
     if ((mode & 3) == O_RDWR)
@@ -240,6 +623,8 @@ int ZIPFile::open(const char *path,int mode) {
     else
         can_write = false;
 
+    if (can_write) start_writer();
+
     /* if we're supposed to READ the ZIP file, then start scanning now */
     if ((mode & 3) == O_RDONLY) {
         struct pkzip_central_directory_header_main chdr;
@@ -290,6 +675,10 @@ int ZIPFile::open(const char *path,int mode) {
                 ZIPFileEntry *ent = &entries[(char*)tmp];
                 ent->can_write = false;
                 ent->file_length = htole32(chdr.uncompressed_size);
+                ent->compressed_length = htole32(chdr.compressed_size);
+                ent->compression_method = htole16(chdr.compression_method);
+                ent->zstate = NULL;
+                ent->job = NULL;
                 ent->file_header_offset = htole32(chdr.relative_offset_of_local_header);
                 ent->file_offset = ent->file_header_offset + sizeof(struct ZIPLocalFileHeader) + htole16(chdr.filename_length) + htole16(chdr.extra_field_length);
                 ent->position = 0;
@@ -318,55 +707,15 @@ int ZIPFile::write(const void *buffer,size_t count) {
 }
 
 void ZIPFile::writeZIPFooter(void) {
-    struct pkzip_central_directory_header_main chdr;
-    struct pkzip_central_directory_header_end ehdr;
-    uint32_t cdircount = 0;
-    uint32_t cdirbytes = 0;
-    off_t cdirofs = 0;
-
     if (file_fd < 0 || wrote_trailer || !can_write) return;
 
     close_current();
-    cdirofs = end_of_file();
 
-    for (std::map<std::string,ZIPFileEntry>::iterator i=entries.begin();i!=entries.end();i++) {
-        const ZIPFileEntry &ent = i->second;
-
-        memset(&chdr,0,sizeof(chdr));
-        chdr.sig = htole32(PKZIP_CENTRAL_DIRECTORY_HEADER_SIG);
-        chdr.version_made_by = htole16((0 << 8) + 20);      /* PKZIP 2.0 */
-        chdr.version_needed_to_extract = htole16(20);       /* PKZIP 2.0 or higher */
-        chdr.general_purpose_bit_flag = htole16(0 << 1);    /* just lie and say that "normal" deflate was used */
-        chdr.compression_method = 0;                        /* stored (no compression) */
-        chdr.last_mod_file_time = 0;
-        chdr.last_mod_file_date = 0;
-        chdr.compressed_size = htole32(((uint32_t)ent.file_length));
-        chdr.uncompressed_size = htole32(((uint32_t)ent.file_length));
-        chdr.filename_length = htole16((uint16_t)ent.name.length());
-        chdr.disk_number_start = htole16(1u);
-        chdr.internal_file_attributes = 0;
-        chdr.external_file_attributes = 0;
-        chdr.relative_offset_of_local_header = htole32(ent.file_header_offset);
-        chdr.crc32 = htole32(zipcrc_finalize(ent.write_crc));
-
-        if (write(&chdr,sizeof(chdr)) != sizeof(chdr)) break;
-        cdirbytes += sizeof(chdr);
-        cdircount++;
-
-        assert(ent.name.length() != 0);
-        if ((size_t)write(ent.name.c_str(),ent.name.length()) != ent.name.length()) break;
-        cdirbytes += ent.name.length();
-    }
-
-    memset(&ehdr,0,sizeof(ehdr));
-    ehdr.sig = htole32(PKZIP_CENTRAL_DIRECTORY_END_SIG);
-    ehdr.number_of_disk_with_start_of_central_directory = htole16(0);
-    ehdr.number_of_this_disk = htole16(0);
-    ehdr.total_number_of_entries_of_central_dir_on_this_disk = htole16(cdircount);
-    ehdr.total_number_of_entries_of_central_dir = htole16(cdircount);
-    ehdr.size_of_central_directory = htole32(cdirbytes);
-    ehdr.offset_of_central_directory_from_start_disk = htole32(cdirofs);
-    write(&ehdr,sizeof(ehdr));
+    /* the writer adds the central directory after the entries and closes the file */
+    ZIPWriteJob *job = new ZIPWriteJob;
+    job->end = true;
+    job->directory = true;
+    queue_write(job);
 
     wrote_trailer = true;
     current_entry.clear();
@@ -30,8 +30,22 @@
 #include "shell.h"
 #include "math.h"
 #include "regs.h"
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
 using namespace std;
 
+/*HACK*/
+#if defined(__SSE__) && defined(_M_AMD64)
+# define sse2_available (1) /* SSE2 is always available on x86_64 */
+#else
+# ifdef __SSE__
+extern bool				sse2_available;
+# endif
+#endif
+/*END HACK*/
+
 enum GUSType {
 	GUS_CLASSIC=0,
 	GUS_MAX,
@@ -48,6 +62,10 @@ enum GUSType {
 //Amount of precision the volume has
 #define RAMP_FRACT (10)
 #define RAMP_FRACT_MASK ((1 << RAMP_FRACT)-1)
+#define RAMP_MAX ((4096 << RAMP_FRACT)-1)
+
+//Voices are rendered in runs of at most this many samples
+#define GUS_RUN_MAX 64
 
 #define GUS_BASE myGUS.portbase
 #define GUS_RATE myGUS.rate
@@ -170,6 +188,57 @@ static INLINE Bit32s GetSample(Bit32u Delta, Bit32u CurAddr, bool eightbit) {
 	}
 }
 
+// Where the left and right voice outputs go (ICS mixer channel mapping)
+struct GUSOutputMap {
+	Bit32s l0,r0;	// 1 if left/right goes to output 0
+	Bit32s l1,r1;	// 1 if left/right goes to output 1
+};
+
+// Add a run of samples to the stereo stream, stream[2k] += samp[k]*vol0[k] and
+// stream[2k+1] += samp[k]*vol1[k]. Samples are 16-bit and volumes at most 2*8192,
+// so the 16-bit multiply-add of SSE2 computes the products exactly.
+static void GUS_MixRun(Bit32s *stream,const Bit32s *samp,const Bit32s *vol0,const Bit32s *vol1,Bit32u n) {
+	Bit32u k = 0;
+#if defined(__SSE__)
+	if (sse2_available) {
+		for (;(k+4) <= n;k += 4) {
+			__m128i s = _mm_loadu_si128((const __m128i*)(samp+k));
+			__m128i v0 = _mm_loadu_si128((const __m128i*)(vol0+k));
+			__m128i v1 = _mm_loadu_si128((const __m128i*)(vol1+k));
+			__m128i *sp = (__m128i*)(stream+(k*2));
+			__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi32(s,s),_mm_unpacklo_epi32(v0,v1));
+			__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi32(s,s),_mm_unpackhi_epi32(v0,v1));
+			_mm_storeu_si128(sp,_mm_add_epi32(_mm_loadu_si128(sp),lo));
+			_mm_storeu_si128(sp+1,_mm_add_epi32(_mm_loadu_si128(sp+1),hi));
+		}
+	}
+#endif
+	for (;k < n;k++) {
+		stream[k*2] += samp[k] * vol0[k];
+		stream[(k*2)+1] += samp[k] * vol1[k];
+	}
+}
+
+// Same with a constant volume over the run
+static void GUS_MixRunConst(Bit32s *stream,const Bit32s *samp,Bit32s vol0,Bit32s vol1,Bit32u n) {
+	Bit32u k = 0;
+#if defined(__SSE__)
+	if (sse2_available) {
+		const __m128i v = _mm_set_epi32(vol1,vol0,vol1,vol0);
+		for (;(k+4) <= n;k += 4) {
+			__m128i s = _mm_loadu_si128((const __m128i*)(samp+k));
+			__m128i *sp = (__m128i*)(stream+(k*2));
+			_mm_storeu_si128(sp,_mm_add_epi32(_mm_loadu_si128(sp),_mm_madd_epi16(_mm_unpacklo_epi32(s,s),v)));
+			_mm_storeu_si128(sp+1,_mm_add_epi32(_mm_loadu_si128(sp+1),_mm_madd_epi16(_mm_unpackhi_epi32(s,s),v)));
+		}
+	}
+#endif
+	for (;k < n;k++) {
+		stream[k*2] += samp[k] * vol0;
+		stream[(k*2)+1] += samp[k] * vol1;
+	}
+}
+
 static uint8_t GUS_reset_reg = 0;
 
 static inline uint8_t read_GF1_mapping_control(const unsigned int ch);
@@ -383,7 +452,7 @@ public:
 			RampLeft=RampStart-RampVol;
 		} else {
 			RampVol+=RampAdd;
-			if (RampVol > ((4096 << RAMP_FRACT)-1)) RampVol=((4096 << RAMP_FRACT)-1);
+			if (RampVol > RAMP_MAX) RampVol=RAMP_MAX;
 			RampLeft=RampVol-RampEnd;
 		}
 		if (RampLeft<0) {
@@ -404,13 +473,116 @@ public:
 			RampVol = (RampCtrl & 0x40) ? RampStart : RampEnd;
 		}
 		if ((Bit32s)RampVol < (Bit32s)0) RampVol=0;
-		if (RampVol > ((4096 << RAMP_FRACT)-1)) RampVol=((4096 << RAMP_FRACT)-1);
+		if (RampVol > RAMP_MAX) RampVol=RAMP_MAX;
 		UpdateVolumes();
 	}
+	/* Number of upcoming WaveUpdate()s that will not reach the start or end of
+	 * the sample, i.e. that do nothing but move the position. */
+	Bit32u WaveSafeSteps(void) const {
+		const Bit32u mask = ((Bit32u)1 << ((Bit32u)WAVE_FRACT + (Bit32u)20/*1MB*/)) - 1;
+
+		if (WaveCtrl & 0x3) return 0xFFFFFFFFUL; /* stopped voices do not move */
+		if (WaveAddr > mask) return 0;
+
+		if (WaveCtrl & 0x40/*backwards (direction)*/) {
+			if (WaveAddr < WaveStart) return 0;
+			return WaveAdd ? ((WaveAddr - WaveStart) / WaveAdd) : 0xFFFFFFFFUL;
+		}
+		else {
+			if (WaveAddr > WaveEnd || WaveEnd > mask) return 0;
+			return WaveAdd ? ((WaveEnd - WaveAddr) / WaveAdd) : 0xFFFFFFFFUL;
+		}
+	}
+	/* Same for RampUpdate(), the number of steps before the ramp reaches its end */
+	Bit32u RampSafeSteps(void) const {
+		if (RampCtrl & 0x3) return 0xFFFFFFFFUL; /* ramp stopped */
+
+		if (RampCtrl & 0x40) {
+			if (RampVol <= RampStart || RampVol > RAMP_MAX) return 0;
+			return RampAdd ? ((RampVol - RampStart - 1) / RampAdd) : 0xFFFFFFFFUL;
+		}
+		else {
+			if (RampEnd > RAMP_MAX) return 0xFFFFFFFFUL; /* the volume saturates before the end */
+			if (RampVol >= RampEnd) return 0;
+			return RampAdd ? ((RampEnd - RampVol - 1) / RampAdd) : 0xFFFFFFFFUL;
+		}
+	}
+	/* One sample, the general case. Handles the start/end of sample and ramp. */
+	INLINE void renderSample(Bit32s * const sp,const GUSOutputMap &map) {
+		const Bit32s tmpsamp = GetSample(WaveAdd, WaveAddr, (WaveCtrl & 0x4) == 0);
+
+		sp[0] += tmpsamp * ((VolLeft * map.l0) + (VolRight * map.r0));
+		sp[1] += tmpsamp * ((VolLeft * map.l1) + (VolRight * map.r1));
+
+		WaveUpdate();
+		RampUpdate();
+	}
+	/* A run of samples in which neither the position nor the ramp reach an end
+	 * (see WaveSafeSteps/RampSafeSteps), so none of the checks in WaveUpdate and
+	 * RampUpdate have to be made per sample. dir is 1 forward, -1 backwards and
+	 * 0 for a stopped voice. */
+	template <bool eightbit,bool interpolate,int dir,bool ramp> void renderRun(Bit32s *stream,Bit32u n,const GUSOutputMap &map) {
+		Bit32s samp[GUS_RUN_MAX];
+		Bit32u addr = WaveAddr;
+		Bit32u k;
+
+		for (k=0;k < n;k++) {
+			samp[k] = GetSample(interpolate ? 0 : (1 << WAVE_FRACT), addr, eightbit);
+			if (dir > 0) addr += WaveAdd;
+			else if (dir < 0) addr -= WaveAdd;
+		}
+		WaveAddr = addr;
+
+		/* a stopped voice may still raise its IRQ, once is as good as n times */
+		if (dir == 0) WaveUpdate();
+
+		if (ramp) {
+			Bit32s vol0[GUS_RUN_MAX],vol1[GUS_RUN_MAX];
+			const bool down = (RampCtrl & 0x40) != 0;
+
+			for (k=0;k < n;k++) {
+				vol0[k] = (VolLeft * map.l0) + (VolRight * map.r0);
+				vol1[k] = (VolLeft * map.l1) + (VolRight * map.r1);
+				if (down) {
+					RampVol -= RampAdd;
+				}
+				else {
+					RampVol += RampAdd;
+					if (RampVol > RAMP_MAX) RampVol = RAMP_MAX;
+				}
+				UpdateVolumes();
+			}
+			GUS_MixRun(stream,samp,vol0,vol1,n);
+		}
+		else {
+			GUS_MixRunConst(stream,samp,
+				(VolLeft * map.l0) + (VolRight * map.r0),
+				(VolLeft * map.l1) + (VolRight * map.r1),n);
+		}
+	}
+	template <bool eightbit,bool interpolate,int dir> void renderRun(Bit32s *stream,Bit32u n,const GUSOutputMap &map) {
+		if ((RampCtrl & 0x3) == 0) renderRun<eightbit,interpolate,dir,true>(stream,n,map);
+		else renderRun<eightbit,interpolate,dir,false>(stream,n,map);
+	}
+	template <bool eightbit,bool interpolate> void renderRun(Bit32s *stream,Bit32u n,const GUSOutputMap &map) {
+		if (WaveCtrl & 0x3) renderRun<eightbit,interpolate,0>(stream,n,map);
+		else if (WaveCtrl & 0x40) renderRun<eightbit,interpolate,-1>(stream,n,map);
+		else renderRun<eightbit,interpolate,1>(stream,n,map);
+	}
+	void renderRun(Bit32s *stream,Bit32u n,const GUSOutputMap &map) {
+		const bool interpolate = (WaveAdd < (1 << WAVE_FRACT));
+
+		if ((WaveCtrl & 0x4) == 0) {
+			if (interpolate) renderRun<true,true>(stream,n,map);
+			else renderRun<true,false>(stream,n,map);
+		}
+		else {
+			if (interpolate) renderRun<false,true>(stream,n,map);
+			else renderRun<false,false>(stream,n,map);
+		}
+	}
 	void generateSamples(Bit32s * stream,Bit32u len) {
-		bool eightbit = ((WaveCtrl & 0x4) == 0);
-		Bit32s tmpsamp;
-		int i;
+		GUSOutputMap map;
 
 		/* NTS: The GUS is *always* rendering the audio sample at the current position,
 		 *      even if the voice is stopped. This can be confirmed using DOSLIB, loading
@@ -420,46 +592,49 @@ public:
 		 *      is stopped. You will hear "popping" noises come out the GUS audio output
 		 *      as the current position changes and the piece of the sample rendered
 		 *      abruptly changes as well. */
+
+		/* with the DAC off nothing is output and the voices do not move */
+		if ((GUS_reset_reg & 0x02/*DAC enable*/) == 0)
+			return;
+
 		if (gus_ics_mixer) {
 			const unsigned char Lc = read_GF1_mapping_control(0);
 			const unsigned char Rc = read_GF1_mapping_control(1);
 
 			// output mapped through ICS mixer including channel remapping
-			for(i=0;i<(int)len;i++) {
-				// Get sample
-				tmpsamp = GetSample(WaveAdd, WaveAddr, eightbit);
-
-				// Output stereo sample if DAC enable on
-				if ((GUS_reset_reg & 0x02/*DAC enable*/) == 0x02) {
-					Bit32s * const sp = stream + (i << 1);
-					const Bit32s L = tmpsamp * VolLeft;
-					const Bit32s R = tmpsamp * VolRight;
-
-					if (Lc&1) sp[0] += L;
-					if (Lc&2) sp[1] += L;
-					if (Rc&1) sp[0] += R;
-					if (Rc&2) sp[1] += R;
-
-					WaveUpdate();
-					RampUpdate();
-				}
-			}
+			map.l0 = (Lc & 1) ? 1 : 0;
+			map.l1 = (Lc & 2) ? 1 : 0;
+			map.r0 = (Rc & 1) ? 1 : 0;
+			map.r1 = (Rc & 2) ? 1 : 0;
 		}
 		else {
 			// normal output
-			for(i=0;i<(int)len;i++) {
-				// Get sample
-				tmpsamp = GetSample(WaveAdd, WaveAddr, eightbit);
+			map.l0 = 1; map.r0 = 0;
+			map.l1 = 0; map.r1 = 1;
+		}
 
-				// Output stereo sample if DAC enable on
-				if ((GUS_reset_reg & 0x02/*DAC enable*/) == 0x02) {
-					stream[i<<1]+= tmpsamp * VolLeft;
-					stream[(i<<1)+1]+= tmpsamp * VolRight;
+		/* render in runs up to the next point where the voice or its ramp
+		 * loops, stops or raises an IRQ, and single samples at those points */
+		while (len > 0) {
+			Bit32u n = len;
+			Bit32u safe;
 
-					WaveUpdate();
-					RampUpdate();
-				}
+			if (n > GUS_RUN_MAX) n = GUS_RUN_MAX;
+			safe = WaveSafeSteps();
+			if (n > safe) n = safe;
+			safe = RampSafeSteps();
+			if (n > safe) n = safe;
+
+			if (n == 0) {
+				renderSample(stream,map);
+				n = 1;
+			}
+			else {
+				renderRun(stream,n,map);
 			}
+
+			stream += n * 2;
+			len -= n;
 		}
 	}
 };
@@ -1894,7 +2069,20 @@ static void GUS_CallBack(Bitu len) {
     //
     //        --J.C.
 
-    for(i=0;i<len*2;i++) {
+    i = 0;
+#if defined(__SSE__)
+    /* at 100% AutoAmp and with nothing to adjust it, this is a shift and a
+     * saturating pack. buf16 trails buf32 in the same buffer, so storing
+     * 8 samples never overwrites input that has not been read yet. */
+    if (sse2_available && AutoAmp == 512 && !enable_autoamp) {
+        for (;(i+8) <= len*2;i += 8) {
+            __m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(buf32+i)),13);
+            __m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(buf32+i+4)),13);
+            _mm_storeu_si128((__m128i*)(buf16+i),_mm_packs_epi32(a,b));
+        }
+    }
+#endif
+    for(;i<len*2;i++) {
         Bit32s sample=((buf32[i] >> 13)*AutoAmp)>>9;
         if (sample>32767) {
             sample=32767;
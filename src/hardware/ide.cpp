@@ -9,6 +9,13 @@
 
 #include <math.h>
 #include <assert.h>
+#include <string.h>
+#include <deque>
+#if !defined(WIN32)
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 #include "dosbox.h"
 #include "inout.h"
 #include "pic.h"
@@ -87,6 +94,176 @@ enum {
 	IDE_STATUS_ERROR=0x01
 };
 
+/* Asynchronous read-ahead for ATA reads.
+ *
+ * READ SECTOR(S), READ VERIFY and READ MULTIPLE name every sector they will
+ * transfer when the command is written, but the sectors used to be read from
+ * the image when the delayed command executes, one Read_AbsoluteSector() at a
+ * time with the emulation waiting on the host disk. Now the whole range is
+ * handed to a worker thread as one read when the command is written, and the
+ * delayed command picks the data up, so host disk latency overlaps the
+ * emulated command latency and a 256 sector command is one host request.
+ *
+ * Only plain images qualify (imageDisk::Get_RawImage). The worker pread()s the
+ * image file descriptor, which leaves the file position that the emulation
+ * thread uses through stdio alone. Windows has no pread(); there, and for
+ * anything else, the sectors are read when the command executes as before. */
+#if !defined(WIN32)
+# define IDE_ASYNC_IO 1
+#else
+# define IDE_ASYNC_IO 0
+#endif
+
+struct IDEAsyncRead {
+	imageDisk *disk;		/* holds a reference while the read exists */
+	uint32_t sectorn;
+	uint32_t sectcount;
+	unsigned char *data;
+#if IDE_ASYNC_IO
+	int fd;
+	off_t offset;			/* of sectorn in the host file */
+	pid_t pid;				/* process whose worker does the read */
+#endif
+	bool done;
+	bool ok;
+};
+
+#if IDE_ASYNC_IO
+static SDL_Thread *ide_async_thread = NULL;
+static SDL_mutex *ide_async_mutex = NULL;
+static SDL_cond *ide_async_work = NULL;
+static SDL_cond *ide_async_done = NULL;
+static std::deque<IDEAsyncRead*> ide_async_queue;
+static bool ide_async_quit = false;
+static pid_t ide_async_pid = 0;
+
+static int IDE_AsyncThread(void *arg) {
+	(void)arg;//UNUSED
+	SDL_LockMutex(ide_async_mutex);
+	while (!ide_async_quit) {
+		if (ide_async_queue.empty()) {
+			SDL_CondWait(ide_async_work,ide_async_mutex);
+			continue;
+		}
+
+		IDEAsyncRead *r = ide_async_queue.front();
+		ide_async_queue.pop_front();
+		SDL_UnlockMutex(ide_async_mutex);
+
+		size_t want = (size_t)r->sectcount * 512u,got = 0;
+		while (got < want) {
+			ssize_t n = pread(r->fd,r->data+got,want-got,r->offset+(off_t)got);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) break;
+			got += (size_t)n;
+		}
+
+		SDL_LockMutex(ide_async_mutex);
+		r->ok = (got == want);
+		r->done = true;
+		SDL_CondBroadcast(ide_async_done);
+	}
+	SDL_UnlockMutex(ide_async_mutex);
+	return 0;
+}
+
+static bool IDE_AsyncStart(void) {
+	/* a fork server clone (see forkserver.cpp) inherits the state but not the thread */
+	if (ide_async_thread != NULL && ide_async_pid == getpid()) return true;
+
+	ide_async_mutex = SDL_CreateMutex();
+	ide_async_work = SDL_CreateCond();
+	ide_async_done = SDL_CreateCond();
+	ide_async_queue.clear();
+	ide_async_quit = false;
+	ide_async_pid = getpid();
+	if (ide_async_mutex == NULL || ide_async_work == NULL || ide_async_done == NULL) return false;
+
+#if defined(C_SDL2)
+	ide_async_thread = SDL_CreateThread(IDE_AsyncThread,"IDE read-ahead",NULL);
+#else
+	ide_async_thread = SDL_CreateThread(IDE_AsyncThread,NULL);
+#endif
+	if (ide_async_thread == NULL) {
+		LOG_MSG("IDE: cannot start read-ahead thread, reading synchronously\n");
+		return false;
+	}
+	return true;
+}
+
+static void IDE_AsyncShutdown(void) {
+	if (ide_async_thread == NULL || ide_async_pid != getpid()) return;
+
+	SDL_LockMutex(ide_async_mutex);
+	ide_async_quit = true;
+	SDL_CondSignal(ide_async_work);
+	SDL_UnlockMutex(ide_async_mutex);
+	SDL_WaitThread(ide_async_thread,NULL);
+	ide_async_thread = NULL;
+
+	SDL_DestroyCond(ide_async_done);
+	SDL_DestroyCond(ide_async_work);
+	SDL_DestroyMutex(ide_async_mutex);
+	ide_async_done = ide_async_work = NULL;
+	ide_async_mutex = NULL;
+}
+#endif
+
+/* start reading sectorn...sectorn+sectcount-1, NULL if it has to be done synchronously */
+static IDEAsyncRead *IDE_AsyncSubmit(imageDisk *disk,uint32_t sectorn,uint32_t sectcount) {
+#if IDE_ASYNC_IO
+	FILE *f;
+	Bit64u base,length;
+
+	if (disk->getSectSize() != 512 || !disk->Get_RawImage(&f,&base,&length)) return NULL;
+	if ((((Bit64u)sectorn + sectcount) * 512u) > length) return NULL; /* the command will fail */
+	if (!IDE_AsyncStart()) return NULL;
+
+	IDEAsyncRead *r = new IDEAsyncRead;
+	r->disk = disk;
+	r->disk->Addref();
+	r->sectorn = sectorn;
+	r->sectcount = sectcount;
+	r->data = new unsigned char[sectcount * 512u];
+	r->fd = fileno(f);
+	r->offset = (off_t)(base + ((Bit64u)sectorn * 512u));
+	r->pid = ide_async_pid;
+	r->done = r->ok = false;
+
+	SDL_LockMutex(ide_async_mutex);
+	ide_async_queue.push_back(r);
+	SDL_CondSignal(ide_async_work);
+	SDL_UnlockMutex(ide_async_mutex);
+	return r;
+#else
+	(void)disk;//UNUSED
+	(void)sectorn;//UNUSED
+	(void)sectcount;//UNUSED
+	return NULL;
+#endif
+}
+
+/* wait for the read to finish, returns true if it succeeded */
+static bool IDE_AsyncWait(IDEAsyncRead *r) {
+#if IDE_ASYNC_IO
+	/* in a fork server clone the worker that had the read is gone */
+	if (r->pid != getpid()) return r->done && r->ok;
+
+	SDL_LockMutex(ide_async_mutex);
+	while (!r->done) SDL_CondWait(ide_async_done,ide_async_mutex);
+	SDL_UnlockMutex(ide_async_mutex);
+#endif
+	return r->ok;
+}
+
+static void IDE_AsyncFree(IDEAsyncRead *r) {
+	if (r == NULL) return;
+	IDE_AsyncWait(r);
+	r->disk->Release();
+	delete[] r->data;
+	delete r;
+}
+
 class IDEController;
 
 static inline bool drivehead_is_lba48(uint8_t val) {
@@ -173,7 +350,11 @@ public:
 	virtual void prepare_write(Bitu offset,Bitu size);
 	virtual void io_completion();
 	virtual bool increment_current_address(Bitu count=1);
+	void readahead_start();
+	void readahead_cancel();
+	Bit8u read_sectors(imageDisk *disk,uint32_t sectorn,unsigned int n,unsigned char *dst);
 public:
+	IDEAsyncRead *readahead;
 	Bitu multiple_sector_max,multiple_sector_count;
 	Bitu heads,sects,cyls,headshr,progress_count;
 	Bitu phys_heads,phys_sects,phys_cyls;
@@ -2027,9 +2208,64 @@ IDEATADevice::IDEATADevice(IDEController *c,unsigned char bios_disk_index) : IDE
 	multiple_sector_max = sizeof(sector) / 512;
 	multiple_sector_count = 1;
 	geo_translate = false;
+	readahead = NULL;
 }
 
 IDEATADevice::~IDEATADevice() {
+	readahead_cancel();
+}
+
+/* start reading every sector of the read command just written (see IDEAsyncRead) */
+void IDEATADevice::readahead_start() {
+	uint32_t sectorn,sectcount;
+
+	readahead_cancel();
+
+	imageDisk *disk = getBIOSdisk();
+	if (disk == NULL) return;
+
+	sectcount = count & 0xFF;
+	if (sectcount == 0) sectcount = 256;
+	if (drivehead_is_lba(drivehead)) {
+		sectorn = ((drivehead & 0xF) << 24) | lba[0] | (lba[1] << 8) | (lba[2] << 16);
+	}
+	else {
+		/* invalid C/H/S is left for the command to report */
+		if (lba[0] == 0 || (unsigned int)(drivehead & 0xF) >= (unsigned int)heads ||
+			(unsigned int)lba[0] > (unsigned int)sects ||
+			(unsigned int)(lba[1] | (lba[2] << 8)) >= (unsigned int)cyls)
+			return;
+
+		sectorn = ((drivehead & 0xF) * sects) + ((lba[1] | (lba[2] << 8)) * sects * heads) + (lba[0] - 1);
+	}
+
+	readahead = IDE_AsyncSubmit(disk,sectorn,sectcount);
+}
+
+void IDEATADevice::readahead_cancel() {
+	IDE_AsyncFree(readahead);
+	readahead = NULL;
+}
+
+/* read sectors for the command in progress, taking them from the read-ahead if it has them */
+Bit8u IDEATADevice::read_sectors(imageDisk *disk,uint32_t sectorn,unsigned int n,unsigned char *dst) {
+	if (readahead != NULL && readahead->disk == disk && sectorn >= readahead->sectorn &&
+		((Bit64u)sectorn + n) <= ((Bit64u)readahead->sectorn + readahead->sectcount)) {
+		if (IDE_AsyncWait(readahead)) {
+			memcpy(dst,readahead->data + ((size_t)(sectorn - readahead->sectorn) * 512u),(size_t)n * 512u);
+			return 0x00;
+		}
+
+		/* read it again the normal way, which reports the error */
+		readahead_cancel();
+	}
+
+	for (unsigned int cc=0;cc < n;cc++) {
+		Bit8u ret = disk->Read_AbsoluteSector(sectorn+cc, dst+(cc*512));
+		if (ret != 0x00) return ret;
+	}
+
+	return 0x00;
 }
 
 imageDisk *IDEATADevice::getBIOSdisk() {
@@ -2789,7 +3025,7 @@ static void IDE_DelayedCommand(Bitu idx/*which IDE controller*/) {
 						(ata->lba[0] - 1);
 				}
 
-				if (disk->Read_AbsoluteSector(sectorn, ata->sector) != 0) {
+				if (ata->read_sectors(disk, sectorn, 1, ata->sector) != 0) {
 					LOG_MSG("ATA read failed\n");
 					ata->abort_error();
 					dev->controller->raise_irq();
@@ -2853,7 +3089,7 @@ static void IDE_DelayedCommand(Bitu idx/*which IDE controller*/) {
 						(ata->lba[0] - 1);
 				}
 
-				if (disk->Read_AbsoluteSector(sectorn, ata->sector) != 0) {
+				if (ata->read_sectors(disk, sectorn, 1, ata->sector) != 0) {
 					LOG_MSG("ATA read failed\n");
 					ata->abort_error();
 					dev->controller->raise_irq();
@@ -2932,14 +3168,11 @@ static void IDE_DelayedCommand(Bitu idx/*which IDE controller*/) {
 				if ((512*ata->multiple_sector_count) > sizeof(ata->sector))
 					E_Exit("SECTOR OVERFLOW");
 
-				for (unsigned int cc=0;cc < MIN((Bitu)ata->multiple_sector_count,(Bitu)sectcount);cc++) {
-					/* it would be great if the disk object had a "read multiple sectors" member function */
-					if (disk->Read_AbsoluteSector(sectorn+cc, ata->sector+(cc*512)) != 0) {
-						LOG_MSG("ATA read failed\n");
-						ata->abort_error();
-						dev->controller->raise_irq();
-						return;
-					}
+				if (ata->read_sectors(disk, sectorn, (unsigned int)MIN((Bitu)ata->multiple_sector_count,(Bitu)sectcount), ata->sector) != 0) {
+					LOG_MSG("ATA read failed\n");
+					ata->abort_error();
+					dev->controller->raise_irq();
+					return;
 				}
 
 				/* NTS: the way this command works is that the drive reads ONE sector, then fires the IRQ
@@ -3371,6 +3604,7 @@ void IDEATADevice::writecommand(uint8_t cmd) {
 	/* drive is ready to accept command */
 	allow_writing = false;
 	command = cmd;
+	readahead_cancel();
 	switch (cmd) {
 		case 0x00: /* NOP */
 			feature = 0x04;
@@ -3405,6 +3639,7 @@ void IDEATADevice::writecommand(uint8_t cmd) {
 			progress_count = 0;
 			state = IDE_DEV_BUSY;
 			status = IDE_STATUS_BUSY;
+			if (!faked_command) readahead_start();
 			PIC_AddEvent(IDE_DelayedCommand,(faked_command ? 0.000001 : 0.1)/*ms*/,controller->interface_index);
 			break;
 		case 0x30: /* WRITE SECTOR */
@@ -3420,6 +3655,7 @@ void IDEATADevice::writecommand(uint8_t cmd) {
 			progress_count = 0;
 			state = IDE_DEV_BUSY;
 			status = IDE_STATUS_BUSY;
+			if (!faked_command) readahead_start();
 			PIC_AddEvent(IDE_DelayedCommand,(faked_command ? 0.000001 : 0.1)/*ms*/,controller->interface_index);
 			break;
 		case 0x91: /* INITIALIZE DEVICE PARAMETERS */
@@ -3457,6 +3693,7 @@ void IDEATADevice::writecommand(uint8_t cmd) {
 			progress_count = 0;
 			state = IDE_DEV_BUSY;
 			status = IDE_STATUS_BUSY;
+			if (!faked_command) readahead_start();
 			PIC_AddEvent(IDE_DelayedCommand,(faked_command ? 0.000001 : 0.1)/*ms*/,controller->interface_index);
 			break;
 		case 0xC5: /* WRITE MULTIPLE */
@@ -3992,6 +4229,9 @@ static void IDE_Destroy(Section* sec) {
 		}
 	}
 
+#if IDE_ASYNC_IO
+	IDE_AsyncShutdown();
+#endif
 	init_ide = 0;
 }
 
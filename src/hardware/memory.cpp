@@ -28,6 +28,7 @@
 #include "programs.h"
 #include "zipfile.h"
 #include "regs.h"
+#include "hostmem.h"
 #ifndef WIN32
 # include <stdlib.h>
 # include <unistd.h>
@@ -162,8 +163,10 @@ public:
 	}
 	HostPt GetHostWritePt(Bitu phys_page) {
         if (!a20_fast_changeable || (phys_page & (~0xFul/*64KB*/)) == 0x100ul/*@1MB*/)
-            return MemBase+(phys_page&memory.mem_alias_pagemask_active)*MEM_PAGESIZE;
+            phys_page &= memory.mem_alias_pagemask_active;
 
+        /* the CPU writes through the TLB from here on, so this is the last chance to notice */
+        MEM_MarkPageDirty(phys_page);
         return MemBase+phys_page*MEM_PAGESIZE;
 	}
 };
@@ -712,6 +715,9 @@ void MEM_BlockWrite(PhysPt pt,void const * const data,Bitu size) {
 			tlb_addr=get_tlb_write(pt);
 			pt++; size--;
 			if (!tlb_addr) {
+				// Span path, handlers like planar VGA memory take the rest at once
+				if (size != 0 && get_tlb_writehandler(pt)->writeblock(pt,read,1,size))
+					return;
 				// Slow path
 				while (size--) {
 					mem_writeb_inline(pt++,*read++);
@@ -1184,6 +1190,10 @@ void mem_writed(PhysPt address,Bit32u val) {
 
 void phys_writes(PhysPt addr, const char* string, Bitu length) {
 	for(Bitu i = 0; i < length; i++) host_writeb(MemBase+addr+i,string[i]);
+	if (MEM_dirty_map != NULL && length != 0) {
+		for (Bitu page = addr >> 12;page <= ((addr+length-1) >> 12);page++)
+			MEM_MarkPageDirty(page);
+	}
 }
 
 #include "control.h"
@@ -1690,9 +1700,36 @@ void Init_AddressLimitAndGateMask() {
 	LOG(LOG_MISC,LOG_DEBUG)("Memory: address_bits=%u alias_pagemask=%lx",(unsigned int)memory.address_bits,(unsigned long)memory.mem_alias_pagemask);
 }
 
+Bit8u *MEM_dirty_map = NULL;
+Bitu MEM_dirty_pages = 0;
+
+void MEM_EnableDirtyTracking(bool enable) {
+	if (MEM_dirty_map != NULL) {
+		delete [] MEM_dirty_map;
+		MEM_dirty_map = NULL;
+		MEM_dirty_pages = 0;
+	}
+
+	if (enable && MemBase != NULL) {
+		MEM_dirty_pages = memory.pages;
+		MEM_dirty_map = new Bit8u[MEM_dirty_pages];
+		/* everything counts as dirty until the first clear */
+		memset(MEM_dirty_map,1,MEM_dirty_pages);
+	}
+}
+
+void MEM_ClearDirtyPages(void) {
+	if (MEM_dirty_map == NULL) return;
+
+	memset(MEM_dirty_map,0,MEM_dirty_pages);
+	/* drop the direct TLB write pointers so the next write to any page relinks it (and marks it) */
+	PAGING_ClearTLB();
+}
+
 void ShutDownRAM(Section * sec) {
+	MEM_EnableDirtyTracking(false);
 	if (MemBase != NULL) {
-		delete [] MemBase;
+		HostMem_Free(MemBase);
 		MemBase = NULL;
 	}
 }
@@ -1839,13 +1876,10 @@ void Init_RAM() {
 	assert(memory.handler_pages >= memory.reported_pages);
 	assert(memory.handler_pages >= 0x100); /* enough for at minimum 1MB of addressable memory */
 
-	/* Allocate the RAM. We alloc as a large unsigned char array. new[] does not initialize the array,
-	 * so we then must zero the buffer. */
-	MemBase = new Bit8u[memory.pages*4096];
+	/* Allocate the RAM. It comes zeroed from the host, and pages the guest
+	 * never touches are never made resident, so don't clear it here. */
+	MemBase = HostMem_Alloc(memory.pages*4096);
 	if (!MemBase) E_Exit("Can't allocate main memory of %d KB",(int)memsizekb);
-	/* Clear the memory, as new doesn't always give zeroed memory
-	 * (Visual C debug mode). We want zeroed memory though. */
-	memset((void*)MemBase,0,memory.reported_pages*4096);
 	/* the rest of "ROM" is for unmapped devices so we need to fill it appropriately */
 	if (memory.reported_pages < memory.pages)
 		memset((char*)MemBase+(memory.reported_pages*4096),0xFF,
@@ -74,8 +74,7 @@ struct mixedFraction {
 };
 
 static struct {
-	Bit32s			work[MIXER_BUFSIZE][2];
-	Bitu			work_in,work_out,work_wrap;
+	Bit32s			work[MIXER_BUFSIZE][2];	/* the millisecond being rendered */
 	Bitu			pos,done;
 	float			mastervol[2];
     float           recordvol[2];
@@ -93,6 +92,44 @@ static struct {
 	bool			mute;
 } mixer;
 
+/* Output ring between MIXER_Mix on the emulation thread and MIXER_CallBack on
+ * the audio thread. Only MIXER_Mix moves "in" and only the callback moves "out".
+ * Both count frames and only ever go up, so neither side takes a lock.
+ *
+ * The callback keeps "target" frames buffered after each block. The target is
+ * the prebuffer setting plus twice the measured jitter of the callback. Drift
+ * between the emulated and the host clock shows up as the fill level wandering
+ * off the target. Instead of dropping or padding whole blocks, the callback
+ * resamples at a ratio slightly off 1 (at most MIXER_DRIFT_MAX) until the fill
+ * is back at the target. */
+#define MIXER_RINGSIZE			(32*1024)
+#define MIXER_RINGMASK			(MIXER_RINGSIZE-1)
+#define MIXER_DRIFT_MAX			0.005	/* largest ratio change, about 9 cents of pitch */
+#define MIXER_DRIFT_SECONDS		2.0		/* a fill error is made up over this long (unless capped by MIXER_DRIFT_MAX) */
+
+#if defined(_MSC_VER)
+#define MIXER_BARRIER()			MemoryBarrier()
+#else
+#define MIXER_BARRIER()			__sync_synchronize()
+#endif
+
+static struct {
+	Bit32s			frames[MIXER_RINGSIZE][2];
+	volatile Bit32u	in,out;
+	/* audio thread only */
+	Bit32s			hist[4][2];			/* interpolation points, phase is between hist[1] and hist[2] */
+	double			phase;
+	double			ratio;				/* input frames per output frame */
+	double			fill_err;			/* smoothed distance of the fill level from the target */
+	double			jitter_us;
+	Bit64u			last_callback_us;
+	Bitu			target;
+	/* statistics */
+	volatile Bit32u	underruns;			/* callback ran dry */
+	volatile Bit32u	overruns;			/* ring full, a millisecond was dropped */
+	volatile Bit32u	skips;				/* callback skipped far ahead of the target */
+} mixer_ring;
+
 bool Mixer_SampleAccurate() {
 	return mixer.sampleaccurate;
 }
@@ -327,7 +364,7 @@ void MixerChannel::Mix(Bitu whole,Bitu frac) {
 	if (whole <= rend_n) return;
 	assert(whole <= mixer.samples_this_ms.w);
 	assert(rend_n < mixer.samples_this_ms.w);
-	Bit32s *outptr = &mixer.work[mixer.work_in+rend_n][0];
+	Bit32s *outptr = &mixer.work[rend_n][0];
 
 	if (!enabled) {
 		rend_n = whole;
@@ -661,7 +698,7 @@ static void MIXER_MixData(Bitu fracs/*render up to*/) {
         Bit16s convert[1024][2];
 		Bitu added = whole - prev_rendered;
 		if (added>1024) added=1024;
-		Bitu readpos = mixer.work_in + prev_rendered;
+		Bitu readpos = prev_rendered;
 		for (Bitu i=0;i<added;i++) {
             convert[i][0]=MIXER_CLIP(((Bit64s)mixer.work[readpos][0] * (Bit64s)volscale1) >> (MIXER_VOLSHIFT + MIXER_VOLSHIFT));
             convert[i][1]=MIXER_CLIP(((Bit64s)mixer.work[readpos][1] * (Bit64s)volscale2) >> (MIXER_VOLSHIFT + MIXER_VOLSHIFT));
@@ -677,11 +714,9 @@ static void MIXER_MixData(Bitu fracs/*render up to*/) {
 }
 
 static void MIXER_FillUp(void) {
-	SDL_LockAudio();
 	float index = PIC_TickIndex();
 	if (index < 0) index = 0;
 	MIXER_MixData((Bitu)(index * ((Bitu)mixer.samples_this_ms.w * (Bitu)mixer.samples_this_ms.fd)));
-	SDL_UnlockAudio();
 }
 
 void MixerChannel::FillUp(void) {
@@ -693,15 +728,30 @@ void MIXER_MixSingle(Bitu /*val*/) {
 	PIC_AddEvent(MIXER_MixSingle,1000.0 / mixer.freq);
 }
 
-static void MIXER_Mix(void) {
-	Bitu thr;
+/* hand the finished millisecond to the audio callback */
+static void MIXER_Publish(Bitu frames) {
+	const Bit32u in = mixer_ring.in;
 
-	SDL_LockAudio();
+	MIXER_BARRIER();
+	if ((Bitu)(in - mixer_ring.out) + frames > MIXER_RINGSIZE) {
+		/* the callback isn't keeping up, drop the millisecond */
+		mixer_ring.overruns++;
+		return;
+	}
+	for (Bitu i=0;i < frames;i++) {
+		Bit32s *frame = mixer_ring.frames[(in + i) & MIXER_RINGMASK];
+		frame[0] = mixer.work[i][0];
+		frame[1] = mixer.work[i][1];
+	}
+	MIXER_BARRIER();
+	mixer_ring.in = in + (Bit32u)frames;
+}
 
+static void MIXER_Mix(void) {
 	/* render */
-	assert((mixer.work_in+mixer.samples_per_ms.w) <= MIXER_BUFSIZE);
+	assert(mixer.samples_per_ms.w < MIXER_BUFSIZE);
 	MIXER_MixData((Bitu)mixer.samples_this_ms.w * (Bitu)mixer.samples_this_ms.fd);
-	mixer.work_in += mixer.samples_this_ms.w;
+	if (!mixer.nosound) MIXER_Publish(mixer.samples_this_ms.w);
 
 	/* how many samples for the next ms? */
 	mixer.samples_this_ms.w = mixer.samples_per_ms.w;
@@ -711,88 +761,133 @@ static void MIXER_Mix(void) {
 		mixer.samples_this_ms.w++;
 	}
 
-	/* advance. we use in/out & wrap pointers to make sure the rendering code
-	 * doesn't have to worry about circular buffer wraparound. */
-	thr = mixer.blocksize;
-	if (thr < mixer.samples_this_ms.w) thr = mixer.samples_this_ms.w;
-	if ((mixer.work_in+thr) > MIXER_BUFSIZE) {
-		mixer.work_wrap = mixer.work_in;
-		mixer.work_in = 0;
-	}
-	assert((mixer.work_in+thr) <= MIXER_BUFSIZE);
-	assert((mixer.work_in+mixer.samples_this_ms.w) <= MIXER_BUFSIZE);
-	memset(&mixer.work[mixer.work_in][0],0,sizeof(Bit32s)*2*mixer.samples_this_ms.w);
+	assert(mixer.samples_this_ms.w <= MIXER_BUFSIZE);
+	memset(&mixer.work[0][0],0,sizeof(Bit32s)*2*mixer.samples_this_ms.w);
 	mixer.samples_rendered_ms.fn = 0;
 	mixer.samples_rendered_ms.w = 0;
-	SDL_UnlockAudio();
 	MIXER_FillUp();
 }
 
+/* measure how irregularly the callback is called and size the target from it */
+static void MIXER_UpdateLatency(Bitu need) {
+	const Bit64u now = GetTicksUs();
+
+	if (mixer_ring.last_callback_us != 0) {
+		const double expect = ((double)need * 1000000.0) / mixer.freq;
+		double dev = fabs((double)(now - mixer_ring.last_callback_us) - expect);
+
+		/* one stall (window dragged, machine paused) shouldn't add more than two blocks */
+		if (dev > expect * 2) dev = expect * 2;
+		/* follow spikes at once, forget them slowly */
+		if (dev > mixer_ring.jitter_us)
+			mixer_ring.jitter_us = dev;
+		else
+			mixer_ring.jitter_us += (dev - mixer_ring.jitter_us) * (1.0 / 256);
+	}
+	mixer_ring.last_callback_us = now;
+
+	Bitu target = mixer.prebuffer_samples + (Bitu)((mixer_ring.jitter_us * 2 * mixer.freq) / 1000000.0);
+	if (target > (MIXER_RINGSIZE / 4)) target = MIXER_RINGSIZE / 4;
+	mixer_ring.target = target;
+}
+
+/* 4-point cubic (Catmull-Rom) resampling of the ring at mixer_ring.ratio. At a
+ * ratio of exactly 1 the phase stays 0 and the frames come out unchanged.
+ * Returns how many of the need frames could not be made because the ring ran dry. */
+static Bitu MIXER_Resample(Bit16s *output,Bitu need,Bit32u in,Bit32s volscale1,Bit32s volscale2) {
+	const double step = mixer_ring.ratio;
+	double phase = mixer_ring.phase;
+	Bit32u out = mixer_ring.out;
+	Bit32s (*hist)[2] = mixer_ring.hist;
+	Bit32s volscale[2];
+
+	volscale[0] = volscale1;
+	volscale[1] = volscale2;
+
+	while (need > 0) {
+		while (phase >= 1.0 && out != in) {
+			const Bit32s *frame = mixer_ring.frames[out & MIXER_RINGMASK];
+			for (unsigned int c=0;c < 2;c++) {
+				hist[0][c] = hist[1][c];
+				hist[1][c] = hist[2][c];
+				hist[2][c] = hist[3][c];
+				hist[3][c] = frame[c];
+			}
+			out++;
+			phase -= 1.0;
+		}
+		if (phase >= 1.0) break;
+
+		for (unsigned int c=0;c < 2;c++) {
+			const double p0 = hist[0][c],p1 = hist[1][c],p2 = hist[2][c],p3 = hist[3][c];
+			const double v = p1 + 0.5 * phase * ((p2 - p0) +
+				phase * ((2.0 * p0 - 5.0 * p1 + 4.0 * p2 - p3) + phase * (3.0 * (p1 - p2) + p3 - p0)));
+			*output++ = MIXER_CLIP((((Bit64s)floor(v + 0.5)) * (Bit64s)volscale[c]) >> (MIXER_VOLSHIFT + MIXER_VOLSHIFT));
+		}
+		phase += step;
+		need--;
+	}
+
+	mixer_ring.phase = phase;
+	MIXER_BARRIER();
+	mixer_ring.out = out;
+	return need;
+}
+
 static void MIXER_CallBack(void * userdata, Uint8 *stream, int len) {
     Bit32s volscale1 = (Bit32s)(mixer.mastervol[0] * (1 << MIXER_VOLSHIFT));
     Bit32s volscale2 = (Bit32s)(mixer.mastervol[1] * (1 << MIXER_VOLSHIFT));
 	Bitu need = (Bitu)len/MIXER_SSIZE;
 	Bit16s *output = (Bit16s*)stream;
-	int remains;
-	Bit32s *in;
+	const Bit32u in = mixer_ring.in;
+	Bitu avail;
 
-    if (mixer.mute) {
-		if ((CaptureState & (CAPTURE_WAVE|CAPTURE_VIDEO|CAPTURE_MULTITRACK_WAVE)) != 0)
-			mixer.work_out = mixer.work_in;
-		else
-			mixer.work_out = mixer.work_in = 0;
+	MIXER_BARRIER();
+	MIXER_UpdateLatency(need);
+
+	if (mixer.mute) {
+		/* whatever was capturing has seen it already */
+		mixer_ring.out = in;
 	}
-	 
-    if (mixer.prebuffer_wait) {
-        remains = (int)mixer.work_in - (int)mixer.work_out;
-        if (remains < 0) remains += mixer.work_wrap;
+	avail = (Bitu)(in - mixer_ring.out);
 
-        if (remains >= mixer.prebuffer_samples)
-            mixer.prebuffer_wait = false;
-    }
+	if (mixer.prebuffer_wait && avail >= (mixer_ring.target + need))
+		mixer.prebuffer_wait = false;
 
 	if (!mixer.prebuffer_wait && !mixer.mute) {
-        in = &mixer.work[mixer.work_out][0];
-        while (need > 0) {
-            if (mixer.work_out == mixer.work_in) break;
-            *output++ = MIXER_CLIP((((Bit64s)(*in++)) * (Bit64s)volscale1) >> (MIXER_VOLSHIFT + MIXER_VOLSHIFT));
-            *output++ = MIXER_CLIP((((Bit64s)(*in++)) * (Bit64s)volscale2) >> (MIXER_VOLSHIFT + MIXER_VOLSHIFT));
-            mixer.work_out++;
-            if (mixer.work_out >= mixer.work_wrap) {
-                mixer.work_out = 0;
-                in = &mixer.work[mixer.work_out][0];
-            }
-            need--;
-        }
-    }
+		/* far ahead (the audio device stalled), resampling would take ages to catch up */
+		if (avail > (mixer_ring.target + need + (mixer.blocksize * 2))) {
+			mixer_ring.out += (Bit32u)(avail - (mixer_ring.target + need));
+			avail = mixer_ring.target + need;
+			mixer_ring.skips++;
+		}
 
-    if (need > 0)
-        mixer.prebuffer_wait = true;
+		/* steer the ratio so the fill level after this block drifts to the target */
+		const double err = (double)avail - (double)need - (double)mixer_ring.target;
+		mixer_ring.fill_err += (err - mixer_ring.fill_err) * 0.05;
+		double adj = mixer_ring.fill_err / ((double)mixer.freq * MIXER_DRIFT_SECONDS);
+		if (adj > MIXER_DRIFT_MAX) adj = MIXER_DRIFT_MAX;
+		else if (adj < -MIXER_DRIFT_MAX) adj = -MIXER_DRIFT_MAX;
+		mixer_ring.ratio = 1.0 + adj;
+
+		Bitu left = MIXER_Resample(output,need,in,volscale1,volscale2);
+		output += (need - left) * 2;
+		need = left;
+
+		if (need > 0) {
+			mixer_ring.underruns++;
+			mixer.prebuffer_wait = true;
+		}
+	}
+	else if (need > 0) {
+		mixer.prebuffer_wait = true;
+	}
 
 	while (need > 0) {
 		*output++ = 0;
 		*output++ = 0;
 		need--;
 	}
-
-	remains = (int)mixer.work_in - (int)mixer.work_out;
-	if (remains < 0) remains += mixer.work_wrap;
-
-	if ((unsigned long)remains >= (mixer.blocksize*2UL)) {
-		/* drop some samples to keep time */
-		unsigned int drop;
-
-		if ((unsigned long)remains >= (mixer.blocksize*3UL)) // hard drop
-			drop = ((unsigned int)remains - (unsigned int)(mixer.blocksize));
-		else // subtle drop
-			drop = (((unsigned int)remains - (unsigned int)(mixer.blocksize*2)) / 50U) + 1;
-
-		while (drop > 0) {
-			mixer.work_out++;
-			if (mixer.work_out >= mixer.work_wrap) mixer.work_out = 0;
-			drop--;
-		}
-	}
 }
 
 static void MIXER_Stop(Section* sec) {
@@ -844,6 +939,10 @@ public:
 			chan->UpdateVolume();
 			chan=chan->next;
 		}
+		if (cmd->FindExist("/STATS")) {
+			ShowStats();
+			return;
+		}
 		if (cmd->FindExist("/NOSHOW")) return;
 		chan=mixer.channels;
 		WriteOut("Channel  Main    Main(dB)\n");
@@ -860,6 +959,21 @@ private:
 		);
 	}
 
+	void ShowStats(void) {
+		const double freq = (double)mixer.freq;
+		if (mixer.nosound) {
+			WriteOut("No sound output.\n");
+			return;
+		}
+		WriteOut("Target latency  %.1fms (prebuffer %.1fms)\n",
+			(mixer_ring.target * 1000.0) / freq,(mixer.prebuffer_samples * 1000.0) / freq);
+		WriteOut("Buffered        %.1fms\n",((Bit32u)(mixer_ring.in - mixer_ring.out) * 1000.0) / freq);
+		WriteOut("Callback jitter %.2fms\n",mixer_ring.jitter_us / 1000.0);
+		WriteOut("Drift correction %+.0fppm\n",(mixer_ring.ratio - 1.0) * 1000000.0);
+		WriteOut("Underruns %u, overruns %u, skips %u\n",
+			(unsigned int)mixer_ring.underruns,(unsigned int)mixer_ring.overruns,(unsigned int)mixer_ring.skips);
+	}
+
 	void ListMidi(){
 #if defined (WIN32)
 		unsigned int total = midiOutGetNumDevs();	
@@ -1001,6 +1115,8 @@ void MIXER_Init() {
 	mixer.pos=0;
 	mixer.done=0;
 	memset(mixer.work,0,sizeof(mixer.work));
+	memset(&mixer_ring,0,sizeof(mixer_ring));
+	mixer_ring.ratio=1.0;
 	mixer.mastervol[0]=1.0f;
 	mixer.mastervol[1]=1.0f;
 	mixer.recordvol[0]=1.0f;
@@ -1036,9 +1152,7 @@ void MIXER_Init() {
 	}
 	mixer_start_pic_time = PIC_FullIndex();
 	mixer_sample_counter = 0;
-	mixer.work_in = mixer.work_out = 0;
-	mixer.work_wrap = MIXER_BUFSIZE;
-	if (mixer.work_wrap <= mixer.blocksize) E_Exit("blocksize too large");
+	if ((MIXER_RINGSIZE / 4) < mixer.blocksize) E_Exit("blocksize too large");
 
     {
         int ms = section->Get_int("prebuffer");
@@ -1046,8 +1160,8 @@ void MIXER_Init() {
         if (ms < 0) ms = 20;
 
         mixer.prebuffer_samples = (ms * mixer.freq) / 1000;
-        if (mixer.prebuffer_samples > (mixer.work_wrap / 2))
-            mixer.prebuffer_samples = (mixer.work_wrap / 2);
+        if (mixer.prebuffer_samples > (MIXER_RINGSIZE / 4))
+            mixer.prebuffer_samples = (MIXER_RINGSIZE / 4);
     }
 
 	// how many samples per millisecond? compute as improper fraction (sample rate / 1000)
@@ -99,6 +99,7 @@ static PIC_Controller pics[2];
 static PIC_Controller& master = pics[0];
 static PIC_Controller& slave  = pics[1];
 Bitu PIC_Ticks = 0;
+Bitu PIC_TickEpoch = 0;
 Bitu PIC_IRQCheck = 0; //Maybe make it a bool and/or ensure 32bit size (x86 dynamic core seems to assume 32 bit variable size)
 Bitu PIC_IRQCheckPending = 0; //Maybe make it a bool and/or ensure 32bit size (x86 dynamic core seems to assume 32 bit variable size)
 bool enable_slave_pic = true; /* if set, emulate slave with cascade to master. if clear, emulate only master, and no cascade (IRQ 2 is open) */
@@ -200,7 +201,7 @@ void PIC_Controller::start_irq(Bit8u val){
 }
 
 struct PICEntry {
-	float index;
+	pic_tick_t index;			/* when the event is due, see PIC_TICK_ONE */
 	Bitu value;
 	PIC_EventHandler pic_event;
 	PICEntry * next;
@@ -553,6 +554,16 @@ void DEBUG_PICMask(int irq,bool mask) {
         PIC_SetIRQMask(irq,mask);
 }
 
+/* How far an event is from cycle index_nd of the current millisecond, in
+ * cycles times PIC_TICK_ONE. It is due when this is <= 0. Events further
+ * than two milliseconds away count as two to keep the product in range. */
+static INLINE pic_tick_t PIC_EventDistance(const PICEntry * entry,Bits index_nd) {
+	pic_tick_t ofs=entry->index-(pic_tick_t)(PIC_Ticks-PIC_TickEpoch)*PIC_TICK_ONE;
+	if (ofs>2*PIC_TICK_ONE) ofs=2*PIC_TICK_ONE;
+	else if (ofs<-2*PIC_TICK_ONE) ofs=-2*PIC_TICK_ONE;
+	return ofs*(pic_tick_t)CPU_CycleMax-(pic_tick_t)index_nd*PIC_TICK_ONE;
+}
+
 static void AddEntry(PICEntry * entry) {
 	PICEntry * find_entry=pic_queue.next_entry;
 	if (GCC_UNLIKELY(find_entry ==0)) {
@@ -577,7 +588,7 @@ static void AddEntry(PICEntry * entry) {
 			break;
 		}
 	}
-	Bits cycles=PIC_MakeCycles(pic_queue.next_entry->index-PIC_TickIndex());
+	Bits cycles=(Bits)(PIC_EventDistance(pic_queue.next_entry,PIC_TickIndexND())/PIC_TICK_ONE);
 	if (cycles<CPU_Cycles) {
 		CPU_CycleLeft+=CPU_Cycles;
 		CPU_Cycles=0;
@@ -585,23 +596,28 @@ static void AddEntry(PICEntry * entry) {
 }
 
 static bool InEventService = false;
-static float srv_lag = 0;
+static pic_tick_t srv_lag = 0;
 
 double PIC_GetCurrentEventTime(void) {
     if (InEventService)
-        return (double)PIC_Ticks + srv_lag;
+        return (double)PIC_TickEpoch+PIC_TicksToMs(srv_lag);
     else
         return PIC_FullIndex();
 }
  
-void PIC_AddEvent(PIC_EventHandler handler,float delay,Bitu val) {
+void PIC_AddEvent(PIC_EventHandler handler,double delay,Bitu val) {
+	PIC_AddEventTicks(handler,PIC_MsToTicks(delay),val);
+}
+
+void PIC_AddEventTicks(PIC_EventHandler handler,pic_tick_t delay,Bitu val) {
 	if (GCC_UNLIKELY(!pic_queue.free_entry)) {
 		LOG(LOG_PIC,LOG_ERROR)("Event queue full");
 		return;
 	}
 	PICEntry * entry=pic_queue.free_entry;
+	// events added by an event handler count from when that event was due
 	if(InEventService) entry->index = delay + srv_lag;
-	else entry->index = delay + PIC_TickIndex();
+	else entry->index = delay + PIC_FullTicks();
 
 	entry->pic_event=handler;
 	entry->value=val;
@@ -673,7 +689,7 @@ bool PIC_RunQueue(void) {
 		/* Check the queue for an entry */
 		Bits index_nd=PIC_TickIndexND();
 		InEventService = true;
-		while (pic_queue.next_entry && (pic_queue.next_entry->index*CPU_CycleMax<=index_nd)) {
+		while (pic_queue.next_entry && (PIC_EventDistance(pic_queue.next_entry,index_nd)<=0)) {
 			PICEntry * entry=pic_queue.next_entry;
 			pic_queue.next_entry=entry->next;
 
@@ -688,7 +704,7 @@ bool PIC_RunQueue(void) {
 
 		/* Check when to set the new cycle end */
 		if (pic_queue.next_entry) {
-			Bits cycles=(Bits)(pic_queue.next_entry->index*CPU_CycleMax-index_nd);
+			Bits cycles=(Bits)(PIC_EventDistance(pic_queue.next_entry,index_nd)/PIC_TICK_ONE);
 			if (GCC_UNLIKELY(!cycles)) cycles=1;
 			if (cycles<CPU_CycleLeft) {
 				CPU_Cycles=cycles;
@@ -760,9 +776,17 @@ static unsigned long PIC_benchstart = 0;
 static unsigned long PIC_tickstart = 0;
 
 extern void GFX_SetTitle(Bit32s cycles, Bits frameskip, Bits timing, bool paused);
+/* Move event time 0 forward by PIC_EPOCH_SPAN ms, see pic.h */
+static void PIC_MoveEpoch(void) {
+	for (PICEntry * entry=pic_queue.next_entry;entry;entry=entry->next)
+		entry->index-=(pic_tick_t)PIC_EPOCH_SPAN*PIC_TICK_ONE;
+	PIC_TickEpoch+=PIC_EPOCH_SPAN;
+}
+
 void TIMER_AddTick(void) {
 	/* Setup new amount of cycles for PIC */
 	PIC_Ticks++;
+	if (GCC_UNLIKELY((PIC_Ticks-PIC_TickEpoch) >= PIC_EPOCH_SPAN)) PIC_MoveEpoch();
 	if ((PIC_Ticks&0x3fff) == 0) {
 		unsigned long ticks = GetTicks();
 		int delta = (PIC_Ticks-PIC_tickstart)*10000/(ticks-PIC_benchstart)+5;
@@ -777,13 +801,6 @@ void TIMER_AddTick(void) {
     if (time_limit_ms != 0 && PIC_Ticks >= time_limit_ms)
         throw int(1);
 
-	/* Go through the list of scheduled events and lower their index with 1000 */
-	PICEntry * entry=pic_queue.next_entry;
-	while (entry) {
-		entry->index -= 1.0;
-		entry=entry->next;
-	}
-
 	/* Call our list of ticker handlers */
 	TickerBlock * ticker=firstticker;
 	while (ticker) {
@@ -840,8 +857,12 @@ void PIC_Reset(Section *sec) {
 	// LOG
 	LOG(LOG_MISC,LOG_DEBUG)("PIC_Reset(): reinitializing PIC controller (cascade=%d)",master_cascade_irq);
 
-	/* Setup pic0 and pic1 with initial values like DOS has normally */
+	/* Setup pic0 and pic1 with initial values like DOS has normally.
+	 * Pending events keep their distance from the current time. */
+	for (PICEntry * entry=pic_queue.next_entry;entry;entry=entry->next)
+		entry->index-=(pic_tick_t)(PIC_Ticks-PIC_TickEpoch)*PIC_TICK_ONE;
 	PIC_Ticks=0;
+	PIC_TickEpoch=0;
 	PIC_IRQCheck=0;
 	for (i=0;i<2;i++) {
 		pics[i].auto_eoi=false;
@@ -0,0 +1,360 @@
+/*
+ *  Copyright (C) 2002-2015  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* In-memory rewind buffer.
+ *
+ * Every "rewind interval" milliseconds a snapshot of the CPU state, system RAM
+ * and video RAM is taken. Memory is not copied whole: a shadow copy holds the
+ * contents as of the newest snapshot, and each snapshot stores only the pages
+ * that changed since the one before it, as they were *before* the change
+ * (a reverse delta). Going back one step means restoring the shadow and then
+ * undoing the newest delta on the shadow.
+ *
+ * Which pages changed is learned from the dirty maps of RAM (mem.h) and video
+ * memory (vga.h), so the cost of a snapshot follows the number of pages the
+ * guest wrote, not the amount of RAM and VRAM. Video memory written through
+ * the linear framebuffer is tracked per page. A write through the A0000-BFFFF
+ * window only tells that the window was used, so all of video memory is
+ * compared for that interval. Writes that bypass the TLB and the handlers are
+ * limited to memset()s of the BIOS/DOS code during boot, which a reset
+ * discards anyway. Setting "rewind keyframe interval" compares all of RAM
+ * every so many snapshots in case something else does.
+ *
+ * The ring is bounded by "rewind memory": the oldest snapshots are dropped
+ * once the deltas take up more than that, so quiet stretches keep a long
+ * history and busy ones a short one. "rewind depth" can cap the count too.
+ *
+ * Only CPU, FPU, paging, RAM and VRAM contents are rewound. Device state (PIC,
+ * timers, VGA registers, DMA, sound, disk) stays where it is: most devices
+ * have no save state hooks to take it from. Pending events and the video mode
+ * may then not fit memory any more, which is why the option is documented and
+ * announced as experimental. It is meant for backing up a few seconds in a
+ * game, not as a replacement for save states. */
+
+#include <string.h>
+#include <vector>
+#include "dosbox.h"
+#include "control.h"
+#include "setup.h"
+#include "mem.h"
+#include "paging.h"
+#include "regs.h"
+#include "cpu.h"
+#include "fpu.h"
+#include "pic.h"
+#include "timer.h"
+#include "vga.h"
+#include "mapper.h"
+
+extern CPU_Decoder * cpudecoder;
+
+/* one tracked block of host memory (system RAM or VRAM) */
+class RewindRegion {
+public:
+	RewindRegion() : base(NULL), pages(0) { }
+public:
+	/* returns true if the region (re)started, i.e. the shadow was (re)built */
+	bool Attach(HostPt _base,Bitu size) {
+		Bitu npages = size / MEM_PAGESIZE;
+
+		if (_base == base && npages == pages) return false;
+
+		base = _base;
+		pages = npages;
+		shadow.resize(pages * MEM_PAGESIZE);
+		if (pages != 0) memcpy(&shadow[0],base,pages * MEM_PAGESIZE);
+		return true;
+	}
+	void Detach(void) {
+		base = NULL;
+		pages = 0;
+		std::vector<Bit8u>().swap(shadow);
+	}
+	/* compare the pages flagged in dirty against the shadow, dirty == NULL means
+	 * every page. changed pages are recorded in (delta_pages,delta_data) with their old contents. */
+	void Capture(const Bit8u *dirty,Bitu dirty_count,std::vector<Bit32u> &delta_pages,std::vector<Bit8u> &delta_data) {
+		for (Bitu page=0;page < pages;page++) {
+			if (dirty != NULL && page < dirty_count && !dirty[page]) continue;
+
+			Bit8u *cur = base + (page * MEM_PAGESIZE);
+			Bit8u *old = &shadow[page * MEM_PAGESIZE];
+			if (memcmp(cur,old,MEM_PAGESIZE) == 0) continue;
+
+			size_t ofs = delta_data.size();
+			delta_data.resize(ofs + MEM_PAGESIZE);
+			memcpy(&delta_data[ofs],old,MEM_PAGESIZE);
+			delta_pages.push_back((Bit32u)page);
+			memcpy(old,cur,MEM_PAGESIZE);
+		}
+	}
+	/* undo a delta on the shadow, so the shadow moves one snapshot back */
+	void Undo(const std::vector<Bit32u> &delta_pages,const std::vector<Bit8u> &delta_data) {
+		for (size_t i=0;i < delta_pages.size();i++) {
+			Bitu page = delta_pages[i];
+			if (page < pages) memcpy(&shadow[page * MEM_PAGESIZE],&delta_data[i * MEM_PAGESIZE],MEM_PAGESIZE);
+		}
+	}
+public:
+	HostPt base;
+	Bitu pages;
+	std::vector<Bit8u> shadow;
+};
+
+struct RewindSnapshot {
+	CPU_Regs regs;
+	Segments segs;
+	CPUBlock cpu;
+#if C_FPU
+	FPU_rec fpu;
+#endif
+	CPU_Decoder *decoder;
+	Bitu cr3;
+	bool paging_enabled;
+	/* reverse deltas: contents of changed pages as of the previous snapshot */
+	std::vector<Bit32u> ram_pages;
+	std::vector<Bit8u> ram_data;
+	std::vector<Bit32u> vram_pages;
+	std::vector<Bit8u> vram_data;
+
+	size_t Bytes(void) const {
+		return sizeof(*this) + (ram_pages.size() + vram_pages.size()) * sizeof(Bit32u) + ram_data.size() + vram_data.size();
+	}
+};
+
+static RewindRegion rewind_ram;
+static RewindRegion rewind_vram;
+static std::vector<RewindSnapshot*> rewind_ring;	/* oldest first */
+
+static Bitu rewind_interval = 0;		/* ms, 0 = disabled */
+static Bitu rewind_depth = 0;			/* 0 = only limited by rewind_budget */
+static size_t rewind_budget = 0;		/* bytes */
+static size_t rewind_bytes = 0;			/* held by the snapshots in the ring */
+static Bitu rewind_keyframe_interval = 0;	/* 0 = never compare all of RAM */
+static Bitu rewind_ms = 0;
+static Bitu rewind_count = 0;			/* snapshots taken since the last keyframe */
+
+static void REWIND_Clear(void) {
+	for (size_t i=0;i < rewind_ring.size();i++) delete rewind_ring[i];
+	rewind_ring.clear();
+	rewind_bytes = 0;
+}
+
+static void REWIND_Reset(void) {
+	REWIND_Clear();
+	rewind_ram.Detach();
+	rewind_vram.Detach();
+	VGA_EnableDirtyTracking(false);
+	rewind_ms = 0;
+	rewind_count = 0;
+}
+
+static void REWIND_ClearDirtyPages(void) {
+	VGA_ClearDirtyPages();
+	MEM_ClearDirtyPages();
+}
+
+/* whether the guest wrote through the video memory window since the dirty maps were cleared.
+ * if so, the RAM behind the Tandy/PCjr window is marked as well */
+static bool REWIND_WindowWritten(void) {
+	bool written = false;
+
+	if (MEM_dirty_map == NULL) return true;
+	for (Bitu page=0xA0;page < 0xC0 && page < MEM_dirty_pages;page++) {
+		if (MEM_dirty_map[page]) written = true;
+	}
+	if (IS_PC98_ARCH) {
+		for (Bitu page=0xE0;page < 0xE8 && page < MEM_dirty_pages;page++) {
+			if (MEM_dirty_map[page]) written = true;
+		}
+	}
+
+	if (written && vga.tandy.mem_base >= MemBase && vga.tandy.mem_base < MemBase + (MEM_dirty_pages * MEM_PAGESIZE)) {
+		Bitu page = (Bitu)(vga.tandy.mem_base - MemBase) / MEM_PAGESIZE;
+		for (Bitu i=0;i < 8;i++) MEM_MarkPageDirty(page + i);
+	}
+	return written;
+}
+
+static void REWIND_TakeSnapshot(void) {
+	if (MemBase == NULL) return;
+
+	bool keyframe = false;
+	if (rewind_keyframe_interval != 0 && ++rewind_count >= rewind_keyframe_interval) {
+		keyframe = true;
+		rewind_count = 0;
+	}
+
+	/* a (re)attached region starts a new history */
+	bool restarted = rewind_ram.Attach(MemBase,MEM_dirty_pages * MEM_PAGESIZE);
+	if (vga.mem.linear != NULL) {
+		if (rewind_vram.Attach(vga.mem.linear,vga.vmemsize)) {
+			VGA_EnableDirtyTracking(true);
+			restarted = true;
+		}
+	}
+	else {
+		rewind_vram.Detach();
+		VGA_EnableDirtyTracking(false);
+	}
+
+	if (restarted) REWIND_Clear();
+
+	bool window = REWIND_WindowWritten();
+
+	RewindSnapshot *s = new RewindSnapshot;
+	s->regs = cpu_regs;
+	s->segs = Segs;
+	s->cpu = cpu;
+#if C_FPU
+	s->fpu = fpu;
+#endif
+	s->decoder = cpudecoder;
+	s->cr3 = paging.cr3;
+	s->paging_enabled = paging.enabled;
+
+	if (!restarted) {
+		rewind_ram.Capture(keyframe ? NULL : MEM_dirty_map,MEM_dirty_pages,s->ram_pages,s->ram_data);
+		rewind_vram.Capture(window ? NULL : VGA_dirty_map,VGA_dirty_pages,s->vram_pages,s->vram_data);
+	}
+	REWIND_ClearDirtyPages();
+
+	/* drop the oldest snapshots to stay within the count and the memory budget.
+	 * the oldest entry only ever gets its state restored, its delta is never undone */
+	rewind_bytes += s->Bytes();
+	rewind_ring.push_back(s);
+	while (rewind_ring.size() > 1 && ((rewind_depth != 0 && rewind_ring.size() > rewind_depth) || rewind_bytes > rewind_budget)) {
+		rewind_bytes -= rewind_ring.front()->Bytes();
+		delete rewind_ring.front();
+		rewind_ring.erase(rewind_ring.begin());
+	}
+}
+
+/* copy the shadow back into the pages of guest memory flagged in dirty (NULL:
+ * all pages), the others have not been written since the newest snapshot.
+ * pages holding dynamic core code go through their page handler so the
+ * translated code is invalidated. */
+static void REWIND_RestoreRegion(RewindRegion &r,const Bit8u *dirty,Bitu dirty_count,bool is_ram) {
+	for (Bitu page=0;page < r.pages;page++) {
+		if (dirty != NULL && page < dirty_count && !dirty[page]) continue;
+
+		Bit8u *cur = r.base + (page * MEM_PAGESIZE);
+		const Bit8u *old = &r.shadow[page * MEM_PAGESIZE];
+		if (memcmp(cur,old,MEM_PAGESIZE) == 0) continue;
+
+		Bitu i = 0;
+		if (is_ram) {
+			/* the code page may release itself partway through, so look it up every time */
+			for (;i < MEM_PAGESIZE;i += 4) {
+				PageHandler *ph = MEM_GetPageHandler(page);
+				if (!(ph->getFlags() & PFLAG_HASCODE)) break;
+				ph->writed((PhysPt)((page * MEM_PAGESIZE) + i),host_readd(old + i));
+			}
+		}
+		if (i < MEM_PAGESIZE) memcpy(cur + i,old + i,MEM_PAGESIZE - i);
+	}
+}
+
+void REWIND_StepBack(bool pressed) {
+	if (!pressed) return;
+
+	if (rewind_ring.empty()) {
+		LOG_MSG("Rewind: nothing to rewind to");
+		return;
+	}
+
+	RewindSnapshot *s = rewind_ring.back();
+	rewind_ring.pop_back();
+
+	/* the shadow holds memory as of the newest snapshot */
+	bool window = REWIND_WindowWritten();
+	REWIND_RestoreRegion(rewind_ram,MEM_dirty_map,MEM_dirty_pages,true);
+	if (rewind_vram.base != NULL)
+		REWIND_RestoreRegion(rewind_vram,window ? NULL : VGA_dirty_map,VGA_dirty_pages,false);
+	rewind_bytes -= s->Bytes();
+
+	cpu_regs = s->regs;
+	Segs = s->segs;
+	cpu = s->cpu;
+#if C_FPU
+	fpu = s->fpu;
+#endif
+	cpudecoder = s->decoder;
+	PAGING_SetDirBase(s->cr3);
+	PAGING_Enable(s->paging_enabled);
+	PAGING_ClearTLB();
+
+	/* step the shadow back to the previous snapshot. guest memory now differs
+	 * from the shadow in exactly the undone pages, which the next snapshot must compare. */
+	rewind_ram.Undo(s->ram_pages,s->ram_data);
+	rewind_vram.Undo(s->vram_pages,s->vram_data);
+	REWIND_ClearDirtyPages();
+	for (size_t i=0;i < s->ram_pages.size();i++) MEM_MarkPageDirty(s->ram_pages[i]);
+	for (size_t i=0;i < s->vram_pages.size();i++) VGA_MarkPageDirty(s->vram_pages[i]);
+
+	LOG_MSG("Rewind: stepped back to %04x:%08x, %u snapshots left (device state not rewound)",
+		(unsigned int)SegValue(cs),(unsigned int)reg_eip,(unsigned int)rewind_ring.size());
+
+	delete s;
+	rewind_ms = 0;
+}
+
+static void REWIND_TickHandler(void) {
+	if (++rewind_ms < rewind_interval) return;
+	rewind_ms = 0;
+	REWIND_TakeSnapshot();
+}
+
+static void REWIND_ShutDown(Section *sec) {
+	(void)sec;//UNUSED
+	if (rewind_interval != 0) TIMER_DelTickHandler(REWIND_TickHandler);
+	rewind_interval = 0;
+	REWIND_Reset();
+	MEM_EnableDirtyTracking(false);
+}
+
+static void REWIND_OnReset(Section *sec) {
+	(void)sec;//UNUSED
+	/* memory layout and contents start over */
+	REWIND_Reset();
+	if (rewind_interval != 0) MEM_EnableDirtyTracking(true);
+}
+
+void REWIND_Init() {
+	Section_prop * section=static_cast<Section_prop *>(control->GetSection("dosbox"));
+
+	LOG(LOG_MISC,LOG_DEBUG)("Initializing rewind buffer");
+
+	rewind_interval = (Bitu)section->Get_int("rewind interval");
+	rewind_depth = (Bitu)section->Get_int("rewind depth");
+	rewind_budget = (size_t)section->Get_int("rewind memory") << (size_t)20;
+	rewind_keyframe_interval = (Bitu)section->Get_int("rewind keyframe interval");
+	if (rewind_budget == 0) rewind_interval = 0;
+
+	MAPPER_AddHandler(&REWIND_StepBack, MK_f3, MMODHOST, "rewind", "Rewind (experimental)");
+
+	AddExitFunction(AddExitFunctionFuncPair(REWIND_ShutDown));
+	AddVMEventFunction(VM_EVENT_RESET,AddVMEventFunctionFuncPair(REWIND_OnReset));
+
+	if (rewind_interval != 0) {
+		LOG_MSG("Rewind: EXPERIMENTAL, only CPU state and memory are rewound. Device state (PIC, timers, VGA registers, DMA, sound) is not");
+		LOG_MSG("Rewind: snapshot every %ums, up to %uMB and %u deep, full compare every %u",
+			(unsigned int)rewind_interval,(unsigned int)(rewind_budget >> (size_t)20),(unsigned int)rewind_depth,(unsigned int)rewind_keyframe_interval);
+		MEM_EnableDirtyTracking(true);
+		TIMER_AddTickHandler(REWIND_TickHandler);
+	}
+}
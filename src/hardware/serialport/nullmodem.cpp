@@ -39,6 +39,11 @@ CNullModem::CNullModem(Bitu id, CommandLine* cmd):CSerial (id, cmd) {
 	rx_state=N_RX_DISC;
 
 	tx_gather = 12;
+
+	rxbuf_pos = 0;
+	rxbuf_len = 0;
+	rx_bytes = 0;
+	tx_bytes = 0;
 	
 	dtrrespect=false;
 	tx_block=false;
@@ -46,6 +51,7 @@ CNullModem::CNullModem(Bitu id, CommandLine* cmd):CSerial (id, cmd) {
 	transparent=false;
     nonlocal=false;
 	telnet=false;
+	unpaced=false;
 	
 	Bitu bool_temp=0;
 
@@ -79,6 +85,11 @@ CNullModem::CNullModem(Bitu id, CommandLine* cmd):CSerial (id, cmd) {
 			telnet=true;
 		}
 	}
+	// unpaced: for links between two emulators. Don't emulate the line
+	// timing, move the data as fast as the applications can take it.
+	if (getBituSubstring("unpaced:", &bool_temp, cmd)) {
+		if (bool_temp==1) unpaced=true;
+	}
 	// rxdelay: How many milliseconds to wait before causing an
 	// overflow when the application is unresponsive.
 	if (getBituSubstring("rxdelay:", &rx_retry_max, cmd)) {
@@ -160,7 +171,10 @@ CNullModem::CNullModem(Bitu id, CommandLine* cmd):CSerial (id, cmd) {
 
 CNullModem::~CNullModem() {
 	if (serversocket) delete serversocket;
-	if (clientsocket) delete clientsocket;
+	if (clientsocket) {
+		LogThroughput();
+		delete clientsocket;
+	}
 	// remove events
 	for(Bit16u i = SERIAL_BASE_EVENT_COUNT+1;
 			i <= SERIAL_NULLMODEM_EVENT_COUNT; i++) {
@@ -177,12 +191,38 @@ void CNullModem::WriteChar(Bit8u data) {
 	}
 }
 
+void CNullModem::LogThroughput() {
+	LOG_MSG("Serial%d: %llu bytes sent, %llu bytes received.",(int)COMNUMBER,
+		(unsigned long long)tx_bytes,(unsigned long long)rx_bytes);
+}
+
+// return:
+// -1: no data
+// -2: socket closed
+// 0..255: data
+Bits CNullModem::readRawChar() {
+	if (!fillRxbuf()) return -2;
+	if (rxbuf_pos >= rxbuf_len) return -1;
+	return rxbuf[rxbuf_pos++];
+}
+
+// when the receive buffer is empty, pull whatever the socket has in one go
+// return: false if the socket closed
+bool CNullModem::fillRxbuf() {
+	if (rxbuf_pos < rxbuf_len) return true;
+	Bitu size = NULLMODEM_RXBUF_SIZE;
+	rxbuf_pos = rxbuf_len = 0;
+	if (!clientsocket->ReceiveArray(rxbuf, &size)) return false;
+	rxbuf_len = size;
+	return true;
+}
+
 Bits CNullModem::readChar() {
-	Bits rxchar = clientsocket->GetcharNonBlock();
+	Bits rxchar = readRawChar();
 	if (telnet && rxchar>=0) return TelnetEmulation((Bit8u)rxchar);
 	else if (rxchar==0xff && !transparent) {// escape char
 		// get the next char
-		Bits rxchar = clientsocket->GetcharNonBlock();
+		Bits rxchar = readRawChar();
 		if (rxchar==0xff) return rxchar; // 0xff 0xff -> 0xff was meant
 		rxchar&0x1? setCTS(true) : setCTS(false);
 		rxchar&0x2? setDSR(true) : setDSR(false);
@@ -202,7 +242,9 @@ bool CNullModem::ClientConnect(TCPClientSocket* newsocket) {
 		setCD(false);
 		return false;
 	}
-	clientsocket->SetSendBufferSize(256);
+	clientsocket->SetSendBufferSize(unpaced? NULLMODEM_UNPACED_TXBUF_SIZE:256);
+	rxbuf_pos = rxbuf_len = 0;
+	rx_bytes = tx_bytes = 0;
 	clientsocket->GetRemoteAddressString(peernamebuf);
 	// transmit the line status
 	if (!transparent) setRTSDTR(getRTS(), getDTR());
@@ -245,7 +287,9 @@ bool CNullModem::ServerConnect() {
         return false;
     }
 
-	clientsocket->SetSendBufferSize(256);
+	clientsocket->SetSendBufferSize(unpaced? NULLMODEM_UNPACED_TXBUF_SIZE:256);
+	rxbuf_pos = rxbuf_len = 0;
+	rx_bytes = tx_bytes = 0;
 	rx_state=N_RX_IDLE;
 	setEvent(SERIAL_POLLING_EVENT, 1);
 	
@@ -264,8 +308,10 @@ void CNullModem::Disconnect() {
 	removeEvent(SERIAL_RX_EVENT);
 	// it was disconnected; free the socket and restart the server socket
 	LOG_MSG("Serial%d: Disconnected.",(int)COMNUMBER);
+	LogThroughput();
 	delete clientsocket;
 	clientsocket=0;
+	rxbuf_pos = rxbuf_len = 0;
 	setDSR(false);
 	setCTS(false);
 	setCD(false);
@@ -290,6 +336,10 @@ void CNullModem::handleUpperEvent(Bit16u type) {
 			setEvent(SERIAL_POLLING_EVENT, 1.0f);
 			// update Modem input line states
 			updateMSR();
+			if (unpaced) {
+				receiveBulk();
+				break;
+			}
 			switch(rx_state) {
 				case N_RX_IDLE:
 					if (CanReceiveByte()) {
@@ -349,6 +399,10 @@ void CNullModem::handleUpperEvent(Bit16u type) {
 			break;
 		}
 		case SERIAL_RX_EVENT: {
+			if (unpaced) {
+				receiveBulk();
+				break;
+			}
 			switch(rx_state) {
 				case N_RX_IDLE:
 					LOG_MSG("internal error in nullmodem");
@@ -389,7 +443,9 @@ void CNullModem::handleUpperEvent(Bit16u type) {
 		}
 		case SERIAL_TX_EVENT: {
 			// Maybe echo cirquit works a bit better this way
-			if (rx_state==N_RX_IDLE && CanReceiveByte() && clientsocket) {
+			if (unpaced) {
+				if (clientsocket) receiveBulk();
+			} else if (rx_state==N_RX_IDLE && CanReceiveByte() && clientsocket) {
 				if (doReceive()) {
 					// a byte was received
 					rx_state=N_RX_WAIT;
@@ -402,7 +458,8 @@ void CNullModem::handleUpperEvent(Bit16u type) {
 		case SERIAL_THR_EVENT: {
 			ByteTransmitting();
 			// actually send it
-			setEvent(SERIAL_TX_EVENT,bytetime+0.01f);
+			if (unpaced) setEvent(SERIAL_TX_EVENT,NULLMODEM_UNPACED_BYTETIME);
+			else setEvent(SERIAL_TX_EVENT,bytetime+0.01f);
 			break;				   
 		}
 		case SERIAL_SERVER_POLLING_EVENT: {
@@ -450,6 +507,7 @@ bool CNullModem::doReceive () {
 		Bits rxchar = readChar();
 		if (rxchar>=0) {
 			receiveByteEx((Bit8u)rxchar,0);
+			rx_bytes++;
 			return true;
 		}
 		else if (rxchar==-2) {
@@ -457,11 +515,35 @@ bool CNullModem::doReceive () {
 		}
 		return false;
 }
+
+/*****************************************************************************/
+/* receiveBulk is the unpaced receive path: it fills the receive FIFO as    **/
+/* far as possible instead of clocking in one byte per bytetime.            **/
+/*****************************************************************************/
+void CNullModem::receiveBulk () {
+	removeEvent(SERIAL_RX_EVENT);
+	while (clientsocket && CanReceiveByte()) {
+		if (!doReceive()) {
+			// a line state change consumed the data, more may be buffered
+			if (!clientsocket || rxbuf_pos >= rxbuf_len) return;
+		}
+	}
+	// FIFO is full. Look again shortly only if data is waiting, otherwise
+	// the polling event picks up what arrives once the FIFO has drained
+	if (!clientsocket) return;
+	if (!fillRxbuf()) {
+		Disconnect();
+		return;
+	}
+	if (rxbuf_pos < rxbuf_len) setEvent(SERIAL_RX_EVENT, NULLMODEM_UNPACED_RX_INTERVAL);
+}
  
 void CNullModem::transmitByte (Bit8u val, bool first) {
+	float txtime = unpaced? NULLMODEM_UNPACED_BYTETIME:bytetime;
  	// transmit it later in THR_Event
-	if (first) setEvent(SERIAL_THR_EVENT, bytetime/8);
-	else setEvent(SERIAL_TX_EVENT, bytetime);
+	if (first) setEvent(SERIAL_THR_EVENT, txtime/8);
+	else setEvent(SERIAL_TX_EVENT, txtime);
+	tx_bytes++;
 
 	// disable 0xff escaping when transparent mode is enabled
 	if (!transparent && (val==0xff)) WriteChar(0xff);
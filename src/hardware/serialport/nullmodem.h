@@ -33,6 +33,19 @@
 #define SERIAL_NULLMODEM_DTR_EVENT	SERIAL_BASE_EVENT_COUNT+3
 #define SERIAL_NULLMODEM_EVENT_COUNT	SERIAL_BASE_EVENT_COUNT+3
 
+// size of the coalescing receive buffer, data is pulled from the socket
+// in chunks of this size instead of one recv() per byte
+#define NULLMODEM_RXBUF_SIZE	4096
+
+// size of the transmit gather buffer in unpaced mode
+#define NULLMODEM_UNPACED_TXBUF_SIZE	4096
+
+// time per byte [milliseconds] used instead of the line timing in unpaced mode
+#define NULLMODEM_UNPACED_BYTETIME	0.001f
+
+// how often a full receive FIFO is topped up in unpaced mode [milliseconds]
+#define NULLMODEM_UNPACED_RX_INTERVAL	0.05f
+
 class CNullModem : public CSerial {
 public:
 	CNullModem(Bitu id, CommandLine* cmd);
@@ -71,7 +84,16 @@ private:
 	bool ServerConnect();
     void Disconnect();
 	Bits readChar();
+	Bits readRawChar();
+	bool fillRxbuf();
 	void WriteChar(Bit8u data);
+	void receiveBulk();
+	void LogThroughput();
+
+	// coalesced receive buffer
+	Bit8u rxbuf[NULLMODEM_RXBUF_SIZE];
+	Bitu rxbuf_pos;
+	Bitu rxbuf_len;
 
 	bool DTR_delta;		// with dtrrespect, we try to establish a connection
 						// whenever DTR switches to 1. This variable is
@@ -99,6 +121,12 @@ private:
 
     bool nonlocal;      // Enable connections NOT originating from localhost
 
+	bool unpaced;		// DOSBox-to-DOSBox link: ignore line timing and
+						// fill the receive FIFO in bulk.
+
+	Bit64u rx_bytes;	// throughput counters for this connection
+	Bit64u tx_bytes;
+
 	// Telnet's brain
 #define TEL_CLIENT 0
 #define TEL_SERVER 1
@@ -18,6 +18,12 @@
 
 
 #include <math.h>
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
 #include "dosbox.h"
 #include "inout.h"
 #include "pic.h"
@@ -28,6 +34,28 @@
 #include "setup.h"
 #include "control.h"
 
+Bit64u GetTicksUs(void) {
+#if defined(WIN32)
+	static LARGE_INTEGER freq = {{0,0}};
+	LARGE_INTEGER now;
+
+	if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (Bit64u)((now.QuadPart / freq.QuadPart) * 1000000ULL +
+		((now.QuadPart % freq.QuadPart) * 1000000ULL) / freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ((Bit64u)ts.tv_sec * 1000000ULL) + ((Bit64u)ts.tv_nsec / 1000ULL);
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv,NULL);
+	return ((Bit64u)tv.tv_sec * 1000000ULL) + (Bit64u)tv.tv_usec;
+#endif
+}
+
 static INLINE void BIN2BCD(Bit16u& val) {
 	Bit16u temp=val%10 + (((val/10)%10)<<4)+ (((val/100)%10)<<8) + (((val/1000)%10)<<12);
 	val=temp;
@@ -1710,7 +1710,7 @@ again:
 	}
 	
     if (vga.draw.lines_done < vga.draw.lines_total) {
-        PIC_AddEvent(VGA_DrawSingleLine,(float)vga.draw.delay.singleline_delay);
+        PIC_AddEvent(VGA_DrawSingleLine,vga.draw.delay.singleline_delay);
     } else {
         vga_mode_frames_since_time_base++;
         RENDER_EndUpdate(false);
@@ -1787,13 +1787,33 @@ static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
     }
 
     if (vga.draw.lines_done < vga.draw.lines_total) {
-        PIC_AddEvent(VGA_DrawEGASingleLine,(float)vga.draw.delay.singleline_delay);
+        PIC_AddEvent(VGA_DrawEGASingleLine,vga.draw.delay.singleline_delay);
     } else {
         vga_mode_frames_since_time_base++;
         RENDER_EndUpdate(false);
     }
 }
 
+/* for SELFTEST /BENCH: convert one frame of the current mode, starting at the
+ * beginning of video memory (no panning or start address), into pixel lines the
+ * way VGA_DrawSingleLine does, without passing them on to the scaler and without
+ * touching the drawing state. returns the lines drawn. */
+Bitu VGA_DrawFrameLines(void) {
+	if (VGA_DrawLine == NULL || vga.mem.linear == NULL) return 0;
+
+	Bitu address = 0;
+	Bitu address_line = 0;
+	for (Bitu line=0;line < vga.draw.lines_total;line++) {
+		VGA_DrawLine(address,address_line);
+		if (++address_line >= vga.draw.address_line_total) {
+			address_line = 0;
+			address += vga.draw.address_add;
+		}
+	}
+
+	return vga.draw.lines_total;
+}
+
 void VGA_SetBlinking(Bitu enabled) {
 	Bitu b;
 	LOG(LOG_VGA,LOG_NORMAL)("Blinking %d",(int)enabled);
@@ -2006,8 +2026,8 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 	case MCH_TANDY:
 		// PCJr: Vsync is directly connected to the IRQ controller
 		// Some earlier Tandy models are said to have a vsync interrupt too
-		PIC_AddEvent(VGA_Other_VertInterrupt, (float)vga.draw.delay.vrstart, 1);
-		PIC_AddEvent(VGA_Other_VertInterrupt, (float)vga.draw.delay.vrend, 0);
+		PIC_AddEvent(VGA_Other_VertInterrupt, vga.draw.delay.vrstart, 1);
+		PIC_AddEvent(VGA_Other_VertInterrupt, vga.draw.delay.vrend, 0);
 		// fall-through
 	case MCH_AMSTRAD:
 	case MCH_CGA:
@@ -2020,22 +2040,22 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		break;
 	case MCH_VGA:
     case MCH_PC98:
-		PIC_AddEvent(VGA_DisplayStartLatch, (float)vga.draw.delay.vrstart);
-		PIC_AddEvent(VGA_PanningLatch, (float)vga.draw.delay.vrend);
+		PIC_AddEvent(VGA_DisplayStartLatch, vga.draw.delay.vrstart);
+		PIC_AddEvent(VGA_PanningLatch, vga.draw.delay.vrend);
 		// EGA: 82c435 datasheet: interrupt happens at display end
 		// VGA: checked with scope; however disabled by default by jumper on VGA boards
 		// add a little amount of time to make sure the last drawpart has already fired
-		PIC_AddEvent(VGA_VertInterrupt,(float)(vga.draw.delay.vdend + 0.005));
+		PIC_AddEvent(VGA_VertInterrupt,vga.draw.delay.vdend + 0.005);
 		break;
 	case MCH_EGA:
-		PIC_AddEvent(VGA_DisplayStartLatch, (float)vga.draw.delay.vrend);
-		PIC_AddEvent(VGA_VertInterrupt,(float)(vga.draw.delay.vdend + 0.005));
+		PIC_AddEvent(VGA_DisplayStartLatch, vga.draw.delay.vrend);
+		PIC_AddEvent(VGA_VertInterrupt,vga.draw.delay.vdend + 0.005);
 		break;
 	default:
 		//E_Exit("This new machine needs implementation in VGA_VerticalTimer too.");
-		PIC_AddEvent(VGA_DisplayStartLatch, (float)vga.draw.delay.vrstart);
-		PIC_AddEvent(VGA_PanningLatch, (float)vga.draw.delay.vrend);
-		PIC_AddEvent(VGA_VertInterrupt,(float)(vga.draw.delay.vdend + 0.005));
+		PIC_AddEvent(VGA_DisplayStartLatch, vga.draw.delay.vrstart);
+		PIC_AddEvent(VGA_PanningLatch, vga.draw.delay.vrend);
+		PIC_AddEvent(VGA_VertInterrupt,vga.draw.delay.vdend + 0.005);
 		break;
 	}
 	// for same blinking frequency with higher frameskip
@@ -2206,8 +2226,8 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		}
 		vga.draw.lines_done = 0;
 		if (vga.draw.mode==EGALINE)
-			PIC_AddEvent(VGA_DrawEGASingleLine,(float)(vga.draw.delay.htotal/4.0 + draw_skip));
-		else PIC_AddEvent(VGA_DrawSingleLine,(float)(vga.draw.delay.htotal/4.0 + draw_skip));
+			PIC_AddEvent(VGA_DrawEGASingleLine,vga.draw.delay.htotal/4.0 + draw_skip);
+		else PIC_AddEvent(VGA_DrawSingleLine,vga.draw.delay.htotal/4.0 + draw_skip);
 		break;
 	}
 }
@@ -32,6 +32,7 @@
 #include "pc98_cg.h"
 #include "pc98_gdc.h"
 #include "zipfile.h"
+#include "hostmem.h"
 
 extern ZIPFile savestate_zip;
 
@@ -74,15 +75,28 @@ void VGAMEM_USEC_read_delay() {
 	}
 }
 
+static INLINE Bits VGAMEM_USEC_write_delay_cycles() {
+	return (CPU_CycleMax * vga_memio_delay_ns * 3) / (1000000 * 4);
+}
+
 void VGAMEM_USEC_write_delay() {
 	if (vga_memio_delay_ns > 0) {
-		Bits delaycyc = (CPU_CycleMax * vga_memio_delay_ns * 3) / (1000000 * 4);
+		Bits delaycyc = VGAMEM_USEC_write_delay_cycles();
 //		if(GCC_UNLIKELY(CPU_Cycles < 3*delaycyc)) delaycyc = 0; //Else port acces will set cycles to 0. which might trigger problem with games which read 16 bit values
 		CPU_Cycles -= delaycyc;
 		CPU_IODelayRemoved += delaycyc;
 	}
 }
 
+/* the delay of count writes at once */
+static void VGAMEM_USEC_write_delay_span(Bitu count) {
+	if (vga_memio_delay_ns > 0) {
+		Bits delaycyc = VGAMEM_USEC_write_delay_cycles() * (Bits)count;
+		CPU_Cycles -= delaycyc;
+		CPU_IODelayRemoved += delaycyc;
+	}
+}
+
 template <class Size>
 static INLINE void hostWrite(HostPt off, Bitu val) {
 	if ( sizeof( Size ) == 1)
@@ -347,6 +361,41 @@ template <const bool chained> static inline void VGA_Generic_Write_Handler(PhysP
 	((Bit32u*)vga.mem.linear)[planeaddr]=pixels.d;
 }
 
+/* VGA_Generic_Write_Handler<false> for count bytes from rawaddr on. No register
+ * can change within a span, so the plane mask, the address wrap and (for fills)
+ * the mode operation are worked out once. data repeats every period bytes, period
+ * 0 means data holds all count bytes. */
+static void VGA_Generic_Write_Span(PhysPt rawaddr,const Bit8u *data,Bitu period,Bitu count) {
+	const unsigned char hobit_n = (vga.seq.memory_mode&2/*Extended Memory*/) ? 16u : 14u;
+	const bool oddeven = (vga.gfx.miscellaneous&2) && !non_cga_ignore_oddeven_engage;
+	Bit32u *mem = (Bit32u*)vga.mem.linear;
+	Bit32u mask[2],fill[4];
+
+	mask[0] = mask[1] = vga.config.full_map_mask;
+	if (!(vga.seq.memory_mode&4) && !non_cga_ignore_oddeven_engage) {/* Odd Even Host Memory Write Addressing Disable (is not set) */
+		mask[0] &= 0xFF00FFu;
+		mask[1] &= 0xFF00FFu << 8u;
+	}
+
+	const PhysPt addrmask = ((vga.config.compatible_chain4 ? 0u : ~0xFFFFu) + (1u << hobit_n) - (oddeven ? 2u : 1u)) &
+		(vga.mem.memmask >> 2u);
+
+	for (Bitu i=0;i < period;i++) fill[i] = ModeOperation(data[i]);
+
+	for (Bitu i=0;i < count;i++,rawaddr++) {
+		PhysPt planeaddr = rawaddr & addrmask;
+		if (oddeven) planeaddr += (rawaddr >> hobit_n) & 1u;
+
+		const Bit32u m = mask[rawaddr & 1u];
+		const Bit32u d = period ? fill[i & (period - 1u)] : ModeOperation(data[i]);
+		VGA_Latch pixels;
+
+		pixels.d = (mem[planeaddr] & ~m) | (d & m);
+		vga.draw.font[planeaddr] = pixels.b[2];
+		mem[planeaddr] = pixels.d;
+	}
+}
+
 // Slow accurate emulation.
 // This version takes the Graphics Controller bitmask and ROPs into account.
 // This is needed for demos that use the bitmask to do color combination or bitplane "page flipping" tricks.
@@ -557,6 +606,25 @@ public:
 		writeHandler(addr+2,(Bit8u)(val >> 16));
 		writeHandler(addr+3,(Bit8u)(val >> 24));
 	}
+	bool writefill(PhysPt addr,Bitu val,Bitu width,Bitu count) {
+		Bit8u bytes[4];
+		for (Bitu i=0;i < width;i++) bytes[i] = (Bit8u)(val >> (i * 8u));
+		VGAMEM_USEC_write_delay_span(count);
+		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
+		addr += vga.svga.bank_write_full;
+		VGA_Generic_Write_Span(addr,bytes,width,width * count);
+		return true;
+	}
+	bool writeblock(PhysPt addr,const Bit8u *data,Bitu width,Bitu count) {
+		VGAMEM_USEC_write_delay_span(count);
+		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
+		addr += vga.svga.bank_write_full;
+		VGA_Generic_Write_Span(addr,data,0,width * count);
+		return true;
+	}
+	Bits writedelay(void) {
+		return (vga_memio_delay_ns > 0) ? VGAMEM_USEC_write_delay_cycles() : 0;
+	}
 };
 
 #include <stdio.h>
@@ -1788,6 +1856,7 @@ public:
 		return &vga.mem.linear[(phys_page&0x7F)*4096 + PC98_VRAM_GRAPHICS_OFFSET]; /* 512KB mapping */
 	}
 	HostPt GetHostWritePt(Bitu phys_page) {
+		VGA_MarkPageDirty(((phys_page&0x7F)*4096 + PC98_VRAM_GRAPHICS_OFFSET) >> 12);
 		return &vga.mem.linear[(phys_page&0x7F)*4096 + PC98_VRAM_GRAPHICS_OFFSET]; /* 512KB mapping */
 	}
 };
@@ -1835,6 +1904,7 @@ public:
 		return &vga.mem.linear[CHECKED3(phys_page * 4096)];
 	}
 	HostPt GetHostWritePt( Bitu phys_page ) {
+		VGA_MarkPageDirty((phys_page - vga.lfb.page) & ((vga.vmemsize >> 12) - 1));
 		return GetHostReadPt( phys_page );
 	}
 };
@@ -2419,7 +2489,7 @@ static void VGA_Memory_ShutDown(Section * /*sec*/) {
 	PAGING_ClearTLB();
 
 	if (vga.mem.linear_orgptr != NULL) {
-		delete[] vga.mem.linear_orgptr;
+		HostMem_Free(vga.mem.linear_orgptr);
 		vga.mem.linear_orgptr = NULL;
 		vga.mem.linear = NULL;
 	}
@@ -2452,6 +2522,37 @@ void VGAMEM_SaveState(Section *sec) {
 	}
 }
 
+Bit8u *VGA_dirty_map = NULL;
+Bitu VGA_dirty_pages = 0;
+
+void VGA_EnableDirtyTracking(bool enable) {
+	if (VGA_dirty_map != NULL) {
+		delete [] VGA_dirty_map;
+		VGA_dirty_map = NULL;
+		VGA_dirty_pages = 0;
+	}
+
+	if (enable && vga.mem.linear != NULL) {
+		VGA_dirty_pages = vga.vmemsize >> 12;
+		VGA_dirty_map = new Bit8u[VGA_dirty_pages];
+		/* everything counts as dirty until the first clear */
+		memset(VGA_dirty_map,1,VGA_dirty_pages);
+	}
+}
+
+/* the TLB flush that makes the next write relink and mark the page is done by MEM_ClearDirtyPages() */
+void VGA_ClearDirtyPages(void) {
+	if (VGA_dirty_map == NULL) return;
+
+	memset(VGA_dirty_map,0,VGA_dirty_pages);
+}
+
+void VGA_MarkAllPagesDirty(void) {
+	if (VGA_dirty_map == NULL) return;
+
+	memset(VGA_dirty_map,1,VGA_dirty_pages);
+}
+
 void VGA_SetupMemory() {
 	vga.svga.bank_read = vga.svga.bank_write = 0;
 	vga.svga.bank_read_full = vga.svga.bank_write_full = 0;
@@ -2459,8 +2560,8 @@ void VGA_SetupMemory() {
     if (1 || vga.vmemsize_alloced != vga.vmemsize) {
         VGA_Memory_ShutDown(NULL);
 
-        vga.mem.linear_orgptr = new Bit8u[vga.vmemsize+32];
-        memset(vga.mem.linear_orgptr,0,vga.vmemsize+32);
+        vga.mem.linear_orgptr = HostMem_Alloc(vga.vmemsize+32);
+        if (vga.mem.linear_orgptr == NULL) E_Exit("Can't allocate video memory of %u KB",(unsigned int)(vga.vmemsize/1024));
         vga.mem.linear=(Bit8u*)(((uintptr_t)vga.mem.linear_orgptr + 16-1) & ~(16-1));
         vga.vmemsize_alloced = vga.vmemsize;
 
@@ -203,6 +203,7 @@ void pc98_clear_text(void) {
 		*((uint16_t*)(vga.mem.linear + i)) = 0;
 		*((uint16_t*)(vga.mem.linear + i + 0x2000)) = 0xE1;
 	}
+	VGA_MarkAllPagesDirty();
 }
 
 void pc98_clear_graphics(void) {
@@ -216,4 +217,5 @@ void pc98_clear_graphics(void) {
 		*((uint16_t*)(vga.mem.linear + i + 0x38000)) = 0;
 		*((uint16_t*)(vga.mem.linear + i + 0x40000)) = 0;
 	}
+	VGA_MarkAllPagesDirty();
 }
@@ -143,18 +143,22 @@ void XGA_DrawPoint(Bitu x, Bitu y, Bitu c) {
 	switch(XGA_COLOR_MODE) {
 		case M_LIN8:
 			if (GCC_UNLIKELY(memaddr >= vga.vmemsize)) break;
+			VGA_MarkPageDirty(memaddr >> 12);
 			vga.mem.linear[memaddr] = c;
 			break;
 		case M_LIN15:
 			if (GCC_UNLIKELY(memaddr*2 >= vga.vmemsize)) break;
+			VGA_MarkPageDirty((memaddr*2) >> 12);
 			((Bit16u*)(vga.mem.linear))[memaddr] = (Bit16u)(c&0x7fff);
 			break;
 		case M_LIN16:
 			if (GCC_UNLIKELY(memaddr*2 >= vga.vmemsize)) break;
+			VGA_MarkPageDirty((memaddr*2) >> 12);
 			((Bit16u*)(vga.mem.linear))[memaddr] = (Bit16u)(c&0xffff);
 			break;
 		case M_LIN32:
 			if (GCC_UNLIKELY(memaddr*4 >= vga.vmemsize)) break;
+			VGA_MarkPageDirty((memaddr*4) >> 12);
 			((Bit32u*)(vga.mem.linear))[memaddr] = c;
 			break;
 		default:
@@ -184,7 +188,7 @@ Bitu XGA_GetPoint(Bitu x, Bitu y) {
 }
 
 
-Bitu XGA_GetMixResult(Bitu mixmode, Bitu srcval, Bitu dstdata) {
+static INLINE Bitu XGA_Mix(Bitu mixmode, Bitu srcval, Bitu dstdata) {
 	Bitu destval = 0;
 	switch(mixmode &  0xf) {
 		case 0x00: /* not DST */
@@ -242,6 +246,173 @@ Bitu XGA_GetMixResult(Bitu mixmode, Bitu srcval, Bitu dstdata) {
 	return destval;
 }
 
+Bitu XGA_GetMixResult(Bitu mixmode, Bitu srcval, Bitu dstdata) {
+	return XGA_Mix(mixmode, srcval, dstdata);
+}
+
+/* Span path for the rectangle commands. Mix and source are resolved once per
+   command, each row is clipped against the scissors once and then handed to a
+   kernel specialized for the pixel size and the mix. Pixels are still mixed in
+   the order the per-pixel loops used whenever source and destination overlap,
+   so the result is the same. Rows the span path can't take exactly (outside
+   video memory, a pattern the row draws over) go through the per-pixel loops. */
+enum {
+	XGA_SRC_CONST = 0,	/* backcolor or forecolor */
+	XGA_SRC_PATTERN,	/* 8 pixel pattern row */
+	XGA_SRC_SPAN,		/* video memory, same direction as the destination */
+	XGA_SRC_SPAN_BACK	/* video memory, walked downwards */
+};
+
+struct XGA_SpanCmd {
+	bool enabled;		/* destination writes enabled */
+	bool masked;		/* stored pixels lose bits (15-bit mode) */
+	Bitu size;			/* log2 of bytes per pixel */
+	Bitu mask;
+	Bits limit;			/* pixels in video memory */
+};
+
+struct XGA_SpanArgs {
+	HostPt dst;
+	HostPt src;
+	Bitu count;
+	Bitu srcval;
+	const Bitu *pattern;
+	Bits patx;
+	Bitu mask;
+};
+
+typedef void (*XGA_SpanKernel)(const XGA_SpanArgs &a);
+
+template <typename T, unsigned int mix, unsigned int srcmode>
+static void XGA_MixSpan(const XGA_SpanArgs &a) {
+	T *dst = (T*)a.dst;
+	const T *src = (const T*)a.src;
+
+	if (mix == 0x07 && srcmode == XGA_SRC_CONST && sizeof(T) == 1) {
+		memset(dst, (int)(a.srcval & a.mask), a.count);
+		return;
+	}
+	for (Bitu i = 0; i < a.count; i++) {
+		const Bits o = (srcmode == XGA_SRC_SPAN_BACK) ? -(Bits)i : (Bits)i;
+		Bitu srcval;
+		if (srcmode == XGA_SRC_SPAN || srcmode == XGA_SRC_SPAN_BACK) srcval = src[o];
+		else if (srcmode == XGA_SRC_PATTERN) srcval = a.pattern[(a.patx + o) & 0x7];
+		else srcval = a.srcval;
+		dst[o] = (T)(XGA_Mix(mix, srcval, dst[o]) & a.mask);
+	}
+}
+
+/* mix select 3: the source pixel picks the mix, rules as in BlitRect/DrawPattern */
+template <typename T, unsigned int srcmode>
+static void XGA_SelectSpan(const XGA_SpanArgs &a) {
+	T *dst = (T*)a.dst;
+	const T *src = (const T*)a.src;
+
+	for (Bitu i = 0; i < a.count; i++) {
+		const Bits o = (srcmode == XGA_SRC_SPAN_BACK) ? -(Bits)i : (Bits)i;
+		Bitu srcdata, srcval, mixmode;
+		if (srcmode == XGA_SRC_PATTERN) {
+			srcdata = a.pattern[(a.patx + o) & 0x7];
+			mixmode = xga.foremix;
+			if (srcdata == xga.backcolor || srcdata == 0)
+				mixmode = xga.backmix;
+		} else {
+			srcdata = src[o];
+			if (srcdata == xga.forecolor) mixmode = xga.foremix;
+			else if (srcdata == xga.backcolor) mixmode = xga.backmix;
+			else mixmode = 0x67;
+		}
+		switch ((mixmode >> 5) & 0x03) {
+			case 0x00: srcval = xga.backcolor; break;
+			case 0x01: srcval = xga.forecolor; break;
+			default: srcval = srcdata; break; /* PIX_TRANS never gets here */
+		}
+		dst[o] = (T)(XGA_Mix(mixmode, srcval, dst[o]) & a.mask);
+	}
+}
+
+#define XGA_MIX_KERNELS(T,SRC) { \
+	&XGA_MixSpan<T,0x0,SRC>, &XGA_MixSpan<T,0x1,SRC>, &XGA_MixSpan<T,0x2,SRC>, &XGA_MixSpan<T,0x3,SRC>, \
+	&XGA_MixSpan<T,0x4,SRC>, &XGA_MixSpan<T,0x5,SRC>, &XGA_MixSpan<T,0x6,SRC>, &XGA_MixSpan<T,0x7,SRC>, \
+	&XGA_MixSpan<T,0x8,SRC>, &XGA_MixSpan<T,0x9,SRC>, &XGA_MixSpan<T,0xa,SRC>, &XGA_MixSpan<T,0xb,SRC>, \
+	&XGA_MixSpan<T,0xc,SRC>, &XGA_MixSpan<T,0xd,SRC>, &XGA_MixSpan<T,0xe,SRC>, &XGA_MixSpan<T,0xf,SRC> }
+#define XGA_MIX_KERNELS_SIZE(T) { \
+	XGA_MIX_KERNELS(T,XGA_SRC_CONST), XGA_MIX_KERNELS(T,XGA_SRC_PATTERN), \
+	XGA_MIX_KERNELS(T,XGA_SRC_SPAN), XGA_MIX_KERNELS(T,XGA_SRC_SPAN_BACK) }
+#define XGA_SELECT_KERNELS_SIZE(T) { \
+	NULL, &XGA_SelectSpan<T,XGA_SRC_PATTERN>, \
+	&XGA_SelectSpan<T,XGA_SRC_SPAN>, &XGA_SelectSpan<T,XGA_SRC_SPAN_BACK> }
+
+/* [size][source][mix] */
+static const XGA_SpanKernel xga_mix_kernels[3][4][16] = {
+	XGA_MIX_KERNELS_SIZE(Bit8u), XGA_MIX_KERNELS_SIZE(Bit16u), XGA_MIX_KERNELS_SIZE(Bit32u)
+};
+/* [size][source] */
+static const XGA_SpanKernel xga_select_kernels[3][4] = {
+	XGA_SELECT_KERNELS_SIZE(Bit8u), XGA_SELECT_KERNELS_SIZE(Bit16u), XGA_SELECT_KERNELS_SIZE(Bit32u)
+};
+
+#undef XGA_MIX_KERNELS
+#undef XGA_MIX_KERNELS_SIZE
+#undef XGA_SELECT_KERNELS_SIZE
+
+static bool XGA_SpanSetup(XGA_SpanCmd &s) {
+	switch(XGA_COLOR_MODE) {
+		case M_LIN8:	s.size = 0; s.mask = 0xff; break;
+		case M_LIN15:	s.size = 1; s.mask = 0x7fff; break;
+		case M_LIN16:	s.size = 1; s.mask = 0xffff; break;
+		case M_LIN32:	s.size = 2; s.mask = 0xffffffff; break;
+		default:		return false;
+	}
+	s.enabled = (xga.curcommand & 0x11) == 0x11;
+	s.masked = (XGA_COLOR_MODE == M_LIN15);
+	s.limit = (Bits)(vga.vmemsize >> s.size);
+	return true;
+}
+
+/* pixel index of (x,y) the way XGA_GetPoint and XGA_DrawPoint compute it */
+static INLINE Bits XGA_PixelIndex(Bits x, Bits y) {
+	return (y * (Bits)XGA_SCREEN_WIDTH) + x;
+}
+
+/* the part of a row of pixels from x in direction dx that passes the scissors,
+   as the index of the first pixel drawn and the number of pixels */
+static bool XGA_ClipRow(Bits x, Bits y, Bits dx, Bitu &first, Bitu &count) {
+	const Bits n = (Bits)xga.MAPcount + 1;
+	Bits lo, hi;
+
+	if (y < (Bits)xga.scissors.y1 || y > (Bits)xga.scissors.y2) return false;
+	if (dx > 0) {
+		lo = (Bits)xga.scissors.x1 - x;
+		hi = (Bits)xga.scissors.x2 - x;
+	} else {
+		lo = x - (Bits)xga.scissors.x2;
+		hi = x - (Bits)xga.scissors.x1;
+	}
+	if (lo < 0) lo = 0;
+	if (hi > n - 1) hi = n - 1;
+	if (lo > hi) return false;
+	first = (Bitu)lo;
+	count = (Bitu)(hi - lo + 1);
+	return true;
+}
+
+/* host pointer to (x,y), NULL unless all count pixels from there in direction dx are in video memory */
+static HostPt XGA_SpanPtr(const XGA_SpanCmd &s, Bits x, Bits y, Bits dx, Bitu count) {
+	const Bits first = XGA_PixelIndex(x, y);
+	const Bits last = first + dx * (Bits)(count - 1);
+
+	if (first < 0 || first >= s.limit || last < 0 || last >= s.limit) return NULL;
+	return vga.mem.linear + ((Bitu)first << s.size);
+}
+
+/* the span kernels write video memory directly, tell the dirty map (see XGA_DrawPoint) */
+static void XGA_SpanDirty(HostPt lo, Bitu bytes) {
+	const Bitu ofs = (Bitu)(lo - vga.mem.linear);
+	for (Bitu page = ofs >> 12; page <= ((ofs + bytes - 1) >> 12); page++)
+		VGA_MarkPageDirty(page);
+}
+
 void XGA_DrawLineVector(Bitu val) {
 	Bits xat, yat;
 	Bitu srcval;
@@ -459,13 +630,79 @@ void XGA_DrawLineBresenham(Bitu val) {
 	
 }
 
-void XGA_DrawRectangle(Bitu val) {
-	Bit32u xat, yat;
+static void XGA_DrawRectangleRow(Bits srcx, Bits srcy, Bits dx) {
+	Bit32u xat;
 	Bitu srcval;
 	Bitu destval;
 	Bitu dstdata;
 
-	Bits srcx, srcy, dx, dy;
+	for(xat=0;xat<=xga.MAPcount;xat++) {
+		Bitu mixmode = (xga.pix_cntl >> 6) & 0x3;
+		switch (mixmode) {
+			case 0x00: /* FOREMIX always used */
+				mixmode = xga.foremix;
+				switch((mixmode >> 5) & 0x03) {
+					case 0x00: /* Src is background color */
+						srcval = xga.backcolor;
+						break;
+					case 0x01: /* Src is foreground color */
+						srcval = xga.forecolor;
+						break;
+					case 0x02: /* Src is pixel data from PIX_TRANS register */
+						//srcval = tmpval;
+						LOG_MSG("XGA: DrawRect: Wants data from PIX_TRANS register");
+						srcval = 0;
+						break;
+					case 0x03: /* Src is bitmap data */
+						LOG_MSG("XGA: DrawRect: Wants data from srcdata");
+						//srcval = srcdata;
+						srcval = 0;
+						break;
+					default:
+						LOG_MSG("XGA: DrawRect: Shouldn't be able to get here!");
+						srcval = 0;
+						break;
+				}
+				dstdata = XGA_GetPoint(srcx,srcy);
+
+				destval = XGA_GetMixResult(mixmode, srcval, dstdata);
+
+				XGA_DrawPoint(srcx,srcy, destval);
+				break;
+			default: 
+				LOG_MSG("XGA: DrawRect: Needs mixmode %x", (int)mixmode);
+				break;
+		}
+		srcx += dx;
+	}
+}
+
+static bool XGA_DrawRectangleSpan(const XGA_SpanCmd &s, Bits x, Bits y, Bits dx, Bitu mixmode, Bitu srcval) {
+	XGA_SpanArgs a;
+	Bitu first, count;
+
+	if (!s.enabled || !XGA_ClipRow(x, y, dx, first, count)) return true;
+
+	/* every pixel only mixes with itself, so the row can always run upwards */
+	x += dx * (Bits)first;
+	if (dx < 0) x -= (Bits)count - 1;
+	a.dst = XGA_SpanPtr(s, x, y, 1, count);
+	if (a.dst == NULL) return false;
+	a.src = NULL;
+	a.count = count;
+	a.srcval = srcval;
+	a.pattern = NULL;
+	a.patx = 0;
+	a.mask = s.mask;
+	XGA_SpanDirty(a.dst, count << s.size);
+	xga_mix_kernels[s.size][XGA_SRC_CONST][mixmode & 0xf](a);
+	return true;
+}
+
+void XGA_DrawRectangle(Bitu val) {
+	Bit32u yat;
+	Bits srcy, dx, dy;
+	XGA_SpanCmd span;
 
 	dx = -1;
 	dy = -1;
@@ -473,53 +710,21 @@ void XGA_DrawRectangle(Bitu val) {
 	if(((val >> 5) & 0x01) != 0) dx = 1;
 	if(((val >> 7) & 0x01) != 0) dy = 1;
 
+	/* PIX_TRANS and bitmap sources and the other mix selects only log per pixel */
+	Bitu mixmode = xga.foremix;
+	bool fast = XGA_SpanSetup(span) && ((xga.pix_cntl >> 6) & 0x3) == 0 &&
+		((mixmode >> 5) & 0x03) < 2;
+	Bitu srcval = ((mixmode >> 5) & 0x03) ? xga.forecolor : xga.backcolor;
+
 	srcy = xga.cury;
 
 	for(yat=0;yat<=xga.MIPcount;yat++) {
-		srcx = xga.curx;
-		for(xat=0;xat<=xga.MAPcount;xat++) {
-			Bitu mixmode = (xga.pix_cntl >> 6) & 0x3;
-			switch (mixmode) {
-				case 0x00: /* FOREMIX always used */
-					mixmode = xga.foremix;
-					switch((mixmode >> 5) & 0x03) {
-						case 0x00: /* Src is background color */
-							srcval = xga.backcolor;
-							break;
-						case 0x01: /* Src is foreground color */
-							srcval = xga.forecolor;
-							break;
-						case 0x02: /* Src is pixel data from PIX_TRANS register */
-							//srcval = tmpval;
-							LOG_MSG("XGA: DrawRect: Wants data from PIX_TRANS register");
-							srcval = 0;
-							break;
-						case 0x03: /* Src is bitmap data */
-							LOG_MSG("XGA: DrawRect: Wants data from srcdata");
-							//srcval = srcdata;
-							srcval = 0;
-							break;
-						default:
-							LOG_MSG("XGA: DrawRect: Shouldn't be able to get here!");
-							srcval = 0;
-							break;
-					}
-					dstdata = XGA_GetPoint(srcx,srcy);
-
-					destval = XGA_GetMixResult(mixmode, srcval, dstdata);
-
-					XGA_DrawPoint(srcx,srcy, destval);
-					break;
-				default: 
-					LOG_MSG("XGA: DrawRect: Needs mixmode %x", (int)mixmode);
-					break;
-			}
-			srcx += dx;
-		}
+		if (!fast || !XGA_DrawRectangleSpan(span, xga.curx, srcy, dx, mixmode, srcval))
+			XGA_DrawRectangleRow(xga.curx, srcy, dx);
 		srcy += dy;
 	}
-	xga.curx = srcx;
-	xga.cury = srcy;
+	xga.curx = (Bit16u)(xga.curx + dx * ((Bits)xga.MAPcount + 1));
+	xga.cury = (Bit16u)srcy;
 
 	//LOG_MSG("XGA: Draw rect (%d, %d)-(%d, %d), %d", x1, y1, x2, y2, xga.forecolor);
 }
@@ -730,15 +935,131 @@ void XGA_DrawWait(Bitu val, Bitu len) {
 	}
 }
 
-void XGA_BlitRect(Bitu val) {
-	Bit32u xat, yat;
+static void XGA_BlitRectRow(Bits srcx, Bits srcy, Bits tarx, Bits tary, Bits dx, Bitu mixselect, Bitu mixmode) {
+	Bit32u xat;
 	Bitu srcdata;
 	Bitu dstdata;
 
 	Bitu srcval;
 	Bitu destval;
 
-	Bits srcx, srcy, tarx, tary, dx, dy;
+	for(xat=0;xat<=xga.MAPcount;xat++) {
+		srcdata = XGA_GetPoint(srcx, srcy);
+		dstdata = XGA_GetPoint(tarx, tary);
+
+		if(mixselect == 0x3) {
+			if(srcdata == xga.forecolor) {
+				mixmode = xga.foremix;
+			} else {
+				if(srcdata == xga.backcolor) {
+					mixmode = xga.backmix;
+				} else {
+					/* Best guess otherwise */
+					mixmode = 0x67; /* Source is bitmap data, mix mode is src */
+				}
+			}
+		}
+
+		switch((mixmode >> 5) & 0x03) {
+			case 0x00: /* Src is background color */
+				srcval = xga.backcolor;
+				break;
+			case 0x01: /* Src is foreground color */
+				srcval = xga.forecolor;
+				break;
+			case 0x02: /* Src is pixel data from PIX_TRANS register */
+				LOG_MSG("XGA: DrawPattern: Wants data from PIX_TRANS register");
+				srcval = 0;
+				break;
+			case 0x03: /* Src is bitmap data */
+				srcval = srcdata;
+				break;
+			default:
+				LOG_MSG("XGA: DrawPattern: Shouldn't be able to get here!");
+				srcval = 0;
+				break;
+		}
+
+		destval = XGA_GetMixResult(mixmode, srcval, dstdata);
+		//LOG_MSG("XGA: DrawPattern: Mixmode: %x Mixselect: %x", mixmode, mixselect);
+
+		XGA_DrawPoint(tarx, tary, destval);
+
+		srcx += dx;
+		tarx += dx;
+	}
+}
+
+static bool XGA_BlitRectSpan(const XGA_SpanCmd &s, Bits srcx, Bits srcy, Bits tarx, Bits tary, Bits dx,
+	Bitu mixselect, Bitu mixmode) {
+	XGA_SpanArgs a;
+	Bitu first, count;
+
+	if (!s.enabled || !XGA_ClipRow(tarx, tary, dx, first, count)) return true;
+
+	a.count = count;
+	a.pattern = NULL;
+	a.patx = 0;
+	a.mask = s.mask;
+
+	if (mixselect != 0x3 && ((mixmode >> 5) & 0x03) != 0x03) {
+		/* plain fill, the source rectangle isn't read */
+		tarx += dx * (Bits)first;
+		if (dx < 0) tarx -= (Bits)count - 1;
+		a.dst = XGA_SpanPtr(s, tarx, tary, 1, count);
+		if (a.dst == NULL) return false;
+		a.src = NULL;
+		a.srcval = ((mixmode >> 5) & 0x03) ? xga.forecolor : xga.backcolor;
+		XGA_SpanDirty(a.dst, count << s.size);
+		xga_mix_kernels[s.size][XGA_SRC_CONST][mixmode & 0xf](a);
+		return true;
+	}
+
+	srcx += dx * (Bits)first;
+	tarx += dx * (Bits)first;
+	a.dst = XGA_SpanPtr(s, tarx, tary, dx, count);
+	a.src = XGA_SpanPtr(s, srcx, srcy, dx, count);
+	if (a.dst == NULL || a.src == NULL) return false;
+	a.srcval = 0;
+
+	/* lowest addresses of both rows */
+	const Bitu bytes = count << s.size;
+	HostPt dst_lo = a.dst;
+	HostPt src_lo = a.src;
+	if (dx < 0) {
+		dst_lo -= bytes - ((Bitu)1 << s.size);
+		src_lo -= bytes - ((Bitu)1 << s.size);
+	}
+	const bool overlap = dst_lo < src_lo + bytes && src_lo < dst_lo + bytes;
+	XGA_SpanDirty(dst_lo, bytes);
+
+	/* a pixel may read what an earlier pixel of the same row wrote, so an
+	   overlapping row going downwards has to be mixed downwards as well */
+	unsigned int srcmode = XGA_SRC_SPAN;
+	if (overlap && dx < 0) {
+		srcmode = XGA_SRC_SPAN_BACK;
+	} else {
+		a.dst = dst_lo;
+		a.src = src_lo;
+	}
+
+	if (mixselect == 0x3) {
+		xga_select_kernels[s.size][srcmode](a);
+	} else if ((mixmode & 0xf) == 0x07 && !s.masked &&
+		(!overlap || (dx > 0 && dst_lo <= src_lo) || (dx < 0 && dst_lo >= src_lo))) {
+		/* straight copy that doesn't run into its own output */
+		memmove(dst_lo, src_lo, bytes);
+	} else {
+		xga_mix_kernels[s.size][srcmode][mixmode & 0xf](a);
+	}
+	return true;
+}
+
+void XGA_BlitRect(Bitu val) {
+	Bit32u yat;
+
+	Bits srcy, tary, dx, dy;
+	XGA_SpanCmd span;
 
 	dx = -1;
 	dy = -1;
@@ -746,9 +1067,7 @@ void XGA_BlitRect(Bitu val) {
 	if(((val >> 5) & 0x01) != 0) dx = 1;
 	if(((val >> 7) & 0x01) != 0) dy = 1;
 
-	srcx = xga.curx;
 	srcy = xga.cury;
-	tarx = xga.destx;
 	tary = xga.desty;
 
 	Bitu mixselect = (xga.pix_cntl >> 6) & 0x3;
@@ -768,70 +1087,124 @@ void XGA_BlitRect(Bitu val) {
 			break;
 	}
 
+	/* PIX_TRANS as source only logs per pixel */
+	bool fast = XGA_SpanSetup(span);
+	if (mixselect == 0x3) {
+		if (((xga.foremix >> 5) & 0x03) == 0x02 || ((xga.backmix >> 5) & 0x03) == 0x02) fast = false;
+	} else {
+		if (((mixmode >> 5) & 0x03) == 0x02) fast = false;
+	}
 
 	/* Copy source to video ram */
 	for(yat=0;yat<=xga.MIPcount ;yat++) {
-		srcx = xga.curx;
-		tarx = xga.destx;
+		if (!fast || !XGA_BlitRectSpan(span, xga.curx, srcy, xga.destx, tary, dx, mixselect, mixmode))
+			XGA_BlitRectRow(xga.curx, srcy, xga.destx, tary, dx, mixselect, mixmode);
+		srcy += dy;
+		tary += dy;
+	}
+}
 
-		for(xat=0;xat<=xga.MAPcount;xat++) {
-			srcdata = XGA_GetPoint(srcx, srcy);
-			dstdata = XGA_GetPoint(tarx, tary);
+static void XGA_DrawPatternRow(Bits srcx, Bits srcy, Bits tarx, Bits tary, Bits dx, Bitu mixselect, Bitu mixmode) {
+	Bits xat;
+	Bitu srcdata;
+	Bitu dstdata;
 
-			if(mixselect == 0x3) {
-				if(srcdata == xga.forecolor) {
-					mixmode = xga.foremix;
-				} else {
-					if(srcdata == xga.backcolor) {
-						mixmode = xga.backmix;
-					} else {
-						/* Best guess otherwise */
-						mixmode = 0x67; /* Source is bitmap data, mix mode is src */
-					}
-				}
-			}
+	Bitu srcval;
+	Bitu destval;
 
-			switch((mixmode >> 5) & 0x03) {
-				case 0x00: /* Src is background color */
-					srcval = xga.backcolor;
-					break;
-				case 0x01: /* Src is foreground color */
-					srcval = xga.forecolor;
-					break;
-				case 0x02: /* Src is pixel data from PIX_TRANS register */
-					LOG_MSG("XGA: DrawPattern: Wants data from PIX_TRANS register");
-					srcval = 0;
-					break;
-				case 0x03: /* Src is bitmap data */
-					srcval = srcdata;
-					break;
-				default:
-					LOG_MSG("XGA: DrawPattern: Shouldn't be able to get here!");
-					srcval = 0;
-					break;
-			}
+	for(xat=0;xat<=xga.MAPcount;xat++) {
 
-			destval = XGA_GetMixResult(mixmode, srcval, dstdata);
-			//LOG_MSG("XGA: DrawPattern: Mixmode: %x Mixselect: %x", mixmode, mixselect);
+		srcdata = XGA_GetPoint(srcx + (tarx & 0x7), srcy + (tary & 0x7));
+		//LOG_MSG("patternpoint (%3d/%3d)v%x",srcx + (tarx & 0x7), srcy + (tary & 0x7),srcdata);
+		dstdata = XGA_GetPoint(tarx, tary);
+		
 
-			XGA_DrawPoint(tarx, tary, destval);
+		if(mixselect == 0x3) {
+			// TODO lots of guessing here but best results this way
+			/*if(srcdata == xga.forecolor)*/ mixmode = xga.foremix;
+			// else 
+			if(srcdata == xga.backcolor || srcdata == 0) 
+				mixmode = xga.backmix;
+		}
 
-			srcx += dx;
-			tarx += dx;
+		switch((mixmode >> 5) & 0x03) {
+			case 0x00: /* Src is background color */
+				srcval = xga.backcolor;
+				break;
+			case 0x01: /* Src is foreground color */
+				srcval = xga.forecolor;
+				break;
+			case 0x02: /* Src is pixel data from PIX_TRANS register */
+				LOG_MSG("XGA: DrawPattern: Wants data from PIX_TRANS register");
+				srcval = 0;
+				break;
+			case 0x03: /* Src is bitmap data */
+				srcval = srcdata;
+				break;
+			default:
+				LOG_MSG("XGA: DrawPattern: Shouldn't be able to get here!");
+				srcval = 0;
+				break;
 		}
-		srcy += dy;
-		tary += dy;
+
+		destval = XGA_GetMixResult(mixmode, srcval, dstdata);
+
+		XGA_DrawPoint(tarx, tary, destval);
+		
+		tarx += dx;
 	}
 }
 
-void XGA_DrawPattern(Bitu val) {
-	Bitu srcdata;
-	Bitu dstdata;
+static bool XGA_DrawPatternSpan(const XGA_SpanCmd &s, Bits srcx, Bits srcy, Bits tarx, Bits tary, Bits dx,
+	Bitu mixselect, Bitu mixmode) {
+	XGA_SpanArgs a;
+	Bitu pattern[8];
+	Bitu first, count;
+
+	if (!s.enabled || !XGA_ClipRow(tarx, tary, dx, first, count)) return true;
+
+	/* every pixel only mixes with itself, so the row can always run upwards */
+	tarx += dx * (Bits)first;
+	if (dx < 0) tarx -= (Bits)count - 1;
+	a.dst = XGA_SpanPtr(s, tarx, tary, 1, count);
+	if (a.dst == NULL) return false;
+	a.src = NULL;
+	a.count = count;
+	a.mask = s.mask;
+
+	if (mixselect != 0x3 && ((mixmode >> 5) & 0x03) != 0x03) {
+		a.srcval = ((mixmode >> 5) & 0x03) ? xga.forecolor : xga.backcolor;
+		a.pattern = NULL;
+		a.patx = 0;
+		XGA_SpanDirty(a.dst, count << s.size);
+		xga_mix_kernels[s.size][XGA_SRC_CONST][mixmode & 0xf](a);
+		return true;
+	}
 
-	Bitu srcval;
-	Bitu destval;
+	/* the pattern row is read up front, which is only the same if this row doesn't draw over it */
+	const Bits pat_y = srcy + (tary & 0x7);
+	const Bits pat_lo = XGA_PixelIndex(srcx, pat_y);
+	const Bits dst_lo = XGA_PixelIndex(tarx, tary);
+	if (XGA_SpanPtr(s, srcx, pat_y, 1, 8) == NULL) return false;
+	if (pat_lo < dst_lo + (Bits)count && dst_lo < pat_lo + 8) return false;
+
+	for (Bitu k = 0; k < 8; k++)
+		pattern[k] = XGA_GetPoint(srcx + k, pat_y);
+
+	a.srcval = 0;
+	a.pattern = pattern;
+	a.patx = tarx;
+	XGA_SpanDirty(a.dst, count << s.size);
+	if (mixselect == 0x3)
+		xga_select_kernels[s.size][XGA_SRC_PATTERN](a);
+	else
+		xga_mix_kernels[s.size][XGA_SRC_PATTERN][mixmode & 0xf](a);
+	return true;
+}
 
-	Bits xat, yat, srcx, srcy, tarx, tary, dx, dy;
+void XGA_DrawPattern(Bitu val) {
+	Bits yat, srcx, srcy, tary, dx, dy;
+	XGA_SpanCmd span;
 
 	dx = -1;
 	dy = -1;
@@ -861,49 +1234,17 @@ void XGA_DrawPattern(Bitu val) {
 			break;
 	}
 
-	for(yat=0;yat<=xga.MIPcount;yat++) {
-		tarx = xga.destx;
-		for(xat=0;xat<=xga.MAPcount;xat++) {
-
-			srcdata = XGA_GetPoint(srcx + (tarx & 0x7), srcy + (tary & 0x7));
-			//LOG_MSG("patternpoint (%3d/%3d)v%x",srcx + (tarx & 0x7), srcy + (tary & 0x7),srcdata);
-			dstdata = XGA_GetPoint(tarx, tary);
-			
-
-			if(mixselect == 0x3) {
-				// TODO lots of guessing here but best results this way
-				/*if(srcdata == xga.forecolor)*/ mixmode = xga.foremix;
-				// else 
-				if(srcdata == xga.backcolor || srcdata == 0) 
-					mixmode = xga.backmix;
-			}
-
-			switch((mixmode >> 5) & 0x03) {
-				case 0x00: /* Src is background color */
-					srcval = xga.backcolor;
-					break;
-				case 0x01: /* Src is foreground color */
-					srcval = xga.forecolor;
-					break;
-				case 0x02: /* Src is pixel data from PIX_TRANS register */
-					LOG_MSG("XGA: DrawPattern: Wants data from PIX_TRANS register");
-					srcval = 0;
-					break;
-				case 0x03: /* Src is bitmap data */
-					srcval = srcdata;
-					break;
-				default:
-					LOG_MSG("XGA: DrawPattern: Shouldn't be able to get here!");
-					srcval = 0;
-					break;
-			}
-
-			destval = XGA_GetMixResult(mixmode, srcval, dstdata);
+	/* PIX_TRANS as source only logs per pixel */
+	bool fast = XGA_SpanSetup(span);
+	if (mixselect == 0x3) {
+		if (((xga.foremix >> 5) & 0x03) == 0x02 || ((xga.backmix >> 5) & 0x03) == 0x02) fast = false;
+	} else {
+		if (((mixmode >> 5) & 0x03) == 0x02) fast = false;
+	}
 
-			XGA_DrawPoint(tarx, tary, destval);
-			
-			tarx += dx;
-		}
+	for(yat=0;yat<=xga.MIPcount;yat++) {
+		if (!fast || !XGA_DrawPatternSpan(span, srcx, srcy, xga.destx, tary, dx, mixselect, mixmode))
+			XGA_DrawPatternRow(srcx, srcy, xga.destx, tary, dx, mixselect, mixmode);
 		tary += dy;
 	}
 }
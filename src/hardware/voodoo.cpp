@@ -28,6 +28,7 @@
 
 #include "paging.h"
 #include "mem.h"
+#include "lazyinit.h"
 
 #include "voodoo.h"
 #include "pci_bus.h"
@@ -39,6 +40,11 @@ static VOODOO* voodoo_dev;
 static Bit32u voodoo_current_lfb=(VOODOO_INITIAL_LFB&0xffff0000);
 
 static bool voodoo_pci_enabled = false;
+
+/* the card state (tables, 12MB of frame buffer and texture memory) is only set
+ * up once the guest actually touches the card, which most sessions never do */
+static void VOODOO_DeferredInit(void);
+static LazyInit voodoo_lazy("Voodoo",VOODOO_DeferredInit);
 static MEM_Callout_t voodoo_lfb_cb = MEM_Callout_t_none;
 
 PageHandler* voodoo_lfb_memio_cb(MEM_CalloutObject &co,Bitu phys_page) {
@@ -84,6 +90,8 @@ void voodoo_lfb_cb_init() {
 class VOODOO:public Module_base{
 private:
 	Bits emulation_type;
+	Bits card_type;
+	bool max_voodoomem;
 public:
 	VOODOO(Section* configuration):Module_base(configuration){
 		emulation_type=-1;
@@ -105,15 +113,14 @@ public:
 			emulation_type=0;
 		}
 
-		Bits card_type = 1;
-		bool max_voodoomem = true;
+		card_type = 1;
+		max_voodoomem = true;
 
 		bool needs_pci_device = false;
 
 		switch (emulation_type) {
 			case 1:
 			case 2:
-				Voodoo_Initialize(emulation_type, card_type, max_voodoomem);
 				needs_pci_device = true;
 				break;
 			default:
@@ -131,19 +138,32 @@ public:
 		switch (emulation_type) {
 			case 1:
 			case 2:
-				Voodoo_Shut_Down();
+				if (voodoo_lazy.IsDone()) Voodoo_Shut_Down();
 				break;
 			default:
 				break;
 		}
+		voodoo_lazy.Reset();
 
 		emulation_type=-1;
 	}
 
+	void Initialize() {
+		switch (emulation_type) {
+			case 1:
+			case 2:
+				Voodoo_Initialize(emulation_type, card_type, max_voodoomem);
+				break;
+			default:
+				break;
+		}
+	}
+
 	void PCI_InitEnable(Bitu val) {
 		switch (emulation_type) {
 			case 1:
 			case 2:
+				voodoo_lazy.Ensure();
 				Voodoo_PCI_InitEnable(val);
 				break;
 			default:
@@ -155,6 +175,7 @@ public:
 		switch (emulation_type) {
 			case 1:
 			case 2:
+				voodoo_lazy.Ensure();
 				Voodoo_PCI_Enable(enable);
 				break;
 			default:
@@ -166,6 +187,7 @@ public:
 		switch (emulation_type) {
 			case 1:
 			case 2:
+				voodoo_lazy.Ensure();
 				return Voodoo_GetPageHandler();
 			default:
 				break;
@@ -175,6 +197,11 @@ public:
 
 };
 
+static void VOODOO_DeferredInit(void) {
+	if (voodoo_dev!=NULL) {
+		voodoo_dev->Initialize();
+	}
+}
 
 void VOODOO_PCI_InitEnable(Bitu val) {
 	if (voodoo_dev!=NULL) {
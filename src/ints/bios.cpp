@@ -3014,6 +3014,10 @@ static Bitu INT18_PC98_Handler(void) {
                     vga.mem.linear[i+0] = reg_dh;
                     vga.mem.linear[i+1] = 0x00;
                 }
+                VGA_MarkPageDirty(0);
+                VGA_MarkPageDirty(1);
+                VGA_MarkPageDirty(2);
+                VGA_MarkPageDirty(3);
             }
             break;
         case 0x17: /* BELL ON */
@@ -16,6 +16,7 @@
  *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <typeinfo>
 #include "dosbox.h"
 #include "callback.h"
 #include "bios.h"
@@ -266,6 +267,22 @@ Bit8u imageDisk::Read_AbsoluteSector(Bit32u sectnum, void * data) {
 	return 0x00;
 }
 
+/* For a plain image, where in which host file the sectors are, so that they can
+ * be read without going through this object (see the IDE read-ahead). Anything
+ * derived from imageDisk stores its sectors differently and returns false. */
+bool imageDisk::Get_RawImage(FILE **imgFile, Bit64u *imgBase, Bit64u *imgLength) {
+	if (typeid(*this) != typeid(imageDisk) || diskimg == NULL)
+		return false;
+
+	/* the caller reads past stdio, so pending writes have to be in the file */
+	fflush(diskimg);
+
+	*imgFile = diskimg;
+	*imgBase = image_base;
+	*imgLength = image_length;
+	return true;
+}
+
 Bit8u imageDisk::Write_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data,unsigned int req_sector_size) {
 	Bit32u sectnum;
 
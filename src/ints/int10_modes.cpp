@@ -27,6 +27,7 @@
 #include "vga.h"
 #include "bios.h"
 #include "programs.h"
+#include "hostmem.h"
 
 #define SEQ_REGS 0x05
 #define GFX_REGS 0x09
@@ -692,7 +693,8 @@ static void FinishSetMode(bool clearmem) {
 		case M_LIN24:
 		case M_LIN32:
 			/* Hack we just access the memory directly */
-			memset(vga.mem.linear,0,vga.vmemsize);
+			HostMem_Zero(vga.mem.linear,vga.vmemsize);
+			VGA_MarkAllPagesDirty();
 			break;
 		default:
 			break;
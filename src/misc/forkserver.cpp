@@ -0,0 +1,186 @@
+/*
+ *  Copyright (C) 2002-2015  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Fork server.
+ *
+ * With -forkserver <socket> DOSBox-X boots as usual and runs AUTOEXEC, but when
+ * the shell first waits for input it listens on a Unix domain socket instead.
+ * Every connection gets a fork() of the machine as it is at that point: guest
+ * RAM and the rest of the emulator state are shared copy-on-write, and the
+ * clone starts without going through config parsing, POST and DOS startup.
+ * Whatever AUTOEXEC sets up is the checkpoint the clones start from.
+ *
+ * A request is a list of shell commands, one per line, ended by an empty line
+ * or by shutting down the write side of the connection, for example
+ *     MOUNT D /tmp/run42
+ *     D:\TEST.EXE
+ * The clone runs them at the prompt and exits. Its stdout and stderr, which
+ * include the DOS console output (as with -log-con), go back over the
+ * connection, so the client reads until EOF.
+ *
+ * Only the state of the process is cloned. SDL video and audio do not survive
+ * a fork(), so the server is meant to run headless (SDL_VIDEODRIVER=dummy,
+ * nosound=true). SIGTERM or SIGINT stops the server and shuts it down normally. */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "dosbox.h"
+#include "control.h"
+#include "support.h"
+
+static std::vector<std::string> forkserver_commands;
+static size_t forkserver_next = 0;
+static bool forkserver_done = false;
+
+#if !defined(WIN32) && defined(HAVE_SYS_SOCKET_H)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+
+extern bool log_dev_con;
+
+static volatile sig_atomic_t forkserver_quit = 0;
+
+static void FORKSERVER_SignalQuit(int sig) {
+	(void)sig;//UNUSED
+	forkserver_quit = 1;
+}
+
+static void FORKSERVER_ReadRequest(int fd) {
+	std::string line;
+	char buf[512];
+	ssize_t len;
+
+	while ((len = read(fd,buf,sizeof(buf))) > 0) {
+		for (ssize_t i=0;i < len;i++) {
+			if (buf[i] == '\r') continue;
+			if (buf[i] != '\n') {
+				line += buf[i];
+				continue;
+			}
+			if (line.empty()) return;
+			forkserver_commands.push_back(line);
+			line.clear();
+		}
+	}
+	if (!line.empty()) forkserver_commands.push_back(line);
+}
+
+/* returns true in a clone, false when the server stops */
+static bool FORKSERVER_Serve(int sock) {
+	struct sigaction sa;
+	memset(&sa,0,sizeof(sa));
+	sa.sa_handler = FORKSERVER_SignalQuit;	/* no SA_RESTART, accept() has to return */
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGTERM,&sa,NULL);
+	sigaction(SIGINT,&sa,NULL);
+	signal(SIGCHLD,SIG_IGN);				/* clones are never waited for */
+
+	while (!forkserver_quit) {
+		int conn = accept(sock,NULL,NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			LOG_MSG("Fork server: accept() failed: %s",strerror(errno));
+			break;
+		}
+
+		fflush(NULL);
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(sock);
+			signal(SIGTERM,SIG_DFL);
+			signal(SIGINT,SIG_DFL);
+			signal(SIGCHLD,SIG_DFL);
+
+			FORKSERVER_ReadRequest(conn);
+			dup2(conn,STDOUT_FILENO);
+			dup2(conn,STDERR_FILENO);
+			close(conn);
+			log_dev_con = true;
+			return true;
+		}
+		if (pid < 0) LOG_MSG("Fork server: fork() failed: %s",strerror(errno));
+		close(conn);
+	}
+	return false;
+}
+
+static void FORKSERVER_Checkpoint(void) {
+	if (forkserver_done) return;
+	forkserver_done = true;
+
+	const std::string &path = control->opt_forkserver;
+	if (path.empty()) return;
+
+	struct sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		LOG_MSG("Fork server: socket path %s is too long",path.c_str());
+		return;
+	}
+	strcpy(addr.sun_path,path.c_str());
+
+	int sock = socket(AF_UNIX,SOCK_STREAM,0);
+	if (sock < 0) {
+		LOG_MSG("Fork server: socket() failed: %s",strerror(errno));
+		return;
+	}
+	unlink(path.c_str());
+	if (bind(sock,(struct sockaddr*)&addr,sizeof(addr)) != 0 || listen(sock,64) != 0) {
+		LOG_MSG("Fork server: cannot listen on %s: %s",path.c_str(),strerror(errno));
+		close(sock);
+		return;
+	}
+	chmod(path.c_str(),0600);
+
+	LOG_MSG("Fork server: machine ready, serving clones on %s",path.c_str());
+	if (!FORKSERVER_Serve(sock)) {
+		LOG_MSG("Fork server: shutting down");
+		close(sock);
+		unlink(path.c_str());
+		forkserver_commands.clear();
+	}
+
+	/* a clone exits after its request, the server exits when it stops */
+	forkserver_commands.push_back("EXIT");
+}
+#else
+static void FORKSERVER_Checkpoint(void) {
+	if (forkserver_done) return;
+	forkserver_done = true;
+
+	if (!control->opt_forkserver.empty())
+		LOG_MSG("Fork server: not supported on this platform");
+}
+#endif
+
+/* called by the first shell whenever it is about to prompt. the first call is
+ * the checkpoint, after that it hands out the commands of the request. */
+bool FORKSERVER_GetCommand(char *line,size_t size) {
+	FORKSERVER_Checkpoint();
+	if (forkserver_next >= forkserver_commands.size()) return false;
+	safe_strncpy(line,forkserver_commands[forkserver_next++].c_str(),size);
+	return true;
+}
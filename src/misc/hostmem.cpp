@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2002-2015  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Host memory for guest RAM and video memory.
+ *
+ * The buffers are mapped from the host instead of taken from the heap. Mapped
+ * memory is zero until written, so nothing has to be cleared at startup and
+ * the pages the guest never uses (most of a 64MB machine running DOS games)
+ * never become resident. HostMem_Zero() hands whole pages back instead of
+ * writing zeros over them. On Linux the mappings are 2MB aligned and marked
+ * for transparent huge pages, which takes pressure off the host TLB when the
+ * emulated CPU walks all over guest memory.
+ *
+ * With -forkserver every clone shares these pages copy-on-write with the
+ * server, ROM and untouched RAM included, until it writes to them. */
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include "dosbox.h"
+#include "control.h"
+#include "setup.h"
+#include "hostmem.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#define HOSTMEM_MAPPED 1
+#elif (C_HAVE_MPROTECT)
+#include <sys/mman.h>
+#include <unistd.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#if defined(MAP_ANONYMOUS)
+#define HOSTMEM_MAPPED 1
+#endif
+#endif
+
+/* clearing less than this is cheaper to do with memset() */
+#define HOSTMEM_ZERO_MIN	(256*1024)
+#define HOSTMEM_HUGEPAGE	(2*1024*1024)
+
+struct HostMemRegion {
+	HostPt base;
+	size_t size;
+	bool mapped;			/* false: new[] fallback */
+};
+
+static std::vector<HostMemRegion> hostmem_regions;
+
+#if defined(HOSTMEM_MAPPED)
+static size_t HostMem_PageSize(void) {
+#if !defined(WIN32) && defined(_SC_PAGESIZE)
+	long sz = sysconf(_SC_PAGESIZE);
+	if (sz > 0) return (size_t)sz;
+#endif
+	return 4096;
+}
+
+#if defined(MADV_HUGEPAGE)
+static bool HostMem_WantHugePages(void) {
+	if (control == NULL) return false;
+	Section_prop *section = static_cast<Section_prop *>(control->GetSection("dosbox"));
+	if (section == NULL) return false;
+	return section->Get_bool("host huge pages");
+}
+#endif
+
+static HostPt HostMem_Map(size_t size) {
+#if defined(WIN32)
+	return (HostPt)VirtualAlloc(NULL,size,MEM_RESERVE|MEM_COMMIT,PAGE_READWRITE);
+#else
+	bool huge = false;
+#if defined(MADV_HUGEPAGE)
+	huge = (size >= HOSTMEM_HUGEPAGE) && HostMem_WantHugePages();
+#endif
+	/* huge pages only back 2MB aligned ranges, map more and trim the ends */
+	size_t maplen = huge ? (size + HOSTMEM_HUGEPAGE) : size;
+	void *p = mmap(NULL,maplen,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	if (p == MAP_FAILED) return NULL;
+
+	HostPt base = (HostPt)p;
+	if (huge) {
+		HostPt aligned = (HostPt)(((uintptr_t)base + HOSTMEM_HUGEPAGE - 1) & ~(uintptr_t)(HOSTMEM_HUGEPAGE - 1));
+		size_t head = (size_t)(aligned - base);
+		size_t tail = maplen - head - size;
+		if (head != 0) munmap(base,head);
+		if (tail != 0) munmap(aligned + size,tail);
+		base = aligned;
+#if defined(MADV_HUGEPAGE)
+		if (madvise(base,size,MADV_HUGEPAGE) != 0)
+			LOG(LOG_MISC,LOG_DEBUG)("Host memory: transparent huge pages not available");
+#endif
+	}
+	return base;
+#endif
+}
+
+static void HostMem_Unmap(HostPt ptr,size_t size) {
+#if defined(WIN32)
+	(void)size;//UNUSED
+	VirtualFree(ptr,0,MEM_RELEASE);
+#else
+	munmap(ptr,size);
+#endif
+}
+
+/* make the pages read as zero again and drop them from the resident set */
+static bool HostMem_Discard(HostPt ptr,size_t size) {
+#if defined(WIN32)
+	return VirtualFree(ptr,size,MEM_DECOMMIT) && VirtualAlloc(ptr,size,MEM_COMMIT,PAGE_READWRITE) != NULL;
+#elif defined(MADV_DONTNEED) && defined(__linux__)
+	/* private anonymous memory reads back as zero after MADV_DONTNEED on Linux,
+	 * other systems are allowed to keep the contents */
+	return madvise(ptr,size,MADV_DONTNEED) == 0;
+#else
+	(void)ptr;//UNUSED
+	(void)size;//UNUSED
+	return false;
+#endif
+}
+#endif
+
+HostPt HostMem_Alloc(size_t size) {
+	HostMemRegion r;
+
+	r.base = NULL;
+	r.size = size;
+	r.mapped = false;
+#if defined(HOSTMEM_MAPPED)
+	r.base = HostMem_Map(size);
+	r.mapped = (r.base != NULL);
+#endif
+	if (r.base == NULL) {
+		r.base = new Bit8u[size];
+		memset(r.base,0,size);
+	}
+
+	hostmem_regions.push_back(r);
+	return r.base;
+}
+
+void HostMem_Free(HostPt ptr) {
+	if (ptr == NULL) return;
+
+	for (size_t i=0;i < hostmem_regions.size();i++) {
+		HostMemRegion &r = hostmem_regions[i];
+		if (r.base != ptr) continue;
+
+#if defined(HOSTMEM_MAPPED)
+		if (r.mapped) HostMem_Unmap(r.base,r.size);
+		else
+#endif
+			delete[] r.base;
+		hostmem_regions.erase(hostmem_regions.begin()+(std::vector<HostMemRegion>::difference_type)i);
+		return;
+	}
+	E_Exit("HostMem_Free: %p was not allocated with HostMem_Alloc",(void*)ptr);
+}
+
+void HostMem_Zero(HostPt ptr,size_t size) {
+#if defined(HOSTMEM_MAPPED)
+	if (size >= HOSTMEM_ZERO_MIN) {
+		for (size_t i=0;i < hostmem_regions.size();i++) {
+			const HostMemRegion &r = hostmem_regions[i];
+			if (!r.mapped || ptr < r.base || (ptr+size) > (r.base+r.size)) continue;
+
+			size_t page = HostMem_PageSize();
+			HostPt start = (HostPt)(((uintptr_t)ptr + page - 1) & ~(uintptr_t)(page - 1));
+			HostPt end = (HostPt)(((uintptr_t)ptr + size) & ~(uintptr_t)(page - 1));
+			if (!HostMem_Discard(start,(size_t)(end - start))) break;
+
+			memset(ptr,0,(size_t)(start - ptr));
+			memset(end,0,(size_t)((ptr + size) - end));
+			return;
+		}
+	}
+#endif
+	memset(ptr,0,size);
+}
@@ -0,0 +1,562 @@
+/*
+ *  Copyright (C) 2002-2015  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Z:\SELFTEST.COM, checks that run inside the emulator.
+ *
+ * SELFTEST /CPU runs random streams of register-only instructions under every
+ * CPU core compiled in (normal, simple, full, and the dynamic core if any) from
+ * the same starting state, and compares the general registers and CF/PF/ZF/SF/OF
+ * afterwards. The normal core is the reference. AF is not compared and the
+ * streams avoid instructions whose flags are undefined (MUL, shifts by more
+ * than one), so any difference is a bug in one of the cores. The code is
+ * rewritten in place for every stream, which also exercises the self-modifying
+ * code detection of the dynamic core.
+ *
+ * SELFTEST /GOLDEN runs device emulation that does not depend on the host or on
+ * timing on a fixed input and compares a CRC-32 of the output with a recorded
+ * value. Only the OPL emulation (DBOPL) is covered so far: the mixer output
+ * depends on the host rate and the scalers on the output surface, so neither
+ * has a host independent golden output to record.
+ *
+ * SELFTEST /BENCH times some hot paths of the emulator from the host side and
+ * reports ns per operation: guest memory access through the page handlers, I/O
+ * port dispatch, PIC event scheduling, a full core entry/exit through a far
+ * callback and the conversion of video memory into pixel lines for the current
+ * video mode. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "dosbox.h"
+#include "programs.h"
+#include "selftest.h"
+#include "regs.h"
+#include "cpu.h"
+#include "mem.h"
+#include "callback.h"
+#include "inout.h"
+#include "pic.h"
+#include "timer.h"
+#include "dos_inc.h"
+#include "vga.h"
+#include "zipcrc.h"
+#include "../hardware/dbopl.h"
+#include "../cpu/lazyflags.h"
+
+extern CPU_Decoder * cpudecoder;
+
+#if (C_DYNAMIC_X86)
+void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
+#elif (C_DYNREC)
+void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
+#endif
+
+#define SELFTEST_FLAGS		(FLAG_CF | FLAG_PF | FLAG_ZF | FLAG_SF | FLAG_OF)
+
+/* recorded with SELFTEST_OPLChecksum() */
+#define SELFTEST_GOLDEN_OPL2	0xAD19C5ACUL
+#define SELFTEST_GOLDEN_OPL3	0xD5D8A231UL
+#define SELFTEST_REGS		8
+#define SELFTEST_CODE_MAX	1024
+
+struct SelftestCore {
+	const char *name;
+	CPU_Decoder *run;
+};
+
+static const SelftestCore selftest_cores[] = {
+	{"normal",	&CPU_Core_Normal_Run},
+	{"simple",	&CPU_Core_Simple_Run},
+	{"full",	&CPU_Core_Full_Run},
+#if (C_DYNAMIC_X86)
+	{"dynamic",	&CPU_Core_Dyn_X86_Run},
+#elif (C_DYNREC)
+	{"dynamic",	&CPU_Core_Dynrec_Run},
+#endif
+};
+static const size_t selftest_core_count = sizeof(selftest_cores) / sizeof(selftest_cores[0]);
+
+static const char * const selftest_regnames[SELFTEST_REGS] = {
+	"EAX","ECX","EDX","EBX","ESP","EBP","ESI","EDI"
+};
+
+/* register state going into and out of a stream */
+struct SelftestState {
+	Bit32u regs[SELFTEST_REGS];
+	Bit32u flags;
+};
+
+static Bit32u selftest_seed = 1;
+
+static Bit32u SELFTEST_Random(void) {
+	selftest_seed = selftest_seed * 1103515245u + 12345u;
+	return selftest_seed >> 8;
+}
+
+/* 16/32-bit register, never SP */
+static Bit8u SELFTEST_RandomReg(void) {
+	static const Bit8u regs[7] = {REGI_AX,REGI_CX,REGI_DX,REGI_BX,REGI_BP,REGI_SI,REGI_DI};
+	return regs[SELFTEST_Random() % 7];
+}
+
+static void SELFTEST_EmitImm(std::vector<Bit8u> &code,unsigned int bytes) {
+	for (unsigned int i=0;i < bytes;i++) code.push_back((Bit8u)SELFTEST_Random());
+}
+
+/* append one instruction that only touches registers and flags */
+static void SELFTEST_EmitInstruction(std::vector<Bit8u> &code,bool is386) {
+	bool op32 = is386 && (SELFTEST_Random() & 3) == 0;
+	Bit8u alu = (Bit8u)(SELFTEST_Random() & 7);	/* ADD OR ADC SBB AND SUB XOR CMP */
+	Bit8u r1 = SELFTEST_RandomReg();
+	Bit8u r2 = SELFTEST_RandomReg();
+	Bit8u b1 = (Bit8u)(SELFTEST_Random() & 7);	/* 8-bit registers may be anything */
+	Bit8u b2 = (Bit8u)(SELFTEST_Random() & 7);
+
+	switch (SELFTEST_Random() % 14) {
+		case 0:		/* ALU r/m8,r8 */
+			code.push_back((Bit8u)(alu*8+0));
+			code.push_back((Bit8u)(0xC0|(b1<<3)|b2));
+			break;
+		case 1:		/* ALU r16/32,r/m16/32 */
+			if (op32) code.push_back(0x66);
+			code.push_back((Bit8u)(alu*8+3));
+			code.push_back((Bit8u)(0xC0|(r1<<3)|r2));
+			break;
+		case 2:		/* ALU r/m8,imm8 */
+			code.push_back(0x80);
+			code.push_back((Bit8u)(0xC0|(alu<<3)|b1));
+			SELFTEST_EmitImm(code,1);
+			break;
+		case 3:		/* ALU r/m16/32,imm16/32 and sign extended imm8 */
+			if (op32) code.push_back(0x66);
+			if (SELFTEST_Random() & 1) {
+				code.push_back(0x81);
+				code.push_back((Bit8u)(0xC0|(alu<<3)|r1));
+				SELFTEST_EmitImm(code,op32 ? 4 : 2);
+			}
+			else {
+				code.push_back(0x83);
+				code.push_back((Bit8u)(0xC0|(alu<<3)|r1));
+				SELFTEST_EmitImm(code,1);
+			}
+			break;
+		case 4:		/* INC/DEC r16/32 */
+			if (op32) code.push_back(0x66);
+			code.push_back((Bit8u)(((SELFTEST_Random() & 1) ? 0x48 : 0x40)|r1));
+			break;
+		case 5:		/* NOT/NEG r/m8 or r/m16/32 */
+			if (SELFTEST_Random() & 1) {
+				code.push_back(0xF6);
+				code.push_back((Bit8u)(0xC0|((2+(SELFTEST_Random() & 1))<<3)|b1));
+			}
+			else {
+				if (op32) code.push_back(0x66);
+				code.push_back(0xF7);
+				code.push_back((Bit8u)(0xC0|((2+(SELFTEST_Random() & 1))<<3)|r1));
+			}
+			break;
+		case 6: {	/* ROL ROR RCL RCR SHL SHR SAR by one, the only count where OF is defined */
+			static const Bit8u ops[7] = {0,1,2,3,4,5,7};
+			Bit8u op = ops[SELFTEST_Random() % 7];
+			if (SELFTEST_Random() & 1) {
+				code.push_back(0xD0);
+				code.push_back((Bit8u)(0xC0|(op<<3)|b1));
+			}
+			else {
+				if (op32) code.push_back(0x66);
+				code.push_back(0xD1);
+				code.push_back((Bit8u)(0xC0|(op<<3)|r1));
+			}
+			} break;
+		case 7:		/* MOV reg,imm */
+			if (SELFTEST_Random() & 1) {
+				code.push_back((Bit8u)(0xB0|b1));
+				SELFTEST_EmitImm(code,1);
+			}
+			else {
+				if (op32) code.push_back(0x66);
+				code.push_back((Bit8u)(0xB8|r1));
+				SELFTEST_EmitImm(code,op32 ? 4 : 2);
+			}
+			break;
+		case 8:		/* XCHG r16/32,r16/32 */
+			if (op32) code.push_back(0x66);
+			code.push_back(0x87);
+			code.push_back((Bit8u)(0xC0|(r1<<3)|r2));
+			break;
+		case 9:		/* LEA r16/32,[16-bit address+disp8], no memory is accessed */
+			if (op32) code.push_back(0x66);
+			code.push_back(0x8D);
+			code.push_back((Bit8u)(0x40|(r1<<3)|(SELFTEST_Random() & 7)));
+			SELFTEST_EmitImm(code,1);
+			break;
+		case 10: {	/* CMC CLC STC */
+			static const Bit8u ops[3] = {0xF5,0xF8,0xF9};
+			code.push_back(ops[SELFTEST_Random() % 3]);
+			} break;
+		case 11:	/* TEST r/m16/32,r16/32 */
+			if (op32) code.push_back(0x66);
+			code.push_back(0x85);
+			code.push_back((Bit8u)(0xC0|(r1<<3)|r2));
+			break;
+		case 12:	/* Jcc over a two byte ALU instruction, so every condition gets evaluated */
+			code.push_back((Bit8u)(0x70|(SELFTEST_Random() & 15)));
+			code.push_back(0x02);
+			code.push_back((Bit8u)(alu*8+3));
+			code.push_back((Bit8u)(0xC0|(r1<<3)|r2));
+			break;
+		case 13:	/* SETcc r/m8 and MOVZX/MOVSX r16/32,r/m8 */
+			if (!is386) {
+				code.push_back((Bit8u)(alu*8+2));
+				code.push_back((Bit8u)(0xC0|(b1<<3)|b2));
+			}
+			else if (SELFTEST_Random() & 1) {
+				code.push_back(0x0F);
+				code.push_back((Bit8u)(0x90|(SELFTEST_Random() & 15)));
+				code.push_back((Bit8u)(0xC0|b1));
+			}
+			else {
+				if (op32) code.push_back(0x66);
+				code.push_back(0x0F);
+				code.push_back((SELFTEST_Random() & 1) ? 0xBE : 0xB6);
+				code.push_back((Bit8u)(0xC0|(r1<<3)|b2));
+			}
+			break;
+	}
+}
+
+/* run the code at seg:0000 from state in, with the given core */
+static void SELFTEST_RunStream(const SelftestCore &core,Bit16u seg,const SelftestState &in,SelftestState &out) {
+	for (unsigned int r=0;r < SELFTEST_REGS;r++) {
+		if (r != REGI_SP) reg_32(r) = in.regs[r];
+	}
+	FillFlags();
+	reg_flags = (reg_flags & ~SELFTEST_FLAGS) | in.flags;
+
+	cpudecoder = core.run;
+	CALLBACK_RunRealFar(seg,0);
+
+	FillFlags();
+	for (unsigned int r=0;r < SELFTEST_REGS;r++)
+		out.regs[r] = (r != REGI_SP) ? reg_32(r) : 0;
+	out.flags = reg_flags & SELFTEST_FLAGS;
+}
+
+static void SELFTEST_BenchEvent(Bitu val) {
+	(void)val;//UNUSED
+}
+
+/* OPL golden test: register writes, 0xFFFF followed by a count means generate
+ * that many samples. a two operator FM voice and an additive voice with another
+ * waveform, then the rhythm section, then everything released. */
+#define SELFTEST_OPL_GENERATE	0xFFFF
+
+struct SelftestOPLWrite {
+	Bit16u reg;
+	Bit16u val;
+};
+
+static const SelftestOPLWrite selftest_opl_program[] = {
+	{0x001,0x20},	/* waveform select */
+	{0x020,0x21},{0x040,0x1A},{0x060,0xF4},{0x080,0x56},{0x0E0,0x00},
+	{0x023,0x01},{0x043,0x00},{0x063,0xF2},{0x083,0x74},{0x0E3,0x00},
+	{0x0C0,0x3C},{0x0A0,0x41},{0x0B0,0x32},
+	{0x021,0x02},{0x041,0x08},{0x061,0xA3},{0x081,0x45},{0x0E1,0x01},
+	{0x024,0x04},{0x044,0x04},{0x064,0xC3},{0x084,0x45},{0x0E4,0x02},
+	{0x0C1,0x31},{0x0A1,0x81},{0x0B1,0x2D},
+	{SELFTEST_OPL_GENERATE,2048},
+	{0x0B0,0x12},{0x0B1,0x0D},	/* key off */
+	{0x030,0x01},{0x050,0x00},{0x070,0xF8},{0x090,0x66},
+	{0x033,0x01},{0x053,0x00},{0x073,0xF8},{0x093,0x66},
+	{0x031,0x01},{0x051,0x00},{0x071,0xF8},{0x091,0x66},
+	{0x034,0x01},{0x054,0x00},{0x074,0xF8},{0x094,0x66},
+	{0x035,0x01},{0x055,0x00},{0x075,0xF8},{0x095,0x66},
+	{0x0A6,0x57},{0x0B6,0x09},{0x0A7,0x57},{0x0B7,0x09},{0x0A8,0x57},{0x0B8,0x09},
+	{0x0BD,0x3F},	/* rhythm mode, all drums on */
+	{SELFTEST_OPL_GENERATE,2048},
+	{0x0BD,0x20},	/* drums off */
+	{SELFTEST_OPL_GENERATE,4096}
+};
+
+/* CRC-32 of the output (little endian 32bit samples, interleaved in OPL3 mode) */
+static Bit32u SELFTEST_OPLChecksum(bool opl3) {
+	DBOPL::Handler opl;
+	Bit32s buffer[512*2];
+	Bit8u bytes[512*2*4];
+	zipcrc_t crc = zipcrc_init();
+
+	opl.Init(49716);
+	if (opl3) opl.WriteReg(0x105,0x01);
+
+	for (size_t i=0;i < sizeof(selftest_opl_program)/sizeof(selftest_opl_program[0]);i++) {
+		const SelftestOPLWrite &w = selftest_opl_program[i];
+
+		if (w.reg != SELFTEST_OPL_GENERATE) {
+			opl.WriteReg(w.reg,(Bit8u)w.val);
+			continue;
+		}
+
+		for (Bitu left=w.val;left != 0;) {
+			Bitu samples = (left > 512) ? 512 : left;
+			Bitu values = opl3 ? (samples * 2) : samples;
+
+			if (opl3) opl.chip.GenerateBlock3(samples,buffer);
+			else opl.chip.GenerateBlock2(samples,buffer);
+			for (Bitu s=0;s < values;s++) host_writed(bytes + (s * 4),(Bit32u)buffer[s]);
+			crc = zipcrc_update(crc,bytes,values * 4);
+			left -= samples;
+		}
+	}
+
+	return (Bit32u)zipcrc_finalize(crc);
+}
+
+class SELFTEST : public Program {
+public:
+	void Run(void);
+private:
+	void Usage(void);
+	bool TestCPU(Bit16u seg,unsigned int streams,unsigned int length);
+	bool TestGolden(void);
+	void Bench(Bit16u seg);
+	void BenchResult(const char *what,Bit64u t0,Bit64u t1,unsigned int ops);
+};
+
+void SELFTEST::Usage(void) {
+	WriteOut("Runs internal consistency checks and benchmarks of the emulator.\n\n");
+	WriteOut("SELFTEST [/CPU] [/GOLDEN] [/BENCH] [/N:streams] [/L:length] [/SEED:n]\n\n");
+	WriteOut(" /CPU      compare all CPU cores on random instruction streams\n");
+	WriteOut(" /GOLDEN   compare OPL output with recorded checksums\n");
+	WriteOut(" /BENCH    time memory, I/O, PIC, core entry and VGA line drawing\n");
+	WriteOut(" /N:n      number of instruction streams (default 200)\n");
+	WriteOut(" /L:n      instructions per stream (default 32)\n");
+	WriteOut(" /SEED:n   random seed, to repeat a failing run\n");
+}
+
+bool SELFTEST::TestCPU(Bit16u seg,unsigned int streams,unsigned int length) {
+	bool is386 = CPU_ArchitectureType >= CPU_ARCHTYPE_386;
+	PhysPt base = PhysMake(seg,0);
+	std::vector<Bit8u> code;
+	unsigned int failures = 0;
+
+	WriteOut("CPU: %u streams of %u instructions, seed %u, cores:",
+		streams,length,(unsigned int)selftest_seed);
+	for (size_t c=0;c < selftest_core_count;c++) WriteOut(" %s",selftest_cores[c].name);
+	WriteOut("\n");
+
+#if (C_DYNAMIC_X86)
+	CPU_Core_Dyn_X86_Cache_Init(true);
+#elif (C_DYNREC)
+	CPU_Core_Dynrec_Cache_Init(true);
+#endif
+
+	for (unsigned int s=0;s < streams;s++) {
+		Bit32u stream_seed = selftest_seed;
+
+		code.clear();
+		for (unsigned int i=0;i < length && code.size() < (SELFTEST_CODE_MAX-16);i++)
+			SELFTEST_EmitInstruction(code,is386);
+		code.push_back(0xCB);	/* RETF */
+		for (size_t i=0;i < code.size();i++) mem_writeb(base+(PhysPt)i,code[i]);
+
+		SelftestState in,ref,res;
+		for (unsigned int r=0;r < SELFTEST_REGS;r++)
+			in.regs[r] = (SELFTEST_Random() << 16) ^ SELFTEST_Random();
+		if (!is386) {
+			for (unsigned int r=0;r < SELFTEST_REGS;r++) in.regs[r] &= 0xFFFF;
+		}
+		in.flags = SELFTEST_Random() & SELFTEST_FLAGS;
+
+		SELFTEST_RunStream(selftest_cores[0],seg,in,ref);
+		for (size_t c=1;c < selftest_core_count;c++) {
+			SELFTEST_RunStream(selftest_cores[c],seg,in,res);
+			if (memcmp(&ref,&res,sizeof(ref)) == 0) continue;
+
+			if (++failures > 5) continue;
+			WriteOut("Stream %u (seed %u): %s differs from %s\n",
+				s,(unsigned int)stream_seed,selftest_cores[c].name,selftest_cores[0].name);
+			WriteOut(" code:");
+			for (size_t i=0;i < code.size();i++) WriteOut(" %02X",code[i]);
+			WriteOut("\n");
+			for (unsigned int r=0;r < SELFTEST_REGS;r++) {
+				if (ref.regs[r] != res.regs[r])
+					WriteOut(" %s %08X, %s has %08X\n",selftest_regnames[r],
+						(unsigned int)ref.regs[r],selftest_cores[c].name,(unsigned int)res.regs[r]);
+			}
+			if (ref.flags != res.flags)
+				WriteOut(" FLAGS %04X, %s has %04X\n",
+					(unsigned int)ref.flags,selftest_cores[c].name,(unsigned int)res.flags);
+		}
+	}
+
+	if (failures != 0) {
+		WriteOut("CPU: %u mismatches\n",failures);
+		return false;
+	}
+	WriteOut("CPU: all cores agree\n");
+	return true;
+}
+
+bool SELFTEST::TestGolden(void) {
+	static const struct {
+		const char *name;
+		bool opl3;
+		Bit32u crc;
+	} tests[] = {
+		{"OPL2 (DBOPL)",false,SELFTEST_GOLDEN_OPL2},
+		{"OPL3 (DBOPL)",true,SELFTEST_GOLDEN_OPL3}
+	};
+	bool ok = true;
+
+	for (size_t i=0;i < sizeof(tests)/sizeof(tests[0]);i++) {
+		Bit32u crc = SELFTEST_OPLChecksum(tests[i].opl3);
+
+		if (crc == tests[i].crc) {
+			WriteOut("%s: ok\n",tests[i].name);
+		}
+		else {
+			WriteOut("%s: checksum %08X, expected %08X\n",tests[i].name,(unsigned int)crc,(unsigned int)tests[i].crc);
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+void SELFTEST::BenchResult(const char *what,Bit64u t0,Bit64u t1,unsigned int ops) {
+	WriteOut(" %-28s %8.1f ns/op\n",what,(double)(t1 - t0) * 1000.0 / ops);
+}
+
+void SELFTEST::Bench(Bit16u seg) {
+	PhysPt base = PhysMake(seg,0);
+	volatile Bitu sink = 0;
+	Bit64u t0,t1;
+	unsigned int i;
+
+	WriteOut("Benchmarks:\n");
+
+	const unsigned int mem_ops = 1000000;
+	t0 = GetTicksUs();
+	for (i=0;i < mem_ops;i++) mem_writeb(base+(i&0xFFF),(Bit8u)i);
+	t1 = GetTicksUs();
+	BenchResult("mem_writeb",t0,t1,mem_ops);
+
+	t0 = GetTicksUs();
+	for (i=0;i < mem_ops;i++) sink += mem_readb(base+(i&0xFFF));
+	t1 = GetTicksUs();
+	BenchResult("mem_readb",t0,t1,mem_ops);
+
+	t0 = GetTicksUs();
+	for (i=0;i < mem_ops;i++) sink += mem_readd(base+(i&0xFFC));
+	t1 = GetTicksUs();
+	BenchResult("mem_readd",t0,t1,mem_ops);
+
+	if (!IS_PC98_ARCH) {
+		/* I/O delay is charged to the cycle counter, do not let the benchmark eat into it */
+		Bit32s old_cycles = CPU_Cycles;
+		Bit64s old_removed = CPU_IODelayRemoved;
+
+		const unsigned int io_ops = 1000000;
+		t0 = GetTicksUs();
+		for (i=0;i < io_ops;i++) sink += IO_ReadB(0x61);
+		t1 = GetTicksUs();
+		BenchResult("IO_ReadB (port 61h)",t0,t1,io_ops);
+
+		CPU_Cycles = old_cycles;
+		CPU_IODelayRemoved = old_removed;
+	}
+
+	const unsigned int pic_ops = 100000;
+	t0 = GetTicksUs();
+	for (i=0;i < pic_ops;i++) {
+		PIC_AddEvent(SELFTEST_BenchEvent,1000.0f,(Bitu)i);
+		PIC_RemoveSpecificEvents(SELFTEST_BenchEvent,(Bitu)i);
+	}
+	t1 = GetTicksUs();
+	BenchResult("PIC_AddEvent+RemoveEvents",t0,t1,pic_ops);
+
+	const unsigned int call_ops = 10000;
+	mem_writeb(base,0xCB);	/* RETF */
+	t0 = GetTicksUs();
+	for (i=0;i < call_ops;i++) CALLBACK_RunRealFar(seg,0);
+	t1 = GetTicksUs();
+	BenchResult("core entry+RETF",t0,t1,call_ops);
+
+	const unsigned int frame_ops = 100;
+	Bitu lines = 0;
+	t0 = GetTicksUs();
+	for (i=0;i < frame_ops;i++) lines += VGA_DrawFrameLines();
+	t1 = GetTicksUs();
+	if (lines != 0) BenchResult("VGA line drawing (per line)",t0,t1,(unsigned int)lines);
+
+	(void)sink;
+}
+
+void SELFTEST::Run(void) {
+	bool do_cpu = cmd->FindExist("/CPU",true);
+	bool do_golden = cmd->FindExist("/GOLDEN",true);
+	bool do_bench = cmd->FindExist("/BENCH",true);
+	int streams = 200,length = 32;
+
+	if (cmd->FindExist("/?",false) || (!do_cpu && !do_golden && !do_bench)) {
+		Usage();
+		return;
+	}
+
+	if (cmd->FindStringBegin("/N:",temp_line,true)) streams = atoi(temp_line.c_str());
+	if (cmd->FindStringBegin("/L:",temp_line,true)) length = atoi(temp_line.c_str());
+	if (cmd->FindStringBegin("/SEED:",temp_line,true))
+		selftest_seed = (Bit32u)strtoul(temp_line.c_str(),NULL,0);
+	else
+		selftest_seed = (Bit32u)GetTicksUs();
+	if (streams < 1) streams = 1;
+	if (length < 1) length = 1;
+
+	if (cpu.pmode) {
+		WriteOut("SELFTEST needs real mode, it cannot run under a protected mode memory manager.\n");
+		return;
+	}
+
+	Bit16u seg,blocks = (4096/16);
+	if (!DOS_AllocateMemory(&seg,&blocks)) {
+		WriteOut("Not enough memory.\n");
+		return;
+	}
+
+	/* the streams and the benchmarks clobber registers and the decoder */
+	FillFlags();
+	CPU_Regs old_regs = cpu_regs;
+	CPU_Decoder *old_decoder = cpudecoder;
+	bool ok = true;
+
+	if (do_cpu) ok = TestCPU(seg,(unsigned int)streams,(unsigned int)length);
+	cpudecoder = old_decoder;
+	if (do_golden && !TestGolden()) ok = false;
+	if (do_bench) Bench(seg);
+
+	cpudecoder = old_decoder;
+	FillFlags();
+	cpu_regs = old_regs;
+
+	DOS_FreeMemory(seg);
+	exit_status = ok ? 0 : 1;
+}
+
+void SELFTEST_ProgramStart(Program * * make) {
+	*make=new SELFTEST;
+}
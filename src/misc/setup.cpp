@@ -22,6 +22,7 @@
 #include "setup.h"
 #include "control.h"
 #include "support.h"
+#include "timer.h"
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -871,13 +872,19 @@ void DispatchVMEvent(enum vm_event event) {
 
 	LOG(LOG_MISC,LOG_DEBUG)("Dispatching VM event %s",GetVMEventName(event));
 
+	Bit64u event_start = GetTicksUs();
+
 	vm_dispatch_state.begin_event(event);
 	for (std::list<Function_wrapper>::iterator i=vm_event_functions[event].begin();i!=vm_event_functions[event].end();i++) {
 		LOG(LOG_MISC,LOG_DEBUG)("Calling event %s handler (%p) '%s'",GetVMEventName(event),(void*)((*i).function),(*i).name.c_str());
+		Bit64u start = GetTicksUs();
 		(*i).function(NULL);
+		LOG(LOG_MISC,LOG_DEBUG)("Event %s handler '%s' took %.3fms",GetVMEventName(event),(*i).name.c_str(),(double)(GetTicksUs() - start) / 1000.0);
 	}
 
 	vm_dispatch_state.end_event();
+
+	LOG(LOG_MISC,LOG_DEBUG)("VM event %s took %.3fms",GetVMEventName(event),(double)(GetTicksUs() - event_start) / 1000.0);
 }
 
 Config::~Config() {
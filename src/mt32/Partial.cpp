@@ -44,6 +44,8 @@ Partial::Partial(Synth *useSynth, int useDebugPartialNum) :
 	ownerPart = -1;
 	poly = NULL;
 	pair = NULL;
+	outputLength = 0;
+	deferredEvents = NULL;
 
 
 	// init ptr warnings (load state crashes)
@@ -91,7 +93,12 @@ void Partial::deactivate() {
 	}
 	ownerPart = -1;
 	if (poly != NULL) {
-		poly->partialDeactivated(this);
+		if (deferredEvents != NULL) {
+			PartialEvent event = {PartialEvent::DEACTIVATED, this, poly, NULL, 0, 0};
+			deferredEvents->push_back(event);
+		} else {
+			poly->partialDeactivated(this);
+		}
 	}
 	synth->partialStateChanged(this, tva->getPhase(), TVA_PHASE_DEAD);
 #if MT32EMU_MONITOR_PARTIALS > 2
@@ -112,7 +119,13 @@ void Partial::deactivate() {
 	poly = NULL;
 
 	if (pair != NULL) {
-		pair->pair = NULL;
+		// A pair that is not ring modulated renders in a job of its own and may be reading its pair pointer right now
+		if (deferredEvents != NULL && pair->deferredEvents != deferredEvents) {
+			PartialEvent event = {PartialEvent::UNPAIRED, this, NULL, pair, 0, 0};
+			deferredEvents->push_back(event);
+		} else {
+			pair->pair = NULL;
+		}
 	}
 }
 
@@ -300,14 +313,31 @@ Synth *Partial::getSynth() const {
 }
 
 bool Partial::produceOutput(float *leftBuf, float *rightBuf, unsigned long length) {
-	if (!isActive() || alreadyOutputed || isRingModulatingSlave()) {
+	if (!generateOutput(length)) {
+		return false;
+	}
+	readOutput(leftBuf, rightBuf, length);
+	return true;
+}
+
+bool Partial::hasOutputPending() const {
+	return isActive() && !alreadyOutputed && !isRingModulatingSlave();
+}
+
+bool Partial::generateOutput(unsigned long length) {
+	if (!hasOutputPending()) {
 		return false;
 	}
 	if (poly == NULL) {
 		synth->printDebug("[Partial %d] *** ERROR: poly is NULL at Partial::produceOutput()!", debugPartialNum);
 		return false;
 	}
-	unsigned long numGenerated = generateSamples(myBuffer, length);
+	outputLength = generateSamples(myBuffer, length);
+	return true;
+}
+
+void Partial::readOutput(float *leftBuf, float *rightBuf, unsigned long length) const {
+	unsigned long numGenerated = outputLength;
 	for (unsigned int i = 0; i < numGenerated; i++) {
 		*leftBuf++ = myBuffer[i] * stereoVolume.leftVol;
 		*rightBuf++ = myBuffer[i] * stereoVolume.rightVol;
@@ -316,7 +346,6 @@ bool Partial::produceOutput(float *leftBuf, float *rightBuf, unsigned long lengt
 		*leftBuf++ = 0.0f;
 		*rightBuf++ = 0.0f;
 	}
-	return true;
 }
 
 bool Partial::shouldReverb() {
@@ -18,6 +18,7 @@
 #ifndef MT32EMU_PARTIAL_H
 #define MT32EMU_PARTIAL_H
 
+#include <vector>
 #include "FileStream.h"
 
 namespace MT32Emu {
@@ -25,8 +26,27 @@ namespace MT32Emu {
 class Synth;
 class Part;
 class TVA;
+class Poly;
 struct ControlROMPCMStruct;
 
+// A change to shared synth state made by a partial rendering on a worker thread.
+// Synth applies these on the rendering thread once the workers are done.
+struct PartialEvent {
+	enum Type {
+		DEACTIVATED, // poly loses the partial
+		PHASE_CHANGED, // The TVA phase of the partial changed from oldPartialPhase to newPartialPhase
+		UNPAIRED // The partial was deactivated, its pair (rendered in another job) forgets it
+	};
+	Type type;
+	const Partial *partial;
+	Poly *poly;
+	Partial *pair;
+	int oldPartialPhase;
+	int newPartialPhase;
+};
+
+typedef std::vector<PartialEvent> PartialEventLog;
+
 struct StereoVolume {
 	float leftVol;
 	float rightVol;
@@ -47,6 +67,8 @@ private:
 	StereoVolume stereoVolume;
 
 	Bit16s myBuffer[MAX_SAMPLES_PER_RUN];
+	// Number of samples in myBuffer from the last generateOutput()
+	unsigned long outputLength;
 
 	// Only used for PCM partials
 	int pcmNum;
@@ -79,6 +101,9 @@ public:
 	Partial *pair;
 	bool alreadyOutputed;
 
+	// Set while the partial renders on a worker thread, state changes are recorded here instead of applied
+	PartialEventLog *deferredEvents;
+
 	Partial(Synth *synth, int debugPartialNum);
 	~Partial();
 
@@ -105,6 +130,12 @@ public:
 	// made from combining this single partial with its pair, if it has one.
 	bool produceOutput(float *leftBuf, float *rightBuf, unsigned long length);
 
+	// produceOutput() in two steps, so that the generators can run on another thread.
+	// generateOutput() renders into the partial's own buffer, readOutput() converts that to stereo.
+	bool hasOutputPending() const;
+	bool generateOutput(unsigned long length);
+	void readOutput(float *leftBuf, float *rightBuf, unsigned long length) const;
+
 	// This function writes mono sample output to the provided buffer, and returns the number of samples written
 	unsigned long generateSamples(Bit16s *partialBuf, unsigned long length);
 };
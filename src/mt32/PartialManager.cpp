@@ -250,4 +250,11 @@ const Partial *PartialManager::getPartial(unsigned int partialNum) const {
 	return partialTable[partialNum];
 }
 
+Partial *PartialManager::getPartial(unsigned int partialNum) {
+	if (partialNum > synth->getPartialLimit() - 1) {
+		return NULL;
+	}
+	return partialTable[partialNum];
+}
+
 }
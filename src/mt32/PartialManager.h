@@ -47,6 +47,7 @@ public:
 	bool shouldReverb(int i);
 	void clearAlreadyOutputed();
 	const Partial *getPartial(unsigned int partialNum) const;
+	Partial *getPartial(unsigned int partialNum);
 };
 
 }
@@ -164,7 +164,7 @@ bool Poly::isActive() const {
 }
 
 // This is called by Partial to inform the poly that the Partial has deactivated
-void Poly::partialDeactivated(Partial *partial) {
+void Poly::partialDeactivated(const Partial *partial) {
 	for (int i = 0; i < 4; i++) {
 		if (partials[i] == partial) {
 			partials[i] = NULL;
@@ -65,7 +65,7 @@ public:
 	unsigned int getActivePartialCount() const;
 	bool isActive() const;
 
-	void partialDeactivated(Partial *partial);
+	void partialDeactivated(const Partial *partial);
 
 	Poly *getNext();
 	void setNext(Poly *poly);
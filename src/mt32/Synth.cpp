@@ -177,6 +177,8 @@ Synth::Synth(ReportHandler *useReportHandler) {
 	setReverbOutputGain(0.68f);
 	partialManager = NULL;
 	memset(parts, 0, sizeof(parts));
+	renderWorkers = NULL;
+	renderJobCount = 0;
 	renderedSampleCount = 0;
 
 	partialLimit = MT32EMU_MAX_PARTIALS;
@@ -211,6 +213,11 @@ void Synth::polyStateChanged(int partNum) {
 }
 
 void Synth::partialStateChanged(const Partial * const partial, int oldPartialPhase, int newPartialPhase) {
+	if (partial->deferredEvents != NULL) {
+		PartialEvent event = {PartialEvent::PHASE_CHANGED, partial, NULL, NULL, oldPartialPhase, newPartialPhase};
+		partial->deferredEvents->push_back(event);
+		return;
+	}
 	for (unsigned int i = 0; i < getPartialLimit(); i++) {
 		if (getPartial(i) == partial) {
 			reportHandler->onPartialStateChanged(i, oldPartialPhase, newPartialPhase);
@@ -279,6 +286,10 @@ void Synth::setReverbOutputGain(float newReverbOutputGain) {
 	reverbOutputGain = newReverbOutputGain;
 }
 
+void Synth::setRenderWorkers(RenderWorkers *newRenderWorkers) {
+	renderWorkers = newRenderWorkers;
+}
+
 bool Synth::loadControlROM(const ROMImage &controlROMImage) {
 	if (&controlROMImage == NULL) return false;
 	File *file = controlROMImage.getFile();
@@ -1430,11 +1441,86 @@ void Synth::renderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s
 }
 
 // FIXME: Using more temporary buffers than we need to
+// Generates the output of all active partials at once on the render workers, if there are any.
+// Returns false when the partials have to be rendered one by one on this thread instead.
+bool Synth::renderPartialsParallel(Bit32u len) {
+	if (renderWorkers == NULL || renderWorkers->getThreadCount() < 2) {
+		return false;
+	}
+	renderJobCount = 0;
+	renderJobLength = len;
+	for (unsigned int i = 0; i < getPartialLimit(); i++) {
+		Partial *partial = partialManager->getPartial(i);
+		renderJobOutput[i] = false;
+		renderJobReverb[i] = false;
+		if (!partial->hasOutputPending()) {
+			continue;
+		}
+		// Decide the bus now, a partial that finishes during this run no longer reports it
+		renderJobReverb[i] = partial->shouldReverb();
+		// A ring modulating slave is rendered and deactivated by its master, so they share the log
+		partial->deferredEvents = &renderJobEvents[i];
+		if (partial->hasRingModulatingSlave()) {
+			partial->pair->deferredEvents = &renderJobEvents[i];
+		}
+		renderJobs[renderJobCount++] = i;
+	}
+	renderWorkers->run(renderPartialJob, this, renderJobCount);
+	for (unsigned int i = 0; i < getPartialLimit(); i++) {
+		partialManager->getPartial(i)->deferredEvents = NULL;
+	}
+	return true;
+}
+
+void Synth::renderPartialJob(void *context, unsigned int n) {
+	Synth *synth = (Synth *)context;
+	unsigned int i = synth->renderJobs[n];
+	synth->renderJobOutput[i] = synth->partialManager->getPartial(i)->generateOutput(synth->renderJobLength);
+}
+
+bool Synth::shouldPartialReverb(unsigned int i, bool parallel) {
+	if (parallel) {
+		return renderJobReverb[i];
+	}
+	return partialManager->shouldReverb(i);
+}
+
+// Puts the output of partial i into tmpBufPartialLeft/Right. After a parallel render, the state changes
+// the partial made meanwhile are applied here, at the point where rendering it serially would have made them.
+bool Synth::producePartialOutput(unsigned int i, bool parallel, Bit32u len) {
+	if (!parallel) {
+		return partialManager->produceOutput(i, &tmpBufPartialLeft[0], &tmpBufPartialRight[0], len);
+	}
+	PartialEventLog &events = renderJobEvents[i];
+	for (size_t n = 0; n < events.size(); n++) {
+		const PartialEvent &event = events[n];
+		switch (event.type) {
+		case PartialEvent::DEACTIVATED:
+			event.poly->partialDeactivated(event.partial);
+			break;
+		case PartialEvent::PHASE_CHANGED:
+			partialStateChanged(event.partial, event.oldPartialPhase, event.newPartialPhase);
+			break;
+		case PartialEvent::UNPAIRED:
+			event.pair->pair = NULL;
+			break;
+		}
+	}
+	events.clear();
+	if (!renderJobOutput[i]) {
+		return false;
+	}
+	partialManager->getPartial(i)->readOutput(&tmpBufPartialLeft[0], &tmpBufPartialRight[0], len);
+	return true;
+}
+
 void Synth::doRenderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u len) {
+	// The partials are mixed in the same order either way, so parallel rendering gives the same samples
+	bool parallel = renderPartialsParallel(len);
 	clearFloats(&tmpBufMixLeft[0], &tmpBufMixRight[0], len);
 	if (!reverbEnabled) {
 		for (unsigned int i = 0; i < getPartialLimit(); i++) {
-			if (partialManager->produceOutput(i, &tmpBufPartialLeft[0], &tmpBufPartialRight[0], len)) {
+			if (producePartialOutput(i, parallel, len)) {
 				mix(&tmpBufMixLeft[0], &tmpBufPartialLeft[0], len);
 				mix(&tmpBufMixRight[0], &tmpBufPartialRight[0], len);
 			}
@@ -1451,8 +1537,8 @@ void Synth::doRenderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16
 		clearIfNonNull(reverbWetRight, len);
 	} else {
 		for (unsigned int i = 0; i < getPartialLimit(); i++) {
-			if (!partialManager->shouldReverb(i)) {
-				if (partialManager->produceOutput(i, &tmpBufPartialLeft[0], &tmpBufPartialRight[0], len)) {
+			if (!shouldPartialReverb(i, parallel)) {
+				if (producePartialOutput(i, parallel, len)) {
 					mix(&tmpBufMixLeft[0], &tmpBufPartialLeft[0], len);
 					mix(&tmpBufMixRight[0], &tmpBufPartialRight[0], len);
 				}
@@ -1467,8 +1553,8 @@ void Synth::doRenderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16
 
 		clearFloats(&tmpBufMixLeft[0], &tmpBufMixRight[0], len);
 		for (unsigned int i = 0; i < getPartialLimit(); i++) {
-			if (partialManager->shouldReverb(i)) {
-				if (partialManager->produceOutput(i, &tmpBufPartialLeft[0], &tmpBufPartialRight[0], len)) {
+			if (shouldPartialReverb(i, parallel)) {
+				if (producePartialOutput(i, parallel, len)) {
 					mix(&tmpBufMixLeft[0], &tmpBufPartialLeft[0], len);
 					mix(&tmpBufMixRight[0], &tmpBufPartialRight[0], len);
 				}
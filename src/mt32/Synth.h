@@ -259,6 +259,20 @@ protected:
 	virtual void onProgramChanged(int /* partNum */, char * /* patchName */) {}
 };
 
+// Threads supplied by the application for rendering partials in parallel (see Synth::setRenderWorkers()).
+// Only the wave generators run on the workers. Anything they would change in shared state is applied
+// afterwards on the rendering thread in partial order, so the output is the same with any number of threads.
+class RenderWorkers {
+public:
+	virtual ~RenderWorkers() {}
+
+	// Number of threads run() spreads the jobs over, including the calling thread
+	virtual unsigned int getThreadCount() const = 0;
+
+	// Calls job(context, n) once for each n in 0..count-1 and returns when all calls have finished
+	virtual void run(void (*job)(void *context, unsigned int n), void *context, unsigned int count) = 0;
+};
+
 class Synth {
 friend class Part;
 friend class RhythmPart;
@@ -315,6 +329,15 @@ private:
 	PartialManager *partialManager;
 	Part *parts[9];
 
+	RenderWorkers *renderWorkers;
+	// State of the current parallel render, indexed by partial number except renderJobs
+	unsigned int renderJobs[MT32EMU_MAX_PARTIALS];
+	unsigned int renderJobCount;
+	Bit32u renderJobLength;
+	bool renderJobOutput[MT32EMU_MAX_PARTIALS];
+	bool renderJobReverb[MT32EMU_MAX_PARTIALS];
+	PartialEventLog renderJobEvents[MT32EMU_MAX_PARTIALS];
+
 	// FIXME: We can reorganise things so that we don't need all these separate tmpBuf, tmp and prerender buffers.
 	// This should be rationalised when things have stabilised a bit (if prerender buffers don't die in the mean time).
 
@@ -350,6 +373,10 @@ private:
 	void copyPrerender(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u pos, Bit32u len);
 	void checkPrerender(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u &pos, Bit32u &len);
 	void doRenderStreams(Bit16s *nonReverbLeft, Bit16s *nonReverbRight, Bit16s *reverbDryLeft, Bit16s *reverbDryRight, Bit16s *reverbWetLeft, Bit16s *reverbWetRight, Bit32u len);
+	bool renderPartialsParallel(Bit32u len);
+	static void renderPartialJob(void *context, unsigned int n);
+	bool shouldPartialReverb(unsigned int i, bool parallel);
+	bool producePartialOutput(unsigned int i, bool parallel, Bit32u len);
 
 	void playAddressedSysex(unsigned char channel, const Bit8u *sysex, Bit32u len);
 	void readSysex(unsigned char channel, const Bit8u *sysex, Bit32u len) const;
@@ -420,6 +447,10 @@ public:
 	// Sets output gain factor for the reverb wet output. setOutputGain() doesn't change reverb output gain.
 	void setReverbOutputGain(float);
 
+	// Renders partials on the given threads from now on, NULL renders them all on the calling thread.
+	// The workers must stay valid until they are replaced or the synth is deleted.
+	void setRenderWorkers(RenderWorkers *renderWorkers);
+
 	// Renders samples to the specified output stream.
 	// The length is in frames, not bytes (in 16-bit stereo,
 	// one frame is 4 bytes).
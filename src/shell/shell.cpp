@@ -56,6 +56,7 @@ static std::list<std::string> autoexec_strings;
 typedef std::list<std::string>::iterator auto_it;
 
 void VFILE_Remove(const char *name);
+bool FORKSERVER_GetCommand(char *line,size_t size);
 
 void AutoexecObject::Install(const std::string &in) {
 	if(GCC_UNLIKELY(installed)) E_Exit("autoexec: already created %s",buf.c_str());
@@ -374,6 +375,12 @@ void DOS_Shell::Run(void) {
 					};
 				};
 			} else input_line[0]='\0';
+		} else if (this == first_shell && FORKSERVER_GetCommand(input_line,CMD_MAXLINE)) {
+			if (echo) {
+				ShowPrompt();
+				WriteOut_NoParsing(input_line);
+				WriteOut_NoParsing("\n");
+			}
 		} else {
 			if (echo) ShowPrompt();
 			InputCommand(input_line);